@@ -0,0 +1,211 @@
+/*--------------------------------------------------------------------*/
+/* benchcombiner.c                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtable.h"
+#include "symtablecombiner.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+/* Number of keys the threads operate on, room for each key, and the
+   most threads a benchmark runs. */
+enum {KEY_COUNT = 65536, KEY_STRIDE = 16, MAX_THREADS = 256};
+
+/* The table shared by the threads and how they get to it: through a
+   SymTableCombiner, or with a mutex around every call if oCombiner
+   is NULL. */
+
+struct Shared
+{
+   SymTable_T oSymTable;
+   SymTableCombiner_T oCombiner;
+   pthread_mutex_t mutex;
+   const char *pcKeys;
+   size_t uOpCount;
+};
+
+/* What one thread is given: the shared table, its seed, and room for
+   the number of lookups that found their key. */
+
+struct Worker
+{
+   struct Shared *psShared;
+   size_t uSeed;
+   size_t uFound;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return a pseudo-random number following *puState, which is
+   updated. */
+
+static size_t nextRandom(size_t *puState)
+{
+   *puState = *puState * 6364136223846793005u + 1442695040888963407u;
+   return *puState >> 17;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the wall clock time in seconds. */
+
+static double now(void)
+{
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply psShared->uOpCount random operations to the shared table of
+   the struct Worker pvWorker: 80% gets, 10% puts and 10% removes. */
+
+static void *work(void *pvWorker)
+{
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   struct Shared *psShared = psWorker->psShared;
+   const char *pcKey;
+   size_t uState = psWorker->uSeed;
+   size_t uRandom;
+   size_t u;
+   void *pvFound = NULL;
+
+   for (u = 0; u < psShared->uOpCount; u++)
+   {
+      uRandom = nextRandom(&uState);
+      pcKey = psShared->pcKeys + uRandom % KEY_COUNT * KEY_STRIDE;
+      uRandom = (uRandom / KEY_COUNT) % 10;
+
+      if (psShared->oCombiner != NULL)
+      {
+         if (uRandom == 0)
+            (void)SymTableCombiner_put(psShared->oCombiner, pcKey,
+               pcKey);
+         else if (uRandom == 1)
+            (void)SymTableCombiner_remove(psShared->oCombiner, pcKey);
+         else
+            pvFound = SymTableCombiner_get(psShared->oCombiner, pcKey);
+      }
+      else
+      {
+         pthread_mutex_lock(&psShared->mutex);
+         if (uRandom == 0)
+            (void)SymTable_put(psShared->oSymTable, pcKey, pcKey);
+         else if (uRandom == 1)
+            (void)SymTable_remove(psShared->oSymTable, pcKey);
+         else
+            pvFound = SymTable_get(psShared->oSymTable, pcKey);
+         pthread_mutex_unlock(&psShared->mutex);
+      }
+      if (uRandom > 1 && pvFound != NULL)
+         psWorker->uFound++;
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run argv[1] threads that each apply argv[2] random operations to
+   one SymTable holding half of KEY_COUNT keys, through a
+   SymTableCombiner or, if argv[3] is "mutex", with a mutex around
+   every call. Write the wall clock time to stdout. Exit with
+   EXIT_FAILURE if the arguments are bad or there is not enough
+   memory. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   struct Shared sShared;
+   struct Worker asWorkers[MAX_THREADS];
+   pthread_t aiThreads[MAX_THREADS];
+   char *pcKeys;
+   unsigned long ulThreadCount;
+   unsigned long ulOpCount;
+   size_t uThreadCount;
+   size_t uFound = 0;
+   size_t u;
+   double dStart;
+   double dEnd;
+   int iMutex;
+
+   if (argc < 3 || sscanf(argv[1], "%lu", &ulThreadCount) != 1
+      || sscanf(argv[2], "%lu", &ulOpCount) != 1
+      || ulThreadCount == 0 || ulThreadCount > MAX_THREADS)
+   {
+      fprintf(stderr, "Usage: %s threadcount opcount [mutex]\n",
+         argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   uThreadCount = (size_t)ulThreadCount;
+   iMutex = argc > 3 && strcmp(argv[3], "mutex") == 0;
+
+   pcKeys = (char*)malloc(KEY_COUNT * KEY_STRIDE);
+   sShared.oSymTable = SymTable_new();
+   if (pcKeys == NULL || sShared.oSymTable == NULL)
+   {
+      fprintf(stderr, "Not enough memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (u = 0; u < KEY_COUNT; u++)
+   {
+      sprintf(pcKeys + u * KEY_STRIDE, "%lu", (unsigned long)u);
+      if (u % 2 == 0)
+         (void)SymTable_put(sShared.oSymTable, pcKeys + u * KEY_STRIDE,
+            pcKeys);
+   }
+
+   sShared.oCombiner = NULL;
+   if (! iMutex)
+   {
+      sShared.oCombiner = SymTableCombiner_new(sShared.oSymTable);
+      if (sShared.oCombiner == NULL)
+      {
+         fprintf(stderr, "Not enough memory\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   pthread_mutex_init(&sShared.mutex, NULL);
+   sShared.pcKeys = pcKeys;
+   sShared.uOpCount = (size_t)ulOpCount;
+
+   dStart = now();
+   for (u = 0; u < uThreadCount; u++)
+   {
+      asWorkers[u].psShared = &sShared;
+      asWorkers[u].uSeed = u + 1;
+      asWorkers[u].uFound = 0;
+      if (pthread_create(&aiThreads[u], NULL, work, &asWorkers[u])
+         != 0)
+      {
+         fprintf(stderr, "Cannot start thread %lu\n",
+            (unsigned long)u);
+         exit(EXIT_FAILURE);
+      }
+   }
+   for (u = 0; u < uThreadCount; u++)
+   {
+      pthread_join(aiThreads[u], NULL);
+      uFound += asWorkers[u].uFound;
+   }
+   dEnd = now();
+
+   printf("%s %3lu threads: %8.3f s for %lu operations, %lu found\n",
+      iMutex ? "mutex   " : "combiner", ulThreadCount, dEnd - dStart,
+      ulThreadCount * ulOpCount, (unsigned long)uFound);
+
+   if (sShared.oCombiner != NULL)
+      SymTableCombiner_free(sShared.oCombiner);
+   pthread_mutex_destroy(&sShared.mutex);
+   SymTable_free(sShared.oSymTable);
+   free(pcKeys);
+   return 0;
+}
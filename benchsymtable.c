@@ -0,0 +1,502 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _DEFAULT_SOURCE
+
+#include "symtable.h"
+#include "symtablefrozen.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Room for each key in the key buffer */
+enum {KEY_STRIDE = 16};
+
+/* The number of hardware events counted around each phase */
+enum {EVENT_COUNT = 6};
+
+/* The options a benchmark can be run with, the flags for
+   SymTable_newWithAllocator, whether the filter is turned on,
+   whether the memory of the SymTable is counted and compared with a
+   SymTableFrozen made from it, and whether hardware events are
+   counted. */
+
+struct Options
+{
+   int iFlags;
+   int iFilter;
+   int iFrozen;
+   int iPerf;
+};
+
+/* The hardware event counters of the benchmark, one file descriptor
+   per event, -1 for events that are not counted. */
+
+struct Counters
+{
+   int aiFds[EVENT_COUNT];
+};
+
+/* The names the events are printed with, in the order of aiFds. */
+static const char *const apcEventNames[EVENT_COUNT] =
+   {"cycles", "instr", "L1d-miss", "LLC-miss", "dTLB-miss",
+    "br-miss"};
+
+/* The memory a SymTable holds: the bytes it asked for and the number
+   of blocks they came in. */
+
+struct Usage
+{
+   size_t uBytes;
+   size_t uBlocks;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return a pseudo-random number following *puState, which is
+   updated. The sequence only depends on the initial state, so every
+   run looks up the same keys. */
+
+static size_t nextRandom(size_t *puState)
+{
+   *puState = *puState * 6364136223846793005u + 1442695040888963407u;
+   return *puState >> 17;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the CPU time in seconds between iStart and iEnd. */
+
+static double seconds(clock_t iStart, clock_t iEnd)
+{
+   return ((double)iEnd - (double)iStart) / CLOCKS_PER_SEC;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Open a counter for each hardware event in *psCounters, counting
+   this process in user mode only, on whichever CPU it runs. Events
+   the kernel does not permit or the CPU lacks are left out, and if
+   none can be counted, say so on stderr. The counters start
+   disabled. */
+
+static void openCounters(struct Counters *psCounters)
+{
+   int iOpened = 0;
+   int i;
+#ifdef __linux__
+   /* the type and config of each event, in the order of aiFds */
+   static const uint32_t auTypes[EVENT_COUNT] =
+      {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+       PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+   static const uint64_t auConfigs[EVENT_COUNT] =
+      {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+       PERF_COUNT_HW_CACHE_L1D
+          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+       PERF_COUNT_HW_CACHE_MISSES,
+       PERF_COUNT_HW_CACHE_DTLB
+          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+       PERF_COUNT_HW_BRANCH_MISSES};
+   struct perf_event_attr sAttr;
+
+   for (i = 0; i < EVENT_COUNT; i++)
+   {
+      memset(&sAttr, 0, sizeof(sAttr));
+      sAttr.size = sizeof(sAttr);
+      sAttr.type = auTypes[i];
+      sAttr.config = auConfigs[i];
+      sAttr.disabled = 1;
+      sAttr.exclude_kernel = 1;
+      sAttr.exclude_hv = 1;
+      /* the CPU may have fewer counters than events, then the kernel
+         takes turns and the counts are scaled up by the times */
+      sAttr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+         | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      psCounters->aiFds[i] = (int)syscall(SYS_perf_event_open, &sAttr,
+         0, -1, -1, 0);
+      if (psCounters->aiFds[i] >= 0)
+         iOpened = 1;
+   }
+#else
+   for (i = 0; i < EVENT_COUNT; i++)
+      psCounters->aiFds[i] = -1;
+#endif
+   if (! iOpened)
+      fprintf(stderr, "Hardware counters are not available, only "
+         "times are measured\n");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Reset and enable the counters in *psCounters, at the start of a
+   phase. */
+
+static void startCounters(struct Counters *psCounters)
+{
+   int i;
+
+   for (i = 0; i < EVENT_COUNT; i++)
+   {
+      if (psCounters->aiFds[i] < 0)
+         continue;
+#ifdef __linux__
+      ioctl(psCounters->aiFds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(psCounters->aiFds[i], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Disable the counters in *psCounters at the end of a phase of uOps
+   operations, and write the count of each event per operation to
+   stdout, or n/a for events that were not counted. Write nothing if
+   no event was counted. */
+
+static void stopCounters(struct Counters *psCounters, size_t uOps)
+{
+   /* the count, time enabled and time running of one event */
+   uint64_t auValues[3];
+   double adPerOp[EVENT_COUNT];
+   int aiCounted[EVENT_COUNT];
+   int iAny = 0;
+   int i;
+
+   for (i = 0; i < EVENT_COUNT; i++)
+   {
+      aiCounted[i] = 0;
+      if (psCounters->aiFds[i] < 0)
+         continue;
+#ifdef __linux__
+      ioctl(psCounters->aiFds[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(psCounters->aiFds[i], auValues, sizeof(auValues))
+         != (ssize_t)sizeof(auValues) || auValues[2] == 0)
+         continue;
+      adPerOp[i] = (double)auValues[0] * ((double)auValues[1]
+         / (double)auValues[2]) / (double)(uOps > 0 ? uOps : 1);
+      aiCounted[i] = 1;
+      iAny = 1;
+#endif
+   }
+   if (! iAny)
+      return;
+
+   printf("       ");
+   for (i = 0; i < EVENT_COUNT; i++)
+   {
+      if (aiCounted[i])
+         printf(" %.2f %s", adPerOp[i], apcEventNames[i]);
+      else
+         printf(" n/a %s", apcEventNames[i]);
+   }
+   printf(" per op\n");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Close the counters in *psCounters. */
+
+static void closeCounters(struct Counters *psCounters)
+{
+   int i;
+
+   for (i = 0; i < EVENT_COUNT; i++)
+   {
+      if (psCounters->aiFds[i] < 0)
+         continue;
+#ifdef __linux__
+      close(psCounters->aiFds[i]);
+#endif
+      psCounters->aiFds[i] = -1;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding with key pcKey and value pvValue in the size_t
+   pvCount, for the map phase. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvCount)
+{
+   (*(size_t*)pvCount)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate uSize bytes with malloc and count them in the struct Usage
+   pvUsage. */
+
+static void *countingAlloc(size_t uSize, void *pvUsage)
+{
+   struct Usage *psUsage = (struct Usage*)pvUsage;
+
+   psUsage->uBytes += uSize;
+   psUsage->uBlocks++;
+   return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the block pvBlock of uSize bytes and take it off the struct
+   Usage pvUsage. */
+
+static void countingFree(void *pvBlock, size_t uSize, void *pvUsage)
+{
+   struct Usage *psUsage = (struct Usage*)pvUsage;
+
+   psUsage->uBytes -= uSize;
+   psUsage->uBlocks--;
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Time uLookupCount random lookups of the keys in pcKeys, of which
+   the even ones among the first 2 * uBindingCount are bound, in the
+   SymTableFrozen oFrozen made from the benchmarked SymTable. */
+
+static void benchFrozen(SymTableFrozen_T oFrozen, const char *pcKeys,
+   size_t uBindingCount, size_t uLookupCount)
+{
+   size_t uState = 1;
+   size_t uFound = 0;
+   size_t u;
+   clock_t iStart;
+   clock_t iEnd;
+
+   iStart = clock();
+   for (u = 0; u < uLookupCount && uBindingCount > 0; u++)
+   {
+      if (SymTableFrozen_get(oFrozen, pcKeys
+         + nextRandom(&uState) % (2 * uBindingCount) * KEY_STRIDE)
+         != NULL)
+         uFound++;
+   }
+   iEnd = clock();
+   printf("frozen: %10.3f s for %lu lookups, %lu found\n",
+      seconds(iStart, iEnd), (unsigned long)uLookupCount,
+      (unsigned long)uFound);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Parse the option pcOption into *psOptions. Return 1 if it is one
+   of the known options and 0 otherwise. */
+
+static int parseOption(const char *pcOption, struct Options *psOptions)
+{
+   if (strcmp(pcOption, "arena") == 0)
+      psOptions->iFlags |= SYMTABLE_ARENA;
+   else if (strcmp(pcOption, "hardened") == 0)
+      psOptions->iFlags |= SYMTABLE_HARDENED;
+   else if (strcmp(pcOption, "hugepages") == 0)
+      psOptions->iFlags |= SYMTABLE_HUGEPAGES;
+   else if (strcmp(pcOption, "filter") == 0)
+      psOptions->iFilter = 1;
+   else if (strcmp(pcOption, "frozen") == 0)
+      psOptions->iFrozen = 1;
+   else if (strcmp(pcOption, "perf") == 0)
+      psOptions->iPerf = 1;
+   else
+      return 0;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Benchmark a SymTable object made with the options argv[3] and on.
+   argv[1] is the number of bindings to put into it, argv[2] the number
+   of lookups to time for keys it contains and again for keys it does
+   not, in random order. Then map over the bindings, remove half of
+   them and free the SymTable. Write the CPU time of each phase to
+   stdout. With the perf option, also write the cycles, instructions,
+   L1 data cache, last level cache and data TLB misses and branch 
+   misses per operation of each phase, as far as the kernel lets this
+   process count them. With the frozen option, also write the bytes
+   per key the SymTable asked for and those a SymTableFrozen made from
+   it takes, and time the same lookups in the SymTableFrozen. Malloc
+   adds its own header to each block the SymTable asked for, about 8
+   to 16 bytes. Exit with EXIT_FAILURE if the arguments are bad or there
+   is not enough memory. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   SymTable_T oSymTable;
+   SymTableFrozen_T oFrozen;
+   struct Options sOptions = {0, 0, 0, 0};
+   struct Counters sCounters;
+   struct SymTable_Allocator sAllocator;
+   struct Usage sUsage = {0, 0};
+   char *pcKeys;
+   unsigned long ulBindingCount;
+   unsigned long ulLookupCount;
+   size_t uBindingCount;
+   size_t uLookupCount;
+   size_t uState = 1;
+   size_t uFound = 0;
+   size_t uRemoved = 0;
+   size_t u;
+   clock_t iStart;
+   clock_t iEnd;
+   int i;
+
+   if (argc < 3 || sscanf(argv[1], "%lu", &ulBindingCount) != 1
+      || sscanf(argv[2], "%lu", &ulLookupCount) != 1)
+   {
+      fprintf(stderr, "Usage: %s bindingcount lookupcount "
+         "[arena] [hardened] [hugepages] [filter] [frozen] [perf]\n",
+         argv[0]);
+      exit(EXIT_FAILURE);
+   }
+   uBindingCount = (size_t)ulBindingCount;
+   uLookupCount = (size_t)ulLookupCount;
+   for (i = 3; i < argc; i++)
+   {
+      if (! parseOption(argv[i], &sOptions))
+      {
+         fprintf(stderr, "Unknown option %s\n", argv[i]);
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   /* Keys 0 to 2 * uBindingCount - 1 are made up front, so that
+      making them is not timed, and only the even ones are put. */
+   pcKeys = (char*)malloc(2 * uBindingCount * KEY_STRIDE + 1);
+   if (pcKeys == NULL)
+   {
+      fprintf(stderr, "Not enough memory for the keys\n");
+      exit(EXIT_FAILURE);
+   }
+   for (u = 0; u < 2 * uBindingCount; u++)
+      sprintf(pcKeys + u * KEY_STRIDE, "%lu", (unsigned long)u);
+
+   for (i = 0; i < EVENT_COUNT; i++)
+      sCounters.aiFds[i] = -1;
+   if (sOptions.iPerf)
+      openCounters(&sCounters);
+
+   sAllocator.pfAlloc = countingAlloc;
+   sAllocator.pfFree = countingFree;
+   sAllocator.pvContext = &sUsage;
+   oSymTable = SymTable_newWithAllocator(
+      sOptions.iFrozen ? &sAllocator : NULL, sOptions.iFlags);
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "Not enough memory for the SymTable\n");
+      exit(EXIT_FAILURE);
+   }
+   if (sOptions.iFilter)
+      (void)SymTable_setFilter(oSymTable, 1);
+
+   startCounters(&sCounters);
+   iStart = clock();
+   for (u = 0; u < uBindingCount; u++)
+   {
+      if (! SymTable_put(oSymTable, pcKeys + 2 * u * KEY_STRIDE,
+         pcKeys))
+      {
+         fprintf(stderr, "Not enough memory for the bindings\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   iEnd = clock();
+   printf("put:    %10.3f s for %lu bindings\n", seconds(iStart, iEnd),
+      (unsigned long)uBindingCount);
+   stopCounters(&sCounters, uBindingCount);
+
+   startCounters(&sCounters);
+   iStart = clock();
+   for (u = 0; u < uLookupCount && uBindingCount > 0; u++)
+   {
+      if (SymTable_get(oSymTable, pcKeys
+         + nextRandom(&uState) % uBindingCount * 2 * KEY_STRIDE)
+         != NULL)
+         uFound++;
+   }
+   iEnd = clock();
+   printf("hit:    %10.3f s for %lu lookups, %lu found\n",
+      seconds(iStart, iEnd), (unsigned long)uLookupCount,
+      (unsigned long)uFound);
+   stopCounters(&sCounters, uLookupCount);
+
+   uFound = 0;
+   startCounters(&sCounters);
+   iStart = clock();
+   for (u = 0; u < uLookupCount && uBindingCount > 0; u++)
+   {
+      if (SymTable_get(oSymTable, pcKeys
+         + (nextRandom(&uState) % uBindingCount * 2 + 1) * KEY_STRIDE)
+         != NULL)
+         uFound++;
+   }
+   iEnd = clock();
+   printf("miss:   %10.3f s for %lu lookups, %lu found\n",
+      seconds(iStart, iEnd), (unsigned long)uLookupCount,
+      (unsigned long)uFound);
+   stopCounters(&sCounters, uLookupCount);
+
+   uFound = 0;
+   startCounters(&sCounters);
+   iStart = clock();
+   SymTable_map(oSymTable, countBinding, &uFound);
+   iEnd = clock();
+   printf("map:    %10.3f s for %lu bindings\n", seconds(iStart, iEnd),
+      (unsigned long)uFound);
+   stopCounters(&sCounters, uFound);
+
+   if (sOptions.iFrozen && uBindingCount > 0)
+   {
+      oFrozen = SymTableFrozen_new(oSymTable);
+      if (oFrozen == NULL)
+      {
+         fprintf(stderr, "Not enough memory for the SymTableFrozen\n");
+         exit(EXIT_FAILURE);
+      }
+      printf("memory: %10.1f bytes per key in %lu blocks, frozen "
+         "%.1f\n", (double)sUsage.uBytes / (double)uBindingCount,
+         (unsigned long)sUsage.uBlocks,
+         (double)SymTableFrozen_getSize(oFrozen)
+         / (double)uBindingCount);
+      benchFrozen(oFrozen, pcKeys, uBindingCount, uLookupCount);
+      SymTableFrozen_free(oFrozen);
+   }
+
+   /* Every other binding is removed, so that freeing still has
+      bindings to visit. */
+   startCounters(&sCounters);
+   iStart = clock();
+   for (u = 0; u < uBindingCount; u += 2)
+   {
+      if (SymTable_remove(oSymTable, pcKeys + 2 * u * KEY_STRIDE)
+         != NULL)
+         uRemoved++;
+   }
+   iEnd = clock();
+   printf("remove: %10.3f s for %lu bindings\n",
+      seconds(iStart, iEnd), (unsigned long)uRemoved);
+   stopCounters(&sCounters, uRemoved);
+
+   iStart = clock();
+   SymTable_free(oSymTable);
+   iEnd = clock();
+   printf("free:   %10.3f s\n", seconds(iStart, iEnd));
+
+   closeCounters(&sCounters);
+   free(pcKeys);
+   return 0;
+}
@@ -0,0 +1,164 @@
+/*--------------------------------------------------------------------*/
+/* symatom.c                                                          */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symatom.h"
+
+/* Constant array of the bucket counts of the pool, as in symset.c */
+static const size_t BUCKETSIZE[] = {509, 1021, 2039, 4093, 8191,
+16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143,
+4194301, 8388593, 16777213, 33554393, 67108859};
+/* Constant with the number of bucket counts */
+static const size_t BUCKETCOUNT =
+sizeof(BUCKETSIZE)/sizeof(BUCKETSIZE[0]);
+
+/* SymAtom is one string of the pool, allocated with room for its
+characters after it */
+struct SymAtom
+{
+   /* the next SymAtom in the chain */
+   struct SymAtom *psNext;
+   /* the hash code of the string */
+   size_t uHash;
+   /* the string */
+   char acString[];
+};
+
+/* The pool: its lock, the number of SymAtoms, the index of the number
+of buckets in BUCKETSIZE, and the buckets, NULL until the first
+SymAtom */
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t uPoolSize = 0;
+static size_t uPoolBucketCount = 0;
+static struct SymAtom **ppsPoolBuckets = NULL;
+
+/* Return the hash code of pcString and store its length in 
+*puLength */
+static size_t SymAtom_hashString(const char *pcString, 
+size_t *puLength)
+{
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcString != NULL);
+   assert(puLength != NULL);
+
+   for (u = 0; pcString[u] != '\0'; u++)
+      uHash = uHash * 65599 + (size_t)pcString[u];
+
+   *puLength = u;
+   return uHash;
+}
+
+/* Move the SymAtoms of the pool to the next larger bucket array, if
+there is one and enough memory for it, otherwise keep the buckets. The
+pool must be locked */
+static void SymAtom_grow(void)
+{
+   struct SymAtom **ppsBuckets;
+   struct SymAtom *psAtom;
+   struct SymAtom *psNext;
+   size_t uBuckets;
+   size_t u;
+
+   if (uPoolBucketCount == BUCKETCOUNT - 1) return;
+
+   uBuckets = BUCKETSIZE[uPoolBucketCount + 1];
+   ppsBuckets = (struct SymAtom**)calloc(uBuckets,
+   sizeof(struct SymAtom*));
+   if (ppsBuckets == NULL) return;
+
+   for (u = 0; u < BUCKETSIZE[uPoolBucketCount]; u++) {
+      for (psAtom = ppsPoolBuckets[u]; psAtom != NULL; 
+      psAtom = psNext) {
+         psNext = psAtom->psNext;
+         psAtom->psNext = ppsBuckets[psAtom->uHash % uBuckets];
+         ppsBuckets[psAtom->uHash % uBuckets] = psAtom;
+      }
+   }
+
+   free(ppsPoolBuckets);
+   ppsPoolBuckets = ppsBuckets;
+   uPoolBucketCount++;
+}
+
+/* Return the SymAtom of pcString, whose hash code is uHash and length
+uLength, adding it to the pool if it is not there yet, or NULL if there
+is not enough memory. The pool must be locked */
+static SymAtom_T SymAtom_find(const char *pcString, size_t uHash,
+size_t uLength)
+{
+   struct SymAtom **ppsLink;
+   struct SymAtom *psAtom;
+
+   if (ppsPoolBuckets == NULL) {
+      ppsPoolBuckets = (struct SymAtom**)calloc(BUCKETSIZE[0],
+      sizeof(struct SymAtom*));
+      if (ppsPoolBuckets == NULL) return NULL;
+   }
+
+   ppsLink = &ppsPoolBuckets[uHash % BUCKETSIZE[uPoolBucketCount]];
+   for (psAtom = *ppsLink; psAtom != NULL; psAtom = psAtom->psNext) {
+      if (psAtom->uHash == uHash && !strcmp(psAtom->acString, pcString))
+         return psAtom;
+   }
+
+   psAtom = (struct SymAtom*)malloc(
+   offsetof(struct SymAtom, acString) + uLength + 1);
+   if (psAtom == NULL) return NULL;
+
+   psAtom->uHash = uHash;
+   memcpy(psAtom->acString, pcString, uLength + 1);
+   psAtom->psNext = *ppsLink;
+   *ppsLink = psAtom;
+
+   uPoolSize++;
+   if (uPoolSize > BUCKETSIZE[uPoolBucketCount]) SymAtom_grow();
+   return psAtom;
+}
+
+SymAtom_T SymAtom_intern(const char *pcString) {
+   SymAtom_T oAtom;
+   size_t uHash, uLength;
+
+   assert(pcString != NULL);
+
+   /* hash before taking the lock, so that threads wait less */
+   uHash = SymAtom_hashString(pcString, &uLength);
+
+   pthread_mutex_lock(&poolLock);
+   oAtom = SymAtom_find(pcString, uHash, uLength);
+   pthread_mutex_unlock(&poolLock);
+
+   return oAtom;
+}
+
+const char *SymAtom_string(SymAtom_T oAtom) {
+   assert(oAtom != NULL);
+
+   return oAtom->acString;
+}
+
+size_t SymAtom_hash(SymAtom_T oAtom) {
+   assert(oAtom != NULL);
+
+   return oAtom->uHash;
+}
+
+SymKey_T SymKey_make(const char *pcKey) {
+   SymKey_T sKey;
+   size_t uLength;
+
+   assert(pcKey != NULL);
+
+   sKey.pcKey = pcKey;
+   sKey.uHash = SymAtom_hashString(pcKey, &uLength);
+   return sKey;
+}
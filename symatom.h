@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------*/
+/* symatom.h                                                          */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMATOM_INCLUDED
+#define SYMATOM_INCLUDED
+
+#include <stddef.h>
+
+/* Define type SymAtom_T to be a pointer towards a SymAtom, the one
+canonical copy of a string in a pool shared by the whole process. Two
+SymAtoms are equal exactly when they are the same pointer. SymAtoms
+are never freed */
+typedef struct SymAtom *SymAtom_T;
+
+/* Return the SymAtom of pcString, adding a copy of pcString to the
+pool if it is not there yet, or NULL if there is not enough memory.
+Safe to call from several threads at once */
+SymAtom_T SymAtom_intern(const char *pcString);
+
+/* Return the string of oAtom, which stays valid until the process
+ends */
+const char *SymAtom_string(SymAtom_T oAtom);
+
+/* Return the hash code of the string of oAtom, computed once when it
+was interned. It is the hash code that SymTables compute for their
+keys when they are not hardened, before any mixing */
+size_t SymAtom_hash(SymAtom_T oAtom);
+
+/* SymKey_T is a key hashed once, for callers that look the same key
+up in many SymTables or many times: pcKey is the key itself, which is
+not copied and must outlive the SymKey, and uHash its hash code, the
+same one SymAtom_hash gives. A SymKey is a small value, passed and
+returned by value and never freed */
+typedef struct SymKey
+{
+    const char *pcKey;
+    size_t uHash;
+} SymKey_T;
+
+/* Return the SymKey of pcKey */
+SymKey_T SymKey_make(const char *pcKey);
+
+#endif
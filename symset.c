@@ -0,0 +1,271 @@
+/*--------------------------------------------------------------------*/
+/* symset.c                                                           */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symset.h"
+
+/* Constant array of the bucket counts, the first ones are those of
+symtablehash.c, the rest let large sets keep short chains */
+static const size_t BUCKETSIZE[] = {509, 1021, 2039, 4093, 8191,
+16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143,
+4194301, 8388593, 16777213, 33554393, 67108859};
+/* Constant with the number of bucket counts */
+static const size_t BUCKETCOUNT =
+sizeof(BUCKETSIZE)/sizeof(BUCKETSIZE[0]);
+
+/* SSElement is an element of a SymSet, allocated with room for its
+key after it */
+struct SSElement
+{
+   /* the next element in the chain */
+   struct SSElement *psNext;
+   /* the hash code of the key */
+   size_t uHash;
+   /* the key */
+   char acKey[];
+};
+
+/* SymSet is the structure for a SymSet that contains its size and the
+array of separate chaining linked lists */
+struct SymSet
+{
+   /* the number of elements */
+   size_t size;
+   /* the index of the number of buckets in BUCKETSIZE */
+   size_t bucketCount;
+   /* the number of buckets */
+   size_t uBuckets;
+   /* the buckets */
+   struct SSElement **ppsBuckets;
+};
+
+/* Return the hash code of pcKey */
+static size_t SymSet_hash(const char *pcKey)
+{
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * 65599 + (size_t)pcKey[u];
+
+   return uHash;
+}
+
+/* Return the link to the element of oSymSet whose key is pcKey, with
+hash code uHash, or the link at the end of its chain if there is
+none */
+static struct SSElement **SymSet_find(SymSet_T oSymSet,
+const char *pcKey, size_t uHash)
+{
+   struct SSElement **ppsLink;
+
+   ppsLink = &oSymSet->ppsBuckets[uHash % oSymSet->uBuckets];
+   while (*ppsLink != NULL && ((*ppsLink)->uHash != uHash
+   || strcmp((*ppsLink)->acKey, pcKey) != 0))
+      ppsLink = &(*ppsLink)->psNext;
+
+   return ppsLink;
+}
+
+/* Move the elements of oSymSet to the next larger bucket array, if
+there is one and enough memory for it, otherwise keep the buckets */
+static void SymSet_grow(SymSet_T oSymSet)
+{
+   struct SSElement **ppsBuckets;
+   struct SSElement *psElement;
+   struct SSElement *psNext;
+   size_t uBuckets;
+   size_t u;
+
+   if (oSymSet->bucketCount == BUCKETCOUNT - 1) return;
+
+   uBuckets = BUCKETSIZE[oSymSet->bucketCount + 1];
+   ppsBuckets = (struct SSElement**)calloc(uBuckets,
+   sizeof(struct SSElement*));
+   if (ppsBuckets == NULL) return;
+
+   /* the hash codes are kept, so no key is hashed again */
+   for (u = 0; u < oSymSet->uBuckets; u++) {
+      for (psElement = oSymSet->ppsBuckets[u]; psElement != NULL;
+      psElement = psNext) {
+         psNext = psElement->psNext;
+         psElement->psNext = ppsBuckets[psElement->uHash % uBuckets];
+         ppsBuckets[psElement->uHash % uBuckets] = psElement;
+      }
+   }
+
+   free(oSymSet->ppsBuckets);
+   oSymSet->ppsBuckets = ppsBuckets;
+   oSymSet->uBuckets = uBuckets;
+   oSymSet->bucketCount++;
+}
+
+/* Add a copy of pcKey, with hash code uHash, to oSymSet at the end of
+the chain whose last link is *ppsLink. Returns 1 on success or 0 if
+there is not enough memory */
+static int SymSet_insert(SymSet_T oSymSet, struct SSElement **ppsLink,
+const char *pcKey, size_t uHash)
+{
+   struct SSElement *psElement;
+   size_t uLength = strlen(pcKey);
+
+   psElement = (struct SSElement*)malloc(
+   offsetof(struct SSElement, acKey) + uLength + 1);
+   if (psElement == NULL) return 0;
+
+   psElement->psNext = NULL;
+   psElement->uHash = uHash;
+   memcpy(psElement->acKey, pcKey, uLength + 1);
+   *ppsLink = psElement;
+
+   oSymSet->size++;
+   if (oSymSet->size > oSymSet->uBuckets) SymSet_grow(oSymSet);
+   return 1;
+}
+
+SymSet_T SymSet_new(void) {
+   SymSet_T oSymSet;
+
+   oSymSet = (SymSet_T)malloc(sizeof(struct SymSet));
+   if (oSymSet == NULL) return NULL;
+
+   oSymSet->ppsBuckets = (struct SSElement**)calloc(BUCKETSIZE[0],
+   sizeof(struct SSElement*));
+   if (oSymSet->ppsBuckets == NULL) {
+      free(oSymSet);
+      return NULL;
+   }
+   oSymSet->size = 0;
+   oSymSet->bucketCount = 0;
+   oSymSet->uBuckets = BUCKETSIZE[0];
+   return oSymSet;
+}
+
+void SymSet_free(SymSet_T oSymSet) {
+   struct SSElement *psElement;
+   struct SSElement *psNext;
+   size_t u;
+
+   assert(oSymSet != NULL);
+
+   for (u = 0; u < oSymSet->uBuckets; u++) {
+      for (psElement = oSymSet->ppsBuckets[u]; psElement != NULL;
+      psElement = psNext) {
+         psNext = psElement->psNext;
+         free(psElement);
+      }
+   }
+   free(oSymSet->ppsBuckets);
+   free(oSymSet);
+}
+
+size_t SymSet_getLength(SymSet_T oSymSet) {
+   assert(oSymSet != NULL);
+
+   return oSymSet->size;
+}
+
+int SymSet_add(SymSet_T oSymSet, const char *pcKey) {
+   struct SSElement **ppsLink;
+   size_t uHash;
+
+   assert(oSymSet != NULL);
+   assert(pcKey != NULL);
+
+   uHash = SymSet_hash(pcKey);
+   ppsLink = SymSet_find(oSymSet, pcKey, uHash);
+   if (*ppsLink != NULL) return 0;
+
+   return SymSet_insert(oSymSet, ppsLink, pcKey, uHash);
+}
+
+int SymSet_contains(SymSet_T oSymSet, const char *pcKey) {
+   assert(oSymSet != NULL);
+   assert(pcKey != NULL);
+
+   return *SymSet_find(oSymSet, pcKey, SymSet_hash(pcKey)) != NULL;
+}
+
+int SymSet_remove(SymSet_T oSymSet, const char *pcKey) {
+   struct SSElement **ppsLink;
+   struct SSElement *psElement;
+
+   assert(oSymSet != NULL);
+   assert(pcKey != NULL);
+
+   ppsLink = SymSet_find(oSymSet, pcKey, SymSet_hash(pcKey));
+   psElement = *ppsLink;
+   if (psElement == NULL) return 0;
+
+   *ppsLink = psElement->psNext;
+   free(psElement);
+   oSymSet->size--;
+   return 1;
+}
+
+void SymSet_map(SymSet_T oSymSet,
+void (*pfApply)(const char *pcKey, void *pvExtra),
+const void *pvExtra) {
+   struct SSElement *psElement;
+   size_t u;
+
+   assert(oSymSet != NULL);
+   assert(pfApply != NULL);
+
+   for (u = 0; u < oSymSet->uBuckets; u++) {
+      for (psElement = oSymSet->ppsBuckets[u]; psElement != NULL;
+      psElement = psElement->psNext)
+         (*pfApply)(psElement->acKey, (void*)pvExtra);
+   }
+}
+
+int SymSet_union(SymSet_T oSymSet, SymSet_T oOther) {
+   struct SSElement **ppsLink;
+   struct SSElement *psElement;
+   size_t u;
+
+   assert(oSymSet != NULL);
+   assert(oOther != NULL);
+
+   if (oSymSet == oOther) return 1;
+
+   for (u = 0; u < oOther->uBuckets; u++) {
+      for (psElement = oOther->ppsBuckets[u]; psElement != NULL;
+      psElement = psElement->psNext) {
+         ppsLink = SymSet_find(oSymSet, psElement->acKey,
+         psElement->uHash);
+         if (*ppsLink == NULL && !SymSet_insert(oSymSet, ppsLink,
+         psElement->acKey, psElement->uHash)) return 0;
+      }
+   }
+   return 1;
+}
+
+void SymSet_intersect(SymSet_T oSymSet, SymSet_T oOther) {
+   struct SSElement **ppsLink;
+   struct SSElement *psElement;
+   size_t u;
+
+   assert(oSymSet != NULL);
+   assert(oOther != NULL);
+
+   for (u = 0; u < oSymSet->uBuckets; u++) {
+      ppsLink = &oSymSet->ppsBuckets[u];
+      while ((psElement = *ppsLink) != NULL) {
+         if (*SymSet_find(oOther, psElement->acKey, psElement->uHash)
+         != NULL) {
+            ppsLink = &psElement->psNext;
+            continue;
+         }
+         *ppsLink = psElement->psNext;
+         free(psElement);
+         oSymSet->size--;
+      }
+   }
+}
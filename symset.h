@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* symset.h                                                           */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMSET_INCLUDED
+#define SYMSET_INCLUDED
+
+#include <stddef.h>
+
+/* Define type SymSet_T to be a pointer towards a SymSet, a set of
+strings for membership tests. It is a hash table like the SymTable
+of symtablehash.c, but an element is a single block holding its chain
+link, its hash code and the characters of its key, with no value and
+no separate copy of the key */
+typedef struct SymSet *SymSet_T;
+
+/* Creates an empty SymSet and returns the pointer to it, or NULL if
+there is not enough memory */
+SymSet_T SymSet_new(void);
+
+/* Free the SymSet oSymSet and all of its elements */
+void SymSet_free(SymSet_T oSymSet);
+
+/* Return the number of elements in oSymSet */
+size_t SymSet_getLength(SymSet_T oSymSet);
+
+/* Add a copy of pcKey to oSymSet if it is not there yet. Returns 1 if
+it was added, 0 if it was already there or there is not enough
+memory */
+int SymSet_add(SymSet_T oSymSet, const char *pcKey);
+
+/* Return 1 if oSymSet contains pcKey, and 0 otherwise */
+int SymSet_contains(SymSet_T oSymSet, const char *pcKey);
+
+/* Remove pcKey from oSymSet. Returns 1 if it was there and 0
+otherwise */
+int SymSet_remove(SymSet_T oSymSet, const char *pcKey);
+
+/* Apply function pfApply to every element of oSymSet, passing
+pvExtra along */
+void SymSet_map(SymSet_T oSymSet,
+void (*pfApply)(const char *pcKey, void *pvExtra),
+const void *pvExtra);
+
+/* Add every element of oOther to oSymSet, which becomes their union.
+Returns 1 on success or 0 if there is not enough memory, in which case
+only some of the elements were added */
+int SymSet_union(SymSet_T oSymSet, SymSet_T oOther);
+
+/* Remove every element of oSymSet that is not in oOther, so that
+oSymSet becomes their intersection */
+void SymSet_intersect(SymSet_T oSymSet, SymSet_T oOther);
+
+#endif
@@ -7,18 +7,99 @@
 #define STACK_INCLUDED
 
 #include <stddef.h>
+#include "symatom.h"
 
 /* Define type SymTable_T to be a pointer towards a SymTable struct */
 typedef struct SymTable *SymTable_T;
 
+/* SymTable_Allocator supplies the memory of a SymTable: pfAlloc 
+returns a block of uSize bytes or NULL if there is none, and pfFree 
+gives back a block that pfAlloc returned, with the size it was asked 
+for. pvContext is passed along to both */
+struct SymTable_Allocator
+{
+    void *(*pfAlloc)(size_t uSize, void *pvContext);
+    void (*pfFree)(void *pvBlock, size_t uSize, void *pvContext);
+    void *pvContext;
+};
+
+/* Flags for SymTable_newWithAllocator. SYMTABLE_ARENA: memory is only
+given back by SymTable_free. SYMTABLE_HARDENED: the hash table seeds 
+its hash and keeps colliding lookups O(log n), the others ignore it. 
+SYMTABLE_HUGEPAGES: large blocks use huge pages where available.
+SYMTABLE_INTERNED: keys are stored as SymAtoms rather than copies */
+enum {SYMTABLE_ARENA = 1, SYMTABLE_HARDENED = 2, 
+    SYMTABLE_HUGEPAGES = 4, SYMTABLE_INTERNED = 8};
+
 /* Creates an empty SymTable and returns the pointer to it */
 SymTable_T SymTable_new(void);
 
+/* Creates an empty SymTable that takes all of its memory from 
+psAllocator, or from malloc and free if psAllocator is NULL, and 
+returns the pointer to it, or NULL if there is not enough memory. 
+iFlags is 0 or a combination of the flags above. In arena mode pfFree
+may be NULL, then the memory is never given back and SymTable_free
+takes constant time, for allocators that discard everything at once
+themselves */
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags);
+
+/* Creates an empty SymTable that stores a copy of the uValueSize bytes
+at each value, or zeros for NULL, and gives out pointers to its copies.
+Returns the pointer to it, or NULL if there is not enough memory or the
+implementation does not support it. A uValueSize of 0 gives an ordinary
+SymTable */
+SymTable_T SymTable_newSized(size_t uValueSize);
+
+/* Creates an empty SymTable that holds at most uMaxBindings bindings,
+for use as a cache in front of something slower, and returns the 
+pointer to it, or NULL if there is not enough memory or the 
+implementation does not support it. Once it is full, SymTable_put and 
+the other functions inserting a binding first evict one, passing its 
+key and value to pfEvict unless pfEvict is NULL, the key is freed 
+afterwards. The binding is chosen with the CLOCK policy: a lookup that
+finds a binding only marks it, without moving it, and a hand sweeping
+over the bindings clears the marks it passes and evicts the first 
+binding that was not marked since it last passed, in constant amortized
+time. The marks are the hit counts of SymTable_optimize. pfEvict must 
+not call back into the SymTable. uMaxBindings must not be 0 */
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue));
+
+/* Creates an empty SymTable like SymTable_new for a scope nested in 
+the scope of oParent and returns the pointer to it, or NULL if there is
+not enough memory. Only SymTable_lookupScoped looks past the child into
+oParent and its ancestors, the other functions see the bindings of the
+child alone, and freeing the child leaves oParent untouched. oParent 
+must outlive the child */
+SymTable_T SymTable_newChild(SymTable_T oParent);
+
 /* Free the SymTable associated with pointer oSymTable and all memory
 that it uses for its bindings (does not free memory allocated for 
 values) */
 void SymTable_free(SymTable_T oSymTable);
 
+/* Free oSymTable like SymTable_free, but on a background thread that
+frees its bindings in bounded chunks, so that the caller does not wait
+for it. Small tables, tables in arena mode, which are freed at once
+anyway, and tables with a custom allocator, which may not be safe to
+call from another thread, are freed before returning */
+void SymTable_freeAsync(SymTable_T oSymTable);
+
+/* Free oSymTable like SymTable_free, splitting its bindings into
+ranges that uThreads threads free at once, or one thread per processor
+if uThreads is 0. Falls back to SymTable_free where SymTable_freeAsync
+would, and for the linked list, which cannot be split */
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads);
+
+/* Remove every binding from oSymTable, calling pfFreeValue on each
+value unless pfFreeValue is NULL. Unlike SymTable_free followed by 
+SymTable_new, the buckets and nodes of oSymTable are kept and reused by
+later bindings. In arena mode the memory of the keys is only given back
+by SymTable_free */
+void SymTable_clear(SymTable_T oSymTable, 
+void (*pfFreeValue)(void *pvValue));
+
 /* Returns the number of bindings in oSymTable */
 size_t SymTable_getLength(SymTable_T oSymTable);
 
@@ -28,6 +109,24 @@ oSymtable and returns 1, otherwise does nothing and return 0 */
 int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
 const void *pvValue);
 
+/* If oSymTable does not already have a binding with key pcKey, inserts
+a new binding with key pcKey and value pvValue and returns 1, otherwise
+replaces the value of that binding with pvValue and returns 0. The old
+value is stored in *ppvOld, or NULL if there was none, when ppvOld is 
+not NULL. Returns -1 if there is not enough memory for a new binding */
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void **ppvOld);
+
+/* Stores in *pppvSlot a pointer to the value of the binding with key
+pcKey in oSymTable, first inserting a binding with key pcKey and value
+pvValue if there is none. Returns 1 if a binding was inserted, 0 if it
+already existed, or -1 (with *pppvSlot set to NULL) if there is not
+enough memory. The value can be read and updated in place through
+*pppvSlot until the next call that puts or removes a binding in
+oSymTable */
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void ***pppvSlot);
+
 /* If oSymTable has binding with key pcKey, replace the value of the
 binding with pvValue and return the pointer to the old value, otherwise
 does nothing and returns NULL */
@@ -42,15 +141,121 @@ int SymTable_contains(SymTable_T oSymTable, const char *pcKey);
 returns NULL if there is no such binding in oSymTable */
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey);
 
+/* Returns the pointer to the value of the binding with key pcKey in 
+oSymTable or else in the nearest of its ancestors that has one, 
+returns NULL if none of them has such a binding. pcKey is hashed once
+for the whole chain wherever the SymTables hash keys the same way */
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey);
+
+/* Like SymTable_put with the string of oAtom as key, but reusing the
+hash code of oAtom where oSymTable hashes keys the same way, and
+storing oAtom itself rather than a copy of its string in an interned
+SymTable */
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue);
+
+/* Like SymTable_get with the string of oAtom as key, but reusing the
+hash code of oAtom where oSymTable hashes keys the same way, and 
+comparing keys by pointer in an interned SymTable */
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom);
+
+/* Like SymTable_put, SymTable_get, SymTable_contains and 
+SymTable_remove with the key of sKey, but taking its hash code from 
+sKey rather than hashing the key again wherever oSymTable hashes keys 
+the same way, which all SymTables do except hardened hash tables. One
+SymKey serves any number of lookups in any number of SymTables */
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue);
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey);
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey);
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey);
+
 /* Removes binding with key pcKey and returns the pointer to the 
 value of the removed binding, returns NULL if there is no such
 binding in oSymTable */
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 
+/* Policies for SymTable_setReorder: with SYMTABLE_REORDER_NONE lookups
+leave the table untouched, with SYMTABLE_REORDER_COUNT they count hits
+for SymTable_optimize, and with SYMTABLE_REORDER_MOVE_TO_FRONT and
+SYMTABLE_REORDER_TRANSPOSE they also move each binding they find to the
+front of its chain or one place closer to it */
+enum {SYMTABLE_REORDER_NONE, SYMTABLE_REORDER_COUNT,
+    SYMTABLE_REORDER_MOVE_TO_FRONT, SYMTABLE_REORDER_TRANSPOSE};
+
+/* Set the policy that SymTable_get, SymTable_contains and 
+SymTable_replace follow when they find a binding in oSymTable to 
+iReorder, one of the SYMTABLE_REORDER_* values. Returns 1 if the
+implementation supports iReorder and 0 otherwise. New SymTables use
+SYMTABLE_REORDER_NONE */
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder);
+
+/* Sort the bindings of oSymTable so that the ones found most often
+since the last call are checked first, then halve their hit counts so
+that later calls adapt to changes in popularity. Hits are only counted
+while the policy of oSymTable is not SYMTABLE_REORDER_NONE */
+void SymTable_optimize(SymTable_T oSymTable);
+
+/* Turn the filter of oSymTable on if iEnable is not 0 and off 
+otherwise. While it is on, a blocked Bloom filter over the hash codes
+of the keys answers most lookups of absent keys from a single cache
+line, for about 10 bits per binding and a little more work in puts and
+removes. Returns 1 if the implementation supports the filter and 0 
+otherwise. New SymTables have it off */
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable);
+
 /* Apply function pfApply to every binding in oSymTable that applies
 some constant pvExtra to each key-value pair */
 void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
     const void *pvExtra);
 
+/* Like SymTable_map, but pass the bindings of oSymTable to 
+pfApplyBatch in batches: ppcKeys and ppvValues are parallel arrays of
+the keys and values of uCount bindings, uCount being at most 
+uBatchSize, so that pfApplyBatch can run tight loops over a whole 
+batch rather than be called once per binding. The arrays are only 
+valid during the call. Batches may be shorter than uBatchSize when 
+there is not enough memory for arrays of more than 256 bindings */
+void SymTable_mapBatch(SymTable_T oSymTable,
+    void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+    size_t uCount, void *pvExtra),
+    const void *pvExtra, size_t uBatchSize);
+
+/* Put a binding into oSymTable for every binding of oOther whose key
+it does not have yet. For a key bound in both, the value in oSymTable
+becomes pfResolve(pcKey, pvValue, pvOtherValue, pvExtra), with pvValue
+and pvOtherValue its values in oSymTable and oOther, or pvOtherValue
+if pfResolve is NULL. oOther is left unchanged and must be another
+SymTable of the same implementation, holding the same kind of values.
+Returns 1 on success or 0 if there is not enough memory, in which case
+only some of the bindings of oOther were merged. When both tables hash
+keys the same way and have as many buckets, keys are not hashed
+again */
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+    void *(*pfResolve)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    const void *pvExtra);
+
+/* Remove from oSymTable every binding whose key is not bound in
+oOther, calling pfFreeValue on its value unless pfFreeValue is NULL.
+The value of each binding that stays becomes pfResolve(pcKey, pvValue,
+pvOtherValue, pvExtra) unless pfResolve is NULL. oOther is as for
+SymTable_merge */
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+    void *(*pfResolve)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    void (*pfFreeValue)(void *pvValue), const void *pvExtra);
+
+/* Remove from oSymTable every binding whose key is bound in oOther,
+calling pfFreeValue on its value unless pfFreeValue is NULL, but keep
+those for which pfKeep(pcKey, pvValue, pvOtherValue, pvExtra) returns
+non-zero if pfKeep is not NULL. With a pfKeep comparing the values,
+what stays in oSymTable is what it adds to or changes in oOther.
+oOther is as for SymTable_merge */
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+    int (*pfKeep)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    void (*pfFreeValue)(void *pvValue), const void *pvExtra);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*--------------------------------------------------------------------*/
+/* symtablebatch.c                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include "symtablebatch.h"
+
+void STBatch_init(struct STBatch *psBatch,
+void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+size_t uCount, void *pvExtra),
+const void *pvExtra, size_t uBatchSize, struct STMemory *psMemory)
+{
+   assert(psBatch != NULL);
+   assert(pfApplyBatch != NULL);
+   assert(uBatchSize > 0);
+   assert(psMemory != NULL);
+
+   psBatch->pfApplyBatch = pfApplyBatch;
+   psBatch->pvExtra = (void*)pvExtra;
+   psBatch->uCount = 0;
+   psBatch->ppcKeys = psBatch->apcLocalKeys;
+   psBatch->ppvValues = psBatch->apvLocalValues;
+   psBatch->uSize = (uBatchSize < STBATCH_LOCAL) ? 
+   uBatchSize : STBATCH_LOCAL;
+   psBatch->psMemory = NULL;
+
+   /* an arena would keep the arrays until the SymTable is freed */
+   if (uBatchSize <= STBATCH_LOCAL || psMemory->iArena) return;
+
+   psBatch->ppcKeys = (const char**)STMemory_alloc(psMemory,
+   uBatchSize * sizeof(const char*));
+   psBatch->ppvValues = (void**)STMemory_alloc(psMemory,
+   uBatchSize * sizeof(void*));
+   if (psBatch->ppcKeys == NULL || psBatch->ppvValues == NULL) {
+      STMemory_free(psMemory, (void*)psBatch->ppcKeys,
+      uBatchSize * sizeof(const char*));
+      STMemory_free(psMemory, psBatch->ppvValues,
+      uBatchSize * sizeof(void*));
+      psBatch->ppcKeys = psBatch->apcLocalKeys;
+      psBatch->ppvValues = psBatch->apvLocalValues;
+      return;
+   }
+   psBatch->uSize = uBatchSize;
+   psBatch->psMemory = psMemory;
+}
+
+void STBatch_add(struct STBatch *psBatch, const char *pcKey,
+void *pvValue)
+{
+   assert(psBatch != NULL);
+   assert(psBatch->uCount < psBatch->uSize);
+
+   psBatch->ppcKeys[psBatch->uCount] = pcKey;
+   psBatch->ppvValues[psBatch->uCount] = pvValue;
+   if (++psBatch->uCount < psBatch->uSize) return;
+
+   (*psBatch->pfApplyBatch)(psBatch->ppcKeys, psBatch->ppvValues,
+   psBatch->uCount, psBatch->pvExtra);
+   psBatch->uCount = 0;
+}
+
+void STBatch_finish(struct STBatch *psBatch)
+{
+   assert(psBatch != NULL);
+
+   if (psBatch->uCount > 0) {
+      (*psBatch->pfApplyBatch)(psBatch->ppcKeys, psBatch->ppvValues,
+      psBatch->uCount, psBatch->pvExtra);
+      psBatch->uCount = 0;
+   }
+
+   if (psBatch->psMemory != NULL) {
+      STMemory_free(psBatch->psMemory, (void*)psBatch->ppcKeys,
+      psBatch->uSize * sizeof(const char*));
+      STMemory_free(psBatch->psMemory, psBatch->ppvValues,
+      psBatch->uSize * sizeof(void*));
+      psBatch->psMemory = NULL;
+   }
+}
@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* symtablebatch.h                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEBATCH_INCLUDED
+#define SYMTABLEBATCH_INCLUDED
+
+#include <stddef.h>
+#include "symtablememory.h"
+
+/* Number of bindings an STBatch holds without allocating */
+enum {STBATCH_LOCAL = 256};
+
+/* STBatch collects the bindings visited by SymTable_mapBatch into
+parallel arrays of keys and values and hands them to the callback
+whenever the arrays are full */
+struct STBatch
+{
+   /* the callback and its extra argument */
+   void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra);
+   void *pvExtra;
+   /* the keys and values collected so far */
+   const char **ppcKeys;
+   void **ppvValues;
+   /* the number of bindings collected and the most the arrays hold */
+   size_t uCount;
+   size_t uSize;
+   /* the memory the arrays came from, NULL if they are the local
+   ones */
+   struct STMemory *psMemory;
+   /* the arrays for batches of up to STBATCH_LOCAL bindings */
+   const char *apcLocalKeys[STBATCH_LOCAL];
+   void *apvLocalValues[STBATCH_LOCAL];
+};
+
+/* Set up psBatch to pass batches of up to uBatchSize bindings to
+pfApplyBatch along with pvExtra. Arrays for batches larger than
+STBATCH_LOCAL come from psMemory unless it is an arena, without them
+the batches are only STBATCH_LOCAL bindings long */
+void STBatch_init(struct STBatch *psBatch,
+void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+size_t uCount, void *pvExtra),
+const void *pvExtra, size_t uBatchSize, struct STMemory *psMemory);
+
+/* Add the binding with key pcKey and value pvValue to psBatch, passing
+the batch on if it is full */
+void STBatch_add(struct STBatch *psBatch, const char *pcKey,
+void *pvValue);
+
+/* Pass on the bindings left in psBatch and give back its arrays */
+void STBatch_finish(struct STBatch *psBatch);
+
+#endif
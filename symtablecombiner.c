@@ -0,0 +1,217 @@
+/*--------------------------------------------------------------------*/
+/* symtablecombiner.c                                                 */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "symtablecombiner.h"
+
+/* Alignment of slots, the size of a cache line */
+enum {LINE_SIZE = 64};
+
+/* Operations a thread publishes */
+enum {OP_PUT, OP_GET, OP_REMOVE};
+
+/* STCombinerSlot is where one thread publishes its operations, in a
+cache line of its own so that threads waiting on their slots do not
+disturb each other */
+struct STCombinerSlot
+{
+   /* 1 from when the thread published an operation until the
+   combiner posted its result, 0 otherwise */
+   int iPending;
+   /* the operation */
+   int iOp;
+   /* the key and value of the operation */
+   const char *pcKey;
+   const void *pvValue;
+   /* the result of an OP_PUT */
+   int iResult;
+   /* the result of an OP_GET or OP_REMOVE */
+   void *pvResult;
+   /* the next slot of the SymTableCombiner */
+   struct STCombinerSlot *psNext;
+   /* the block the slot was aligned within */
+   void *pvBlock;
+} __attribute__((aligned(64)));
+
+/* SymTableCombiner is the structure for a flat combining front end
+of a SymTable */
+struct SymTableCombiner
+{
+   /* the SymTable the operations are applied to */
+   SymTable_T oSymTable;
+   /* held by the thread combining the pending operations */
+   pthread_mutex_t combineLock;
+   /* the slot of each thread that used the SymTableCombiner */
+   pthread_key_t iSlotKey;
+   /* every slot, most recent first, only ever pushed onto */
+   struct STCombinerSlot *psSlots;
+};
+
+/* Return the slot of the calling thread in oCombiner, making one if
+it has none, or NULL if there is not enough memory */
+static struct STCombinerSlot *SymTableCombiner_slot(
+SymTableCombiner_T oCombiner)
+{
+   struct STCombinerSlot *psSlot;
+   void *pvBlock;
+   size_t uAddress;
+
+   psSlot = (struct STCombinerSlot*)pthread_getspecific(
+   oCombiner->iSlotKey);
+   if (psSlot != NULL) return psSlot;
+
+   pvBlock = malloc(sizeof(struct STCombinerSlot) + LINE_SIZE);
+   if (pvBlock == NULL) return NULL;
+   uAddress = (size_t)pvBlock;
+   psSlot = (struct STCombinerSlot*)((char*)pvBlock
+   + (LINE_SIZE - uAddress % LINE_SIZE) % LINE_SIZE);
+   psSlot->pvBlock = pvBlock;
+   psSlot->iPending = 0;
+
+   if (pthread_setspecific(oCombiner->iSlotKey, psSlot) != 0) {
+      free(pvBlock);
+      return NULL;
+   }
+
+   /* a combiner may be walking the slots meanwhile */
+   psSlot->psNext = __atomic_load_n(&oCombiner->psSlots,
+   __ATOMIC_RELAXED);
+   while (!__atomic_compare_exchange_n(&oCombiner->psSlots,
+   &psSlot->psNext, psSlot, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+   return psSlot;
+}
+
+/* Apply the pending operation in psSlot to oSymTable and post its
+result */
+static void SymTableCombiner_apply(SymTable_T oSymTable,
+struct STCombinerSlot *psSlot)
+{
+   switch (psSlot->iOp) {
+      case OP_PUT:
+         psSlot->iResult = SymTable_put(oSymTable, psSlot->pcKey,
+         psSlot->pvValue);
+         break;
+      case OP_GET:
+         psSlot->pvResult = SymTable_get(oSymTable, psSlot->pcKey);
+         break;
+      default:
+         psSlot->pvResult = SymTable_remove(oSymTable, psSlot->pcKey);
+         break;
+   }
+   __atomic_store_n(&psSlot->iPending, 0, __ATOMIC_RELEASE);
+}
+
+/* Publish in psSlot the operation iOp on pcKey and pvValue, and
+return once it was applied to the SymTable of oCombiner, by the
+calling thread or by another one */
+static void SymTableCombiner_run(SymTableCombiner_T oCombiner,
+struct STCombinerSlot *psSlot, int iOp, const char *pcKey,
+const void *pvValue)
+{
+   struct STCombinerSlot *psOther;
+
+   psSlot->iOp = iOp;
+   psSlot->pcKey = pcKey;
+   psSlot->pvValue = pvValue;
+   __atomic_store_n(&psSlot->iPending, 1, __ATOMIC_RELEASE);
+
+   for (;;) {
+      if (pthread_mutex_trylock(&oCombiner->combineLock) == 0) {
+         /* serve every thread that is waiting, this one included */
+         for (psOther = __atomic_load_n(&oCombiner->psSlots,
+         __ATOMIC_ACQUIRE); psOther != NULL;
+         psOther = psOther->psNext) {
+            if (__atomic_load_n(&psOther->iPending, __ATOMIC_ACQUIRE))
+               SymTableCombiner_apply(oCombiner->oSymTable, psOther);
+         }
+         pthread_mutex_unlock(&oCombiner->combineLock);
+      }
+      if (!__atomic_load_n(&psSlot->iPending, __ATOMIC_ACQUIRE))
+         return;
+      sched_yield();
+   }
+}
+
+SymTableCombiner_T SymTableCombiner_new(SymTable_T oSymTable) {
+   SymTableCombiner_T oCombiner;
+
+   assert(oSymTable != NULL);
+
+   oCombiner = (SymTableCombiner_T)malloc(
+   sizeof(struct SymTableCombiner));
+   if (oCombiner == NULL) return NULL;
+
+   if (pthread_key_create(&oCombiner->iSlotKey, NULL) != 0) {
+      free(oCombiner);
+      return NULL;
+   }
+   pthread_mutex_init(&oCombiner->combineLock, NULL);
+   oCombiner->oSymTable = oSymTable;
+   oCombiner->psSlots = NULL;
+   return oCombiner;
+}
+
+void SymTableCombiner_free(SymTableCombiner_T oCombiner) {
+   struct STCombinerSlot *psSlot;
+   struct STCombinerSlot *psNext;
+
+   assert(oCombiner != NULL);
+
+   for (psSlot = oCombiner->psSlots; psSlot != NULL; psSlot = psNext) {
+      psNext = psSlot->psNext;
+      free(psSlot->pvBlock);
+   }
+   pthread_key_delete(oCombiner->iSlotKey);
+   pthread_mutex_destroy(&oCombiner->combineLock);
+   free(oCombiner);
+}
+
+int SymTableCombiner_put(SymTableCombiner_T oCombiner,
+const char *pcKey, const void *pvValue) {
+   struct STCombinerSlot *psSlot;
+
+   assert(oCombiner != NULL);
+   assert(pcKey != NULL);
+
+   psSlot = SymTableCombiner_slot(oCombiner);
+   if (psSlot == NULL) return -1;
+
+   SymTableCombiner_run(oCombiner, psSlot, OP_PUT, pcKey, pvValue);
+   return psSlot->iResult;
+}
+
+void *SymTableCombiner_get(SymTableCombiner_T oCombiner,
+const char *pcKey) {
+   struct STCombinerSlot *psSlot;
+
+   assert(oCombiner != NULL);
+   assert(pcKey != NULL);
+
+   psSlot = SymTableCombiner_slot(oCombiner);
+   if (psSlot == NULL) return NULL;
+
+   SymTableCombiner_run(oCombiner, psSlot, OP_GET, pcKey, NULL);
+   return psSlot->pvResult;
+}
+
+void *SymTableCombiner_remove(SymTableCombiner_T oCombiner,
+const char *pcKey) {
+   struct STCombinerSlot *psSlot;
+
+   assert(oCombiner != NULL);
+   assert(pcKey != NULL);
+
+   psSlot = SymTableCombiner_slot(oCombiner);
+   if (psSlot == NULL) return NULL;
+
+   SymTableCombiner_run(oCombiner, psSlot, OP_REMOVE, pcKey, NULL);
+   return psSlot->pvResult;
+}
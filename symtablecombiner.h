@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------*/
+/* symtablecombiner.h                                                 */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLECOMBINER_INCLUDED
+#define SYMTABLECOMBINER_INCLUDED
+
+#include "symtable.h"
+
+/* Define type SymTableCombiner_T to be a pointer towards a
+SymTableCombiner, a flat combining front end that lets any number of
+threads share one SymTable. Each thread publishes its operation in a
+slot of its own, and whichever thread gets hold of the combiner lock
+applies the pending operations of all threads in one pass while the
+table is hot in its cache, and posts back their results. The SymTable
+must only be used through the SymTableCombiner while it exists */
+typedef struct SymTableCombiner *SymTableCombiner_T;
+
+/* Return a SymTableCombiner for oSymTable, or NULL if there is not
+enough memory or no thread-specific key is left */
+SymTableCombiner_T SymTableCombiner_new(SymTable_T oSymTable);
+
+/* Free oCombiner and the slots of all threads, but not its SymTable.
+No thread may be using oCombiner */
+void SymTableCombiner_free(SymTableCombiner_T oCombiner);
+
+/* Like SymTable_put on the SymTable of oCombiner. Returns 1 if the
+binding was inserted, 0 if the key was already there or there is not
+enough memory, or -1 if the calling thread has no slot and cannot get
+one */
+int SymTableCombiner_put(SymTableCombiner_T oCombiner,
+const char *pcKey, const void *pvValue);
+
+/* Like SymTable_get on the SymTable of oCombiner, also returning NULL
+if the calling thread has no slot and cannot get one */
+void *SymTableCombiner_get(SymTableCombiner_T oCombiner,
+const char *pcKey);
+
+/* Like SymTable_remove on the SymTable of oCombiner, also returning
+NULL if the calling thread has no slot and cannot get one */
+void *SymTableCombiner_remove(SymTableCombiner_T oCombiner,
+const char *pcKey);
+
+#endif
@@ -0,0 +1,1482 @@
+/*--------------------------------------------------------------------*/
+/* symtablecuckoo.c                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "symtablebatch.h"
+#include "symtablememory.h"
+#include "symtablereclaim.h"
+#include "symtablemerge.h"
+
+/* Number of slots in a bucket, a bucket of keys and values fills one
+64 byte cache line */
+enum {SLOTS = 4};
+
+/* Number of lock stripes, must be a power of 2 */
+enum {STRIPES = 256};
+
+/* Number of buckets allocated by SymTable_new, must be a power of 2 */
+enum {INITIAL_BUCKETS = 16};
+
+/* Most buckets a cuckoo path search visits before giving up and
+growing the table */
+enum {MAX_SEARCH = 256};
+
+/* Alignment of buckets and lock stripes, the size of a cache line */
+enum {LINE_SIZE = 64};
+
+/* Number of times an insertion retries a cuckoo path that another
+writer invalidated before it grows the table instead */
+enum {MAX_ATTEMPTS = 8};
+
+/* STBucket holds SLOTS bindings, a slot is empty when its key is
+NULL */
+struct STBucket
+{
+   /* pointers to the keys of the bindings */
+   char *apcKeys[SLOTS];
+   /* pointers to the values of the bindings */
+   void *apvValues[SLOTS];
+} __attribute__((aligned(64)));
+
+/* STArray is a bucket array of a SymTable with the hash codes of its
+keys kept apart, so that lookups only follow key pointers whose hash
+matches */
+struct STArray
+{
+   /* the number of buckets minus one, the number is a power of 2 */
+   size_t uMask;
+   /* the buckets */
+   struct STBucket *psBuckets;
+   /* the block the buckets were aligned within */
+   void *pvBucketsBlock;
+   /* the full hash codes of the keys, SLOTS per bucket */
+   size_t *puHashes;
+   /* the array this one replaced, kept for readers that may still be
+   looking at it */
+   struct STArray *psRetired;
+};
+
+/* STStripe guards every bucket whose index is congruent to its own
+modulo STRIPES */
+struct STStripe
+{
+   /* held by writers changing the buckets */
+   pthread_mutex_t lock;
+   /* odd while a writer changes the buckets, bumped by every change */
+   size_t uVersion;
+   /* number of readers following a key pointer in the buckets */
+   size_t uReaders;
+} __attribute__((aligned(64)));
+
+/* STPathStep is one bucket visited by the cuckoo path search */
+struct STPathStep
+{
+   /* the bucket index */
+   size_t uBucket;
+   /* the step the binding moving into this bucket comes from, or -1
+   for the buckets of the key being inserted */
+   int iParent;
+   /* the slot of the parent bucket holding that binding */
+   int iParentSlot;
+   /* the key of that binding when the path was found */
+   char *pcKey;
+};
+
+/* SymTable is the structure for a bucketized cuckoo hash table, every
+binding sits in one of the two buckets its hash code selects, so a
+lookup reads at most two buckets. All functions may be called
+concurrently from any number of threads, except SymTable_free, and
+except that a value slot from SymTable_getOrPut must only be used while
+no other thread changes the table. Readers take no locks: they check
+that the versions of the stripes guarding their buckets did not change
+while they read. Writers lock the stripes of the buckets they change, a
+pfApply given to SymTable_map or a pfFreeValue given to SymTable_clear
+must not call back into the table. Nor must the callbacks given to
+SymTable_merge, SymTable_intersect and SymTable_diff, which hold every
+lock of the other table, and of the table they change unless they
+merge, so they must not run at once on two tables in opposite
+directions */
+struct SymTable
+{
+   /* the number of bindings in the SymTable */
+   size_t size;
+   /* the current bucket array */
+   struct STArray *psArray;
+   /* serializes cuckoo path searches and growth */
+   pthread_mutex_t displaceLock;
+   /* the lock stripes */
+   struct STStripe asStripes[STRIPES];
+   /* the source of all memory of the SymTable, its allocator must be
+   thread safe */
+   struct STMemory sMemory;
+   /* serializes use of sMemory when it is an arena */
+   pthread_mutex_t memoryLock;
+   /* the block the SymTable was aligned within */
+   void *pvBlock;
+   /* the SymTable of the enclosing scope, or NULL */
+   SymTable_T oParent;
+};
+
+/* Return uHash, the hash code of a key before mixing, which is also
+the hash code of its SymKey, mixed so that its low bits can index the
+buckets */
+static size_t SymTable_mix(size_t uHash)
+{
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+
+   return uHash;
+}
+
+/* Return a hash code for pcKey */
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return SymTable_mix(uHash);
+}
+
+/* Return the first bucket for hash code uHash in a bucket array with
+mask uMask */
+static size_t SymTable_index1(size_t uHash, size_t uMask)
+{
+   return uHash & uMask;
+}
+
+/* Return the second bucket for hash code uHash in a bucket array with
+mask uMask, it differs from the first whenever there are two buckets
+or more */
+static size_t SymTable_index2(size_t uHash, size_t uMask)
+{
+   size_t uIndex;
+
+   uIndex = ((uHash >> 8) * 0x5bd1e995 + (uHash >> 24)) & uMask;
+   if (uIndex == SymTable_index1(uHash, uMask)) uIndex ^= 1;
+   return uIndex & uMask;
+}
+
+/* Return the bucket other than uBucket that hash code uHash selects in
+a bucket array with mask uMask */
+static size_t SymTable_altIndex(size_t uHash, size_t uBucket,
+size_t uMask)
+{
+   if (uBucket == SymTable_index1(uHash, uMask))
+      return SymTable_index2(uHash, uMask);
+   return SymTable_index1(uHash, uMask);
+}
+
+/* Return a block of uSize bytes from the memory of oSymTable, or NULL
+if there is not enough memory */
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+   void *pvBlock;
+
+   if (!oSymTable->sMemory.iArena)
+      return STMemory_alloc(&oSymTable->sMemory, uSize);
+
+   pthread_mutex_lock(&oSymTable->memoryLock);
+   pvBlock = STMemory_alloc(&oSymTable->sMemory, uSize);
+   pthread_mutex_unlock(&oSymTable->memoryLock);
+   return pvBlock;
+}
+
+/* Give back the block pvBlock of uSize bytes to the memory of
+oSymTable, a no-op in arena mode */
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+size_t uSize)
+{
+   STMemory_free(&oSymTable->sMemory, pvBlock, uSize);
+}
+
+/* Return the address of the first multiple of LINE_SIZE in pvBlock */
+static void *SymTable_alignLine(void *pvBlock)
+{
+   size_t uAddress = (size_t)pvBlock;
+
+   return (char*)pvBlock
+   + (LINE_SIZE - uAddress % LINE_SIZE) % LINE_SIZE;
+}
+
+/* Allocate an empty bucket array with uBuckets buckets, uBuckets being
+a power of 2, from the memory of oSymTable. Returns NULL if there is
+not enough memory */
+static struct STArray *SymTable_newArray(SymTable_T oSymTable,
+size_t uBuckets)
+{
+   struct STArray *psArray;
+
+   psArray = (struct STArray*)SymTable_alloc(oSymTable,
+   sizeof(struct STArray));
+   if (psArray == NULL) return NULL;
+
+   psArray->pvBucketsBlock = SymTable_alloc(oSymTable,
+   uBuckets * sizeof(struct STBucket) + LINE_SIZE);
+   if (psArray->pvBucketsBlock == NULL) {
+      SymTable_release(oSymTable, psArray, sizeof(struct STArray));
+      return NULL;
+   }
+   psArray->puHashes = (size_t*)SymTable_alloc(oSymTable,
+   uBuckets * SLOTS * sizeof(size_t));
+   if (psArray->puHashes == NULL) {
+      SymTable_release(oSymTable, psArray->pvBucketsBlock,
+      uBuckets * sizeof(struct STBucket) + LINE_SIZE);
+      SymTable_release(oSymTable, psArray, sizeof(struct STArray));
+      return NULL;
+   }
+
+   psArray->psBuckets =
+   (struct STBucket*)SymTable_alignLine(psArray->pvBucketsBlock);
+   memset(psArray->psBuckets, 0, uBuckets * sizeof(struct STBucket));
+   memset(psArray->puHashes, 0, uBuckets * SLOTS * sizeof(size_t));
+   psArray->uMask = uBuckets - 1;
+   psArray->psRetired = NULL;
+   return psArray;
+}
+
+/* Give back psArray and every array it retired, but not their keys,
+to the memory of oSymTable */
+static void SymTable_freeArrays(SymTable_T oSymTable,
+struct STArray *psArray)
+{
+   struct STArray *psNext;
+   size_t uBuckets;
+
+   for (; psArray != NULL; psArray = psNext) {
+      psNext = psArray->psRetired;
+      uBuckets = psArray->uMask + 1;
+      SymTable_release(oSymTable, psArray->pvBucketsBlock,
+      uBuckets * sizeof(struct STBucket) + LINE_SIZE);
+      SymTable_release(oSymTable, psArray->puHashes,
+      uBuckets * SLOTS * sizeof(size_t));
+      SymTable_release(oSymTable, psArray, sizeof(struct STArray));
+   }
+}
+
+/* Return the stripe of oSymTable that guards bucket uBucket */
+static struct STStripe *SymTable_stripe(SymTable_T oSymTable,
+size_t uBucket)
+{
+   return &oSymTable->asStripes[uBucket & (STRIPES - 1)];
+}
+
+/* Lock the stripes of oSymTable guarding buckets uBucket1 and
+uBucket2, in address order so that writers cannot deadlock */
+static void SymTable_lockPair(SymTable_T oSymTable, size_t uBucket1,
+size_t uBucket2)
+{
+   struct STStripe *psFirst, *psSecond, *psTemp;
+
+   psFirst = SymTable_stripe(oSymTable, uBucket1);
+   psSecond = SymTable_stripe(oSymTable, uBucket2);
+   if (psFirst > psSecond) {
+      psTemp = psFirst;
+      psFirst = psSecond;
+      psSecond = psTemp;
+   }
+
+   pthread_mutex_lock(&psFirst->lock);
+   if (psSecond != psFirst) pthread_mutex_lock(&psSecond->lock);
+}
+
+/* Unlock the stripes locked by SymTable_lockPair */
+static void SymTable_unlockPair(SymTable_T oSymTable, size_t uBucket1,
+size_t uBucket2)
+{
+   struct STStripe *psFirst, *psSecond;
+
+   psFirst = SymTable_stripe(oSymTable, uBucket1);
+   psSecond = SymTable_stripe(oSymTable, uBucket2);
+
+   pthread_mutex_unlock(&psFirst->lock);
+   if (psSecond != psFirst) pthread_mutex_unlock(&psSecond->lock);
+}
+
+/* Bump the versions of the locked stripes guarding buckets uBucket1
+and uBucket2 of oSymTable, once before and once after a change */
+static void SymTable_bumpPair(SymTable_T oSymTable, size_t uBucket1,
+size_t uBucket2)
+{
+   struct STStripe *psFirst, *psSecond;
+
+   psFirst = SymTable_stripe(oSymTable, uBucket1);
+   psSecond = SymTable_stripe(oSymTable, uBucket2);
+
+   __atomic_add_fetch(&psFirst->uVersion, 1, __ATOMIC_SEQ_CST);
+   if (psSecond != psFirst)
+      __atomic_add_fetch(&psSecond->uVersion, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Wait until no reader follows a key pointer of the buckets guarded
+by psStripe */
+static void SymTable_drain(struct STStripe *psStripe)
+{
+   while (__atomic_load_n(&psStripe->uReaders, __ATOMIC_SEQ_CST) != 0)
+      sched_yield();
+}
+
+/* Store the binding with hash code uHash, key pcKey and value pvValue
+in slot iSlot of bucket uBucket of psArray */
+static void SymTable_setSlot(struct STArray *psArray, size_t uBucket,
+int iSlot, size_t uHash, char *pcKey, void *pvValue)
+{
+   struct STBucket *psBucket = &psArray->psBuckets[uBucket];
+
+   __atomic_store_n(&psArray->puHashes[uBucket * SLOTS + iSlot], uHash,
+   __ATOMIC_RELAXED);
+   __atomic_store_n(&psBucket->apvValues[iSlot], pvValue,
+   __ATOMIC_RELAXED);
+   __atomic_store_n(&psBucket->apcKeys[iSlot], pcKey, __ATOMIC_RELEASE);
+}
+
+/* Return the slot of bucket uBucket of psArray that holds key pcKey
+with hash code uHash, or -1 if there is none. The caller must hold the
+stripe of the bucket */
+static int SymTable_findSlot(struct STArray *psArray, size_t uBucket,
+const char *pcKey, size_t uHash)
+{
+   struct STBucket *psBucket = &psArray->psBuckets[uBucket];
+   int i;
+
+   for (i = 0; i < SLOTS; i++) {
+      if (psBucket->apcKeys[i] != NULL
+      && psArray->puHashes[uBucket * SLOTS + i] == uHash
+      && !strcmp(psBucket->apcKeys[i], pcKey)) return i;
+   }
+   return -1;
+}
+
+/* Return an empty slot of bucket uBucket of psArray, or -1 if there is
+none */
+static int SymTable_emptySlot(struct STArray *psArray, size_t uBucket)
+{
+   int i;
+
+   for (i = 0; i < SLOTS; i++) {
+      if (__atomic_load_n(&psArray->psBuckets[uBucket].apcKeys[i],
+      __ATOMIC_RELAXED) == NULL) return i;
+   }
+   return -1;
+}
+
+/* Search psArray breadth first for a sequence of bindings that can
+each move to their other bucket, ending in a bucket with an empty slot,
+that frees a slot in bucket uBucket1 or uBucket2. Fills asSteps and
+returns the index of the last step, or -1 if no path was found within
+MAX_SEARCH buckets. *piEmpty is set to the empty slot of the last
+step */
+static int SymTable_searchPath(struct STArray *psArray, size_t uBucket1,
+size_t uBucket2, struct STPathStep asSteps[MAX_SEARCH], int *piEmpty)
+{
+   int iHead, iTail, i;
+   size_t uHash;
+   char *pcKey;
+
+   asSteps[0].uBucket = uBucket1;
+   asSteps[0].iParent = -1;
+   asSteps[1].uBucket = uBucket2;
+   asSteps[1].iParent = -1;
+   iTail = 2;
+
+   for (iHead = 0; iHead < iTail; iHead++) {
+      *piEmpty = SymTable_emptySlot(psArray, asSteps[iHead].uBucket);
+      if (*piEmpty >= 0) return iHead;
+
+      for (i = 0; i < SLOTS && iTail < MAX_SEARCH; i++) {
+         pcKey = __atomic_load_n(
+         &psArray->psBuckets[asSteps[iHead].uBucket].apcKeys[i],
+         __ATOMIC_RELAXED);
+         if (pcKey == NULL) continue;
+         uHash = __atomic_load_n(
+         &psArray->puHashes[asSteps[iHead].uBucket * SLOTS + i],
+         __ATOMIC_RELAXED);
+
+         asSteps[iTail].uBucket = SymTable_altIndex(uHash,
+         asSteps[iHead].uBucket, psArray->uMask);
+         asSteps[iTail].iParent = iHead;
+         asSteps[iTail].iParentSlot = i;
+         asSteps[iTail].pcKey = pcKey;
+         iTail++;
+      }
+   }
+
+   return -1;
+}
+
+/* Move the bindings along the path ending at step iLast of asSteps,
+whose empty slot is iEmpty, one bucket each, last one first. When
+oSymTable is not NULL each move locks the stripes of its two buckets
+and first checks that the path still holds. Returns the slot freed in
+the first bucket of the path, or -1 if another writer invalidated the
+path */
+static int SymTable_applyPath(SymTable_T oSymTable,
+struct STArray *psArray, struct STPathStep asSteps[MAX_SEARCH],
+int iLast, int iEmpty)
+{
+   struct STPathStep *psStep, *psParent;
+   struct STBucket *psFrom;
+   int iSlot;
+   int iValid = 1;
+
+   for (psStep = &asSteps[iLast]; psStep->iParent >= 0;
+   psStep = psParent) {
+      psParent = &asSteps[psStep->iParent];
+      psFrom = &psArray->psBuckets[psParent->uBucket];
+      iSlot = psStep->iParentSlot;
+
+      if (oSymTable != NULL) {
+         SymTable_lockPair(oSymTable, psParent->uBucket,
+         psStep->uBucket);
+         iValid = oSymTable->psArray == psArray
+         && psFrom->apcKeys[iSlot] == psStep->pcKey
+         && psArray->psBuckets[psStep->uBucket].apcKeys[iEmpty] == NULL;
+         if (iValid) {
+            SymTable_bumpPair(oSymTable, psParent->uBucket,
+            psStep->uBucket);
+         }
+      }
+
+      if (iValid) {
+         SymTable_setSlot(psArray, psStep->uBucket, iEmpty,
+         psArray->puHashes[psParent->uBucket * SLOTS + iSlot],
+         psFrom->apcKeys[iSlot], psFrom->apvValues[iSlot]);
+         __atomic_store_n(&psFrom->apcKeys[iSlot], NULL,
+         __ATOMIC_RELEASE);
+      }
+
+      if (oSymTable != NULL) {
+         if (iValid) {
+            SymTable_bumpPair(oSymTable, psParent->uBucket,
+            psStep->uBucket);
+         }
+         SymTable_unlockPair(oSymTable, psParent->uBucket,
+         psStep->uBucket);
+      }
+
+      if (!iValid) return -1;
+      iEmpty = iSlot;
+   }
+
+   return iEmpty;
+}
+
+/* Place the binding with hash code uHash, key pcKey and value pvValue
+into psArray, which no other thread can see, returns 1 on success and
+0 if no cuckoo path frees a slot for it */
+static int SymTable_placePrivate(struct STArray *psArray, size_t uHash,
+char *pcKey, void *pvValue)
+{
+   struct STPathStep asSteps[MAX_SEARCH];
+   size_t uBucket1, uBucket2;
+   int iLast, iEmpty;
+
+   uBucket1 = SymTable_index1(uHash, psArray->uMask);
+   uBucket2 = SymTable_index2(uHash, psArray->uMask);
+
+   iLast = SymTable_searchPath(psArray, uBucket1, uBucket2, asSteps,
+   &iEmpty);
+   if (iLast < 0) return 0;
+
+   iEmpty = SymTable_applyPath(NULL, psArray, asSteps, iLast, iEmpty);
+   while (asSteps[iLast].iParent >= 0) iLast = asSteps[iLast].iParent;
+
+   SymTable_setSlot(psArray, asSteps[iLast].uBucket, iEmpty, uHash,
+   pcKey, pvValue);
+   return 1;
+}
+
+/* Double the bucket array of oSymTable, as many times as it takes for
+every binding to fit. The caller must hold the displace lock. Returns 1
+on success and 0 if there is not enough memory */
+static int SymTable_grow(SymTable_T oSymTable)
+{
+   struct STArray *psOld, *psNew;
+   struct STBucket *psBucket;
+   size_t uBuckets, b;
+   int i, iFits;
+
+   psOld = oSymTable->psArray;
+
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_lock(&oSymTable->asStripes[i].lock);
+   }
+
+   /* readers started before the new array is published still read
+   the old one, which stays allocated until SymTable_free */
+   uBuckets = (psOld->uMask + 1) * 2;
+   do {
+      psNew = SymTable_newArray(oSymTable, uBuckets);
+      if (psNew == NULL) break;
+
+      iFits = 1;
+      for (b = 0; b <= psOld->uMask && iFits; b++) {
+         psBucket = &psOld->psBuckets[b];
+         for (i = 0; i < SLOTS && iFits; i++) {
+            if (psBucket->apcKeys[i] == NULL) continue;
+            iFits = SymTable_placePrivate(psNew,
+            psOld->puHashes[b * SLOTS + i], psBucket->apcKeys[i],
+            psBucket->apvValues[i]);
+         }
+      }
+
+      if (!iFits) {
+         SymTable_freeArrays(oSymTable, psNew);
+         psNew = NULL;
+         uBuckets *= 2;
+      }
+   } while (psNew == NULL);
+
+   if (psNew != NULL) {
+      for (i = 0; i < STRIPES; i++) {
+         __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+         __ATOMIC_SEQ_CST);
+      }
+      psNew->psRetired = psOld;
+      __atomic_store_n(&oSymTable->psArray, psNew, __ATOMIC_SEQ_CST);
+      for (i = 0; i < STRIPES; i++) {
+         __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+         __ATOMIC_SEQ_CST);
+      }
+      /* a reader still comparing a key must finish before any writer
+      can free that key through the new stripe layout */
+      for (i = 0; i < STRIPES; i++) {
+         SymTable_drain(&oSymTable->asStripes[i]);
+      }
+   }
+
+   for (i = STRIPES - 1; i >= 0; i--) {
+      pthread_mutex_unlock(&oSymTable->asStripes[i].lock);
+   }
+
+   return psNew != NULL;
+}
+
+/* Free up a slot in one of the buckets uBucket1 and uBucket2 of the
+current bucket array psArray of oSymTable, by moving bindings along a
+cuckoo path or by growing the table. Returns 1 if the caller should
+retry its insertion and 0 if there is not enough memory */
+static int SymTable_makeRoom(SymTable_T oSymTable,
+struct STArray *psArray, size_t uBucket1, size_t uBucket2)
+{
+   struct STPathStep asSteps[MAX_SEARCH];
+   int iAttempt, iEmpty;
+   int iLast = -1;
+   int iResult = 1;
+
+   pthread_mutex_lock(&oSymTable->displaceLock);
+
+   if (oSymTable->psArray == psArray) {
+      for (iAttempt = 0; iAttempt < MAX_ATTEMPTS; iAttempt++) {
+         iLast = SymTable_searchPath(psArray, uBucket1, uBucket2,
+         asSteps, &iEmpty);
+         if (iLast < 0) break;
+         if (SymTable_applyPath(oSymTable, psArray, asSteps, iLast,
+         iEmpty) >= 0) break;
+      }
+      if (iAttempt == MAX_ATTEMPTS || iLast < 0) {
+         iResult = SymTable_grow(oSymTable);
+      }
+   }
+
+   pthread_mutex_unlock(&oSymTable->displaceLock);
+   return iResult;
+}
+
+/* Find the binding with key pcKey, whose hash code is uHash, in
+oSymTable, inserting a new binding with key pcKey and value pvValue if
+there is none. If ppvOld is not NULL an existing binding gets value
+pvValue and its old value is stored in *ppvOld, if psMerge is not NULL
+it gets the value that psMerge resolves it to with pvValue, under the
+locks of its buckets. Sets *piInserted to 1 if a binding was inserted
+and to 0 otherwise, returns a pointer to the value of the binding or
+NULL if there is not enough memory for a new one */
+static void **SymTable_lookupOrInsert(SymTable_T oSymTable,
+const char *pcKey, size_t uHash, const void *pvValue, int *piInserted,
+void **ppvOld, const struct STMerge *psMerge) {
+   struct STArray *psArray;
+   size_t uBucket1, uBucket2, uBucket;
+   char *keyCopy = NULL;
+   void **ppvSlot = NULL;
+   void *pvNew;
+   int iSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   for (;;) {
+      psArray = __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST);
+      uBucket1 = SymTable_index1(uHash, psArray->uMask);
+      uBucket2 = SymTable_index2(uHash, psArray->uMask);
+
+      SymTable_lockPair(oSymTable, uBucket1, uBucket2);
+      if (oSymTable->psArray != psArray) {
+         SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+         continue;
+      }
+
+      uBucket = uBucket1;
+      iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+      if (iSlot < 0) {
+         uBucket = uBucket2;
+         iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+      }
+
+      if (iSlot >= 0) {
+         ppvSlot = &psArray->psBuckets[uBucket].apvValues[iSlot];
+         if (ppvOld != NULL || psMerge != NULL) {
+            pvNew = (void*)pvValue;
+            if (psMerge != NULL) {
+               pvNew = *ppvSlot;
+               STMerge_resolve(psMerge, &oSymTable->sMemory, pcKey,
+               &pvNew, (void*)pvValue);
+            }
+            SymTable_bumpPair(oSymTable, uBucket, uBucket);
+            if (ppvOld != NULL) *ppvOld = *ppvSlot;
+            __atomic_store_n(ppvSlot, pvNew, __ATOMIC_RELAXED);
+            SymTable_bumpPair(oSymTable, uBucket, uBucket);
+         }
+         SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+         if (keyCopy != NULL) {
+            SymTable_release(oSymTable, keyCopy, strlen(keyCopy) + 1);
+         }
+         return ppvSlot;
+      }
+
+      if (keyCopy == NULL) {
+         keyCopy = (char*)SymTable_alloc(oSymTable, strlen(pcKey) + 1);
+         if (keyCopy == NULL) {
+            SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+            return NULL;
+         }
+         strcpy(keyCopy, pcKey);
+      }
+
+      uBucket = uBucket1;
+      iSlot = SymTable_emptySlot(psArray, uBucket);
+      if (iSlot < 0) {
+         uBucket = uBucket2;
+         iSlot = SymTable_emptySlot(psArray, uBucket);
+      }
+
+      if (iSlot >= 0) {
+         SymTable_bumpPair(oSymTable, uBucket, uBucket);
+         SymTable_setSlot(psArray, uBucket, iSlot, uHash, keyCopy,
+         (void*)pvValue);
+         SymTable_bumpPair(oSymTable, uBucket, uBucket);
+         SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+         __atomic_add_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+         *piInserted = 1;
+         return &psArray->psBuckets[uBucket].apvValues[iSlot];
+      }
+
+      SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+      if (!SymTable_makeRoom(oSymTable, psArray, uBucket1, uBucket2)) {
+         SymTable_release(oSymTable, keyCopy, strlen(keyCopy) + 1);
+         return NULL;
+      }
+   }
+}
+
+/* Read the binding with key pcKey, whose hash code is uHash, from 
+oSymTable without locking. Returns 1 and stores its value in *ppvValue
+if there is one, returns 0 otherwise */
+static int SymTable_read(SymTable_T oSymTable, const char *pcKey,
+size_t uHash, void **ppvValue)
+{
+   struct STArray *psArray;
+   struct STStripe *apsStripes[2];
+   size_t auBuckets[2], auVersions[2];
+   char *pcSlotKey;
+   void *pvValue = NULL;
+   int iFound, iValid, iStale, k, i;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   for (;;) {
+      psArray = __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST);
+      auBuckets[0] = SymTable_index1(uHash, psArray->uMask);
+      auBuckets[1] = SymTable_index2(uHash, psArray->uMask);
+
+      iValid = 1;
+      for (k = 0; k < 2; k++) {
+         apsStripes[k] = SymTable_stripe(oSymTable, auBuckets[k]);
+         auVersions[k] = __atomic_load_n(&apsStripes[k]->uVersion,
+         __ATOMIC_SEQ_CST);
+         if (auVersions[k] % 2 != 0) iValid = 0;
+      }
+      if (!iValid) {
+         sched_yield();
+         continue;
+      }
+
+      iFound = 0;
+      iStale = 0;
+      for (k = 0; k < 2 && !iFound && !iStale; k++) {
+         for (i = 0; i < SLOTS && !iFound && !iStale; i++) {
+            if (__atomic_load_n(
+            &psArray->puHashes[auBuckets[k] * SLOTS + i],
+            __ATOMIC_RELAXED) != uHash) continue;
+            pcSlotKey = __atomic_load_n(
+            &psArray->psBuckets[auBuckets[k]].apcKeys[i],
+            __ATOMIC_ACQUIRE);
+            if (pcSlotKey == NULL) continue;
+
+            /* announce the key pointer before following it, a writer
+            freeing it bumps the version first and then waits */
+            __atomic_add_fetch(&apsStripes[k]->uReaders, 1,
+            __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&apsStripes[k]->uVersion,
+            __ATOMIC_SEQ_CST) != auVersions[k]
+            || __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST)
+            != psArray) {
+               iStale = 1;
+            }
+            else if (!strcmp(pcSlotKey, pcKey)) {
+               pvValue = __atomic_load_n(
+               &psArray->psBuckets[auBuckets[k]].apvValues[i],
+               __ATOMIC_RELAXED);
+               iFound = 1;
+            }
+            __atomic_sub_fetch(&apsStripes[k]->uReaders, 1,
+            __ATOMIC_SEQ_CST);
+         }
+      }
+      if (iStale) continue;
+
+      if (__atomic_load_n(&apsStripes[0]->uVersion, __ATOMIC_SEQ_CST)
+      == auVersions[0]
+      && __atomic_load_n(&apsStripes[1]->uVersion, __ATOMIC_SEQ_CST)
+      == auVersions[1]
+      && __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST)
+      == psArray) {
+         if (iFound) *ppvValue = pvValue;
+         return iFound;
+      }
+   }
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   /* a value inside the table could be freed by a remove while another
+   thread still reads it, so values stay owned by the caller */
+   if (uValueSize > 0) return NULL;
+
+   return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue)) {
+   assert(uMaxBindings > 0);
+
+   /* the marks of a clock would turn every lock-free lookup into a
+   write to a shared cache line */
+   return NULL;
+}
+
+SymTable_T SymTable_newChild(SymTable_T oParent) {
+   SymTable_T oSymTable;
+
+   assert(oParent != NULL);
+
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   oSymTable->oParent = oParent;
+   return oSymTable;
+}
+
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags) {
+   SymTable_T oSymTable;
+   struct STMemory sMemory;
+   void *pvBlock;
+   int i;
+
+   /* the buckets copy and release keys themselves, so keys are never
+   interned */
+   STMemory_init(&sMemory, psAllocator, iFlags & ~SYMTABLE_INTERNED);
+
+   pvBlock = STMemory_alloc(&sMemory,
+   sizeof(struct SymTable) + LINE_SIZE);
+   if (pvBlock == NULL) {
+      STMemory_releaseAll(&sMemory);
+      return NULL;
+   }
+   oSymTable = (SymTable_T)SymTable_alignLine(pvBlock);
+   oSymTable->pvBlock = pvBlock;
+   oSymTable->sMemory = sMemory;
+   pthread_mutex_init(&oSymTable->memoryLock, NULL);
+
+   oSymTable->psArray = SymTable_newArray(oSymTable, INITIAL_BUCKETS);
+   if (oSymTable->psArray == NULL) {
+      pthread_mutex_destroy(&oSymTable->memoryLock);
+      sMemory = oSymTable->sMemory;
+      STMemory_free(&sMemory, pvBlock,
+      sizeof(struct SymTable) + LINE_SIZE);
+      STMemory_releaseAll(&sMemory);
+      return NULL;
+   }
+
+   oSymTable->size = 0;
+   oSymTable->oParent = NULL;
+   pthread_mutex_init(&oSymTable->displaceLock, NULL);
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_init(&oSymTable->asStripes[i].lock, NULL);
+      oSymTable->asStripes[i].uVersion = 0;
+      oSymTable->asStripes[i].uReaders = 0;
+   }
+
+   return oSymTable;
+}
+
+/* Free the keys in buckets uStart up to uEnd of the current array of
+the SymTable pvTable, as the first part of freeing it */
+static void SymTable_freeBuckets(void *pvTable, size_t uStart,
+size_t uEnd)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   struct STArray *psArray = oSymTable->psArray;
+   size_t b;
+   int i;
+
+   for (b = uStart; b < uEnd; b++) {
+      for (i = 0; i < SLOTS; i++) {
+         STMemory_freeString(&oSymTable->sMemory,
+         psArray->psBuckets[b].apcKeys[i]);
+      }
+   }
+}
+
+/* Free the SymTable pvTable once the keys in all of its buckets are
+freed, or right away in arena mode */
+static void SymTable_freeRest(void *pvTable)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   struct STMemory sMemory;
+   int i;
+
+   pthread_mutex_destroy(&oSymTable->memoryLock);
+   pthread_mutex_destroy(&oSymTable->displaceLock);
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_destroy(&oSymTable->asStripes[i].lock);
+   }
+
+   /* the SymTable lives in its own memory, so copy the memory out */
+   sMemory = oSymTable->sMemory;
+
+   if (sMemory.iArena) {
+      STMemory_releaseAll(&sMemory);
+      return;
+   }
+
+   SymTable_freeArrays(oSymTable, oSymTable->psArray);
+   STMemory_free(&sMemory, oSymTable->pvBlock,
+   sizeof(struct SymTable) + LINE_SIZE);
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   if (!oSymTable->sMemory.iArena) {
+      SymTable_freeBuckets(oSymTable, 0,
+      oSymTable->psArray->uMask + 1);
+   }
+   SymTable_freeRest(oSymTable);
+}
+
+void SymTable_freeAsync(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)
+   || !STReclaim_async(oSymTable, oSymTable->psArray->uMask + 1,
+   SymTable_freeBuckets, SymTable_freeRest))
+      SymTable_free(oSymTable);
+}
+
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)) {
+      SymTable_free(oSymTable);
+      return;
+   }
+   STReclaim_parallel(oSymTable, oSymTable->psArray->uMask + 1,
+   SymTable_freeBuckets, SymTable_freeRest, uThreads);
+}
+
+void SymTable_clear(SymTable_T oSymTable,
+void (*pfFreeValue)(void *pvValue)) {
+   struct STArray *psArray;
+   struct STBucket *psBucket;
+   size_t b;
+   int i;
+
+   assert(oSymTable != NULL);
+
+   pthread_mutex_lock(&oSymTable->displaceLock);
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_lock(&oSymTable->asStripes[i].lock);
+   }
+
+   /* with every version odd no new reader follows a key pointer, so
+   once the current ones are gone the keys can be freed */
+   for (i = 0; i < STRIPES; i++) {
+      __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+      __ATOMIC_SEQ_CST);
+   }
+   for (i = 0; i < STRIPES; i++) {
+      SymTable_drain(&oSymTable->asStripes[i]);
+   }
+
+   /* only the slots in use are written to, the buckets are kept */
+   psArray = oSymTable->psArray;
+   for (b = 0; b <= psArray->uMask && oSymTable->size > 0; b++) {
+      psBucket = &psArray->psBuckets[b];
+      for (i = 0; i < SLOTS; i++) {
+         if (psBucket->apcKeys[i] == NULL) continue;
+
+         if (pfFreeValue != NULL) {
+            (*pfFreeValue)(psBucket->apvValues[i]);
+         }
+         SymTable_release(oSymTable, psBucket->apcKeys[i],
+         strlen(psBucket->apcKeys[i]) + 1);
+         __atomic_store_n(&psBucket->apcKeys[i], NULL,
+         __ATOMIC_RELEASE);
+         __atomic_sub_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+      }
+   }
+
+   for (i = 0; i < STRIPES; i++) {
+      __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+      __ATOMIC_SEQ_CST);
+   }
+
+   for (i = STRIPES - 1; i >= 0; i--) {
+      pthread_mutex_unlock(&oSymTable->asStripes[i].lock);
+   }
+   pthread_mutex_unlock(&oSymTable->displaceLock);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return __atomic_load_n(&oSymTable->size, __ATOMIC_RELAXED);
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, pcKey, SymTable_hash(pcKey),
+   pvValue, &iInserted, NULL, NULL) == NULL) return 0;
+
+   return iInserted;
+}
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvOld) {
+   void *pvOld = NULL;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (ppvOld != NULL) *ppvOld = NULL;
+
+   if (SymTable_lookupOrInsert(oSymTable, pcKey, SymTable_hash(pcKey),
+   pvValue, &iInserted, &pvOld, NULL) == NULL) return -1;
+   if (iInserted) return 1;
+
+   if (ppvOld != NULL) *ppvOld = pvOld;
+   return 0;
+}
+
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void ***pppvSlot) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(pppvSlot != NULL);
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey,
+   SymTable_hash(pcKey), pvValue, &iInserted, NULL, NULL);
+   *pppvSlot = ppvSlot;
+   if (ppvSlot == NULL) return -1;
+
+   return iInserted;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   struct STArray *psArray;
+   size_t uHash, uBucket1, uBucket2, uBucket;
+   void *tempValue = NULL;
+   int iSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uHash = SymTable_hash(pcKey);
+
+   for (;;) {
+      psArray = __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST);
+      uBucket1 = SymTable_index1(uHash, psArray->uMask);
+      uBucket2 = SymTable_index2(uHash, psArray->uMask);
+
+      SymTable_lockPair(oSymTable, uBucket1, uBucket2);
+      if (oSymTable->psArray == psArray) break;
+      SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+   }
+
+   uBucket = uBucket1;
+   iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   if (iSlot < 0) {
+      uBucket = uBucket2;
+      iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   }
+
+   if (iSlot >= 0) {
+      SymTable_bumpPair(oSymTable, uBucket, uBucket);
+      tempValue = psArray->psBuckets[uBucket].apvValues[iSlot];
+      __atomic_store_n(&psArray->psBuckets[uBucket].apvValues[iSlot],
+      (void*)pvValue, __ATOMIC_RELAXED);
+      SymTable_bumpPair(oSymTable, uBucket, uBucket);
+   }
+
+   SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+   return tempValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   void *pvValue;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_read(oSymTable, pcKey, SymTable_hash(pcKey), 
+   &pvValue);
+}
+
+/* Remove the binding with key pcKey, whose hash code is uHash, from
+oSymTable and return its value, or NULL if there is no such binding */
+static void *SymTable_delete(SymTable_T oSymTable, const char *pcKey,
+size_t uHash)
+{
+   struct STArray *psArray;
+   size_t uBucket1, uBucket2, uBucket;
+   char *pcOldKey = NULL;
+   void *pvValue = NULL;
+   int iSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   for (;;) {
+      psArray = __atomic_load_n(&oSymTable->psArray, __ATOMIC_SEQ_CST);
+      uBucket1 = SymTable_index1(uHash, psArray->uMask);
+      uBucket2 = SymTable_index2(uHash, psArray->uMask);
+
+      SymTable_lockPair(oSymTable, uBucket1, uBucket2);
+      if (oSymTable->psArray == psArray) break;
+      SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+   }
+
+   uBucket = uBucket1;
+   iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   if (iSlot < 0) {
+      uBucket = uBucket2;
+      iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   }
+
+   if (iSlot >= 0) {
+      SymTable_bumpPair(oSymTable, uBucket, uBucket);
+      pcOldKey = psArray->psBuckets[uBucket].apcKeys[iSlot];
+      pvValue = psArray->psBuckets[uBucket].apvValues[iSlot];
+      __atomic_store_n(&psArray->psBuckets[uBucket].apcKeys[iSlot],
+      NULL, __ATOMIC_RELEASE);
+      SymTable_bumpPair(oSymTable, uBucket, uBucket);
+      __atomic_sub_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+   }
+
+   SymTable_unlockPair(oSymTable, uBucket1, uBucket2);
+
+   if (pcOldKey != NULL) {
+      SymTable_drain(SymTable_stripe(oSymTable, uBucket));
+      SymTable_release(oSymTable, pcOldKey, strlen(pcOldKey) + 1);
+   }
+   return pvValue;
+}
+
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey) {
+   void *pvValue;
+   size_t uHash;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uHash = SymTable_hash(pcKey);
+   for (; oSymTable != NULL; oSymTable = oSymTable->oParent) {
+      if (SymTable_read(oSymTable, pcKey, uHash, &pvValue)) 
+         return pvValue;
+   }
+
+   return NULL;
+}
+
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue) {
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   /* the buckets copy every key they take, so the atom is only a
+   string here */
+   return SymTable_put(oSymTable, SymAtom_string(oAtom), pvValue);
+}
+
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom) {
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   return SymTable_get(oSymTable, SymAtom_string(oAtom));
+}
+
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash), pvValue, &iInserted, NULL, NULL) == NULL)
+      return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey) {
+   void *pvValue;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   if (!SymTable_read(oSymTable, sKey.pcKey, SymTable_mix(sKey.uHash),
+   &pvValue)) return NULL;
+   return pvValue;
+}
+
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey) {
+   void *pvValue;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_read(oSymTable, sKey.pcKey, SymTable_mix(sKey.uHash),
+   &pvValue);
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   void *pvValue;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (!SymTable_read(oSymTable, pcKey, SymTable_hash(pcKey), &pvValue))
+      return NULL;
+   return pvValue;
+}
+
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder) {
+   assert(oSymTable != NULL);
+
+   /* a binding can only sit in one of its two buckets */
+   return iReorder == SYMTABLE_REORDER_NONE;
+}
+
+void SymTable_optimize(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+}
+
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable) {
+   assert(oSymTable != NULL);
+
+   /* the stored hash codes already keep lookups of absent keys away
+   from the keys */
+   return iEnable == 0;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_delete(oSymTable, pcKey, SymTable_hash(pcKey));
+}
+
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey) {
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_delete(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash));
+}
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+      struct STArray *psArray;
+      size_t b;
+      int i;
+
+      assert(oSymTable != NULL);
+      assert(pfApply != NULL);
+
+      pthread_mutex_lock(&oSymTable->displaceLock);
+      for (i = 0; i < STRIPES; i++) {
+         pthread_mutex_lock(&oSymTable->asStripes[i].lock);
+      }
+
+      psArray = oSymTable->psArray;
+      for (b = 0; b <= psArray->uMask; b++) {
+         for (i = 0; i < SLOTS; i++) {
+            if (psArray->psBuckets[b].apcKeys[i] != NULL) {
+               (*pfApply)(psArray->psBuckets[b].apcKeys[i],
+               psArray->psBuckets[b].apvValues[i],
+               (void*)pvExtra);
+            }
+         }
+      }
+
+      for (i = STRIPES - 1; i >= 0; i--) {
+         pthread_mutex_unlock(&oSymTable->asStripes[i].lock);
+      }
+      pthread_mutex_unlock(&oSymTable->displaceLock);
+   }
+
+void SymTable_mapBatch(SymTable_T oSymTable,
+   void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra),
+   const void *pvExtra, size_t uBatchSize) {
+   struct STBatch sBatch;
+   struct STArray *psArray;
+   size_t b;
+   int i;
+
+   assert(oSymTable != NULL);
+   assert(pfApplyBatch != NULL);
+
+   /* the arrays are only allocated outside an arena, where the
+   allocator is thread safe */
+   STBatch_init(&sBatch, pfApplyBatch, pvExtra, uBatchSize,
+   &oSymTable->sMemory);
+
+   pthread_mutex_lock(&oSymTable->displaceLock);
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_lock(&oSymTable->asStripes[i].lock);
+   }
+
+   psArray = oSymTable->psArray;
+   for (b = 0; b <= psArray->uMask; b++) {
+      for (i = 0; i < SLOTS; i++) {
+         if (psArray->psBuckets[b].apcKeys[i] != NULL) {
+            STBatch_add(&sBatch, psArray->psBuckets[b].apcKeys[i],
+            psArray->psBuckets[b].apvValues[i]);
+         }
+      }
+   }
+   STBatch_finish(&sBatch);
+
+   for (i = STRIPES - 1; i >= 0; i--) {
+      pthread_mutex_unlock(&oSymTable->asStripes[i].lock);
+   }
+   pthread_mutex_unlock(&oSymTable->displaceLock);
+}
+
+/* Lock every stripe of oSymTable, and its displacements and growth,
+so that no other thread changes it */
+static void SymTable_lockAll(SymTable_T oSymTable)
+{
+   int i;
+
+   pthread_mutex_lock(&oSymTable->displaceLock);
+   for (i = 0; i < STRIPES; i++) {
+      pthread_mutex_lock(&oSymTable->asStripes[i].lock);
+   }
+}
+
+/* Undo SymTable_lockAll on oSymTable */
+static void SymTable_unlockAll(SymTable_T oSymTable)
+{
+   int i;
+
+   for (i = STRIPES - 1; i >= 0; i--) {
+      pthread_mutex_unlock(&oSymTable->asStripes[i].lock);
+   }
+   pthread_mutex_unlock(&oSymTable->displaceLock);
+}
+
+/* Return a pointer to the value of the binding with key pcKey and
+hash code uHash in psArray, or NULL if there is none. The caller must
+hold the stripes of both buckets of pcKey */
+static void **SymTable_findValue(struct STArray *psArray,
+const char *pcKey, size_t uHash)
+{
+   size_t uBucket;
+   int iSlot;
+
+   uBucket = SymTable_index1(uHash, psArray->uMask);
+   iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   if (iSlot < 0) {
+      uBucket = SymTable_index2(uHash, psArray->uMask);
+      iSlot = SymTable_findSlot(psArray, uBucket, pcKey, uHash);
+   }
+   if (iSlot < 0) return NULL;
+
+   return &psArray->psBuckets[uBucket].apvValues[iSlot];
+}
+
+/* Remove the bindings of oSymTable that the STMERGE_INTERSECT or
+STMERGE_DIFF psMerge does not keep, given the bindings of oOther. The
+stored hash codes serve for the lookups in oOther */
+static void SymTable_reduce(SymTable_T oSymTable, SymTable_T oOther,
+const struct STMerge *psMerge)
+{
+   struct STArray *psArray;
+   struct STBucket *psBucket;
+   size_t b;
+   int i;
+
+   SymTable_lockAll(oSymTable);
+
+   /* as in SymTable_clear, with every version odd no new reader
+   follows a key pointer, so once the current ones are gone the keys
+   can be freed */
+   for (i = 0; i < STRIPES; i++) {
+      __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+      __ATOMIC_SEQ_CST);
+   }
+   for (i = 0; i < STRIPES; i++) {
+      SymTable_drain(&oSymTable->asStripes[i]);
+   }
+
+   SymTable_lockAll(oOther);
+   psArray = oSymTable->psArray;
+   for (b = 0; b <= psArray->uMask; b++) {
+      psBucket = &psArray->psBuckets[b];
+      for (i = 0; i < SLOTS; i++) {
+         if (psBucket->apcKeys[i] == NULL) continue;
+
+         if (STMerge_keep(psMerge, &oSymTable->sMemory,
+         psBucket->apcKeys[i], &psBucket->apvValues[i],
+         SymTable_findValue(oOther->psArray, psBucket->apcKeys[i],
+         psArray->puHashes[b * SLOTS + i]))) continue;
+
+         SymTable_release(oSymTable, psBucket->apcKeys[i],
+         strlen(psBucket->apcKeys[i]) + 1);
+         __atomic_store_n(&psBucket->apcKeys[i], NULL,
+         __ATOMIC_RELEASE);
+         __atomic_sub_fetch(&oSymTable->size, 1, __ATOMIC_RELAXED);
+      }
+   }
+   SymTable_unlockAll(oOther);
+
+   for (i = 0; i < STRIPES; i++) {
+      __atomic_add_fetch(&oSymTable->asStripes[i].uVersion, 1,
+      __ATOMIC_SEQ_CST);
+   }
+   SymTable_unlockAll(oSymTable);
+}
+
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   const void *pvExtra) {
+   struct STMerge sMerge;
+   struct STArray *psArray;
+   struct STBucket *psBucket;
+   size_t b;
+   int iInserted;
+   int iSuccessful = 1;
+   int i;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_MERGE, pfResolve, NULL, NULL,
+   pvExtra);
+
+   /* oOther holds still while its bindings are put into oSymTable,
+   with the hash codes stored next to them */
+   SymTable_lockAll(oOther);
+   psArray = oOther->psArray;
+   for (b = 0; b <= psArray->uMask && iSuccessful; b++) {
+      psBucket = &psArray->psBuckets[b];
+      for (i = 0; i < SLOTS && iSuccessful; i++) {
+         if (psBucket->apcKeys[i] == NULL) continue;
+
+         iSuccessful = SymTable_lookupOrInsert(oSymTable,
+         psBucket->apcKeys[i], psArray->puHashes[b * SLOTS + i],
+         psBucket->apvValues[i], &iInserted, NULL, &sMerge) != NULL;
+      }
+   }
+   SymTable_unlockAll(oOther);
+
+   return iSuccessful;
+}
+
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_INTERSECT, pfResolve, NULL,
+   pfFreeValue, pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
+
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+   int (*pfKeep)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_DIFF, NULL, pfKeep, pfFreeValue,
+   pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
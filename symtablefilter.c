@@ -0,0 +1,163 @@
+/*--------------------------------------------------------------------*/
+/* symtablefilter.c                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "symtablefilter.h"
+
+/* Size of a block in bytes, one cache line */
+enum {BLOCK_SIZE = 64};
+
+/* Number of bits in a block */
+enum {BLOCK_BITS = BLOCK_SIZE * 8};
+
+/* Number of filter bits per key, with BITS_PER_KEY bits and
+HASH_COUNT bits set per key about 1 in 100 absent keys gets through */
+enum {BITS_PER_KEY = 10, HASH_COUNT = 6};
+
+/* Fewest keys a filter is sized for */
+enum {MIN_CAPACITY = 64};
+
+/* Return uHash mixed so that all of its bits depend on all bits of
+uHash */
+static size_t STFilter_mix(size_t uHash)
+{
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+   return uHash;
+}
+
+/* Return the allocated size of the blocks of psFilter */
+static size_t STFilter_size(const struct STFilter *psFilter)
+{
+   return psFilter->uBlocks * BLOCK_SIZE + BLOCK_SIZE;
+}
+
+void STFilter_init(struct STFilter *psFilter)
+{
+   assert(psFilter != NULL);
+
+   psFilter->pucBlocks = NULL;
+   psFilter->uBlocks = 0;
+   psFilter->pvBlock = NULL;
+   psFilter->uCapacity = 0;
+   psFilter->uRemoved = 0;
+}
+
+int STFilter_reset(struct STFilter *psFilter,
+struct STMemory *psMemory, size_t uCapacity)
+{
+   size_t uAddress;
+
+   assert(psFilter != NULL);
+   assert(psMemory != NULL);
+
+   STFilter_free(psFilter, psMemory);
+
+   if (uCapacity < MIN_CAPACITY) uCapacity = MIN_CAPACITY;
+   psFilter->uBlocks = (uCapacity * BITS_PER_KEY + BLOCK_BITS - 1)
+   / BLOCK_BITS;
+
+   psFilter->pvBlock = STMemory_alloc(psMemory,
+   STFilter_size(psFilter));
+   if (psFilter->pvBlock == NULL) {
+      /* stay without blocks until the keys outgrow uCapacity, rather
+      than trying again for every key */
+      STFilter_init(psFilter);
+      psFilter->uCapacity = uCapacity;
+      return 0;
+   }
+
+   uAddress = (size_t)psFilter->pvBlock;
+   psFilter->pucBlocks = (unsigned char*)psFilter->pvBlock
+   + (BLOCK_SIZE - uAddress % BLOCK_SIZE) % BLOCK_SIZE;
+   memset(psFilter->pucBlocks, 0, psFilter->uBlocks * BLOCK_SIZE);
+   psFilter->uCapacity = uCapacity;
+   psFilter->uRemoved = 0;
+   return 1;
+}
+
+void STFilter_free(struct STFilter *psFilter,
+struct STMemory *psMemory)
+{
+   assert(psFilter != NULL);
+   assert(psMemory != NULL);
+
+   STMemory_free(psMemory, psFilter->pvBlock, STFilter_size(psFilter));
+   STFilter_init(psFilter);
+}
+
+void STFilter_clear(struct STFilter *psFilter)
+{
+   assert(psFilter != NULL);
+
+   if (psFilter->pucBlocks != NULL)
+      memset(psFilter->pucBlocks, 0, psFilter->uBlocks * BLOCK_SIZE);
+   psFilter->uRemoved = 0;
+}
+
+void STFilter_add(struct STFilter *psFilter, size_t uHash)
+{
+   unsigned char *pucBlock;
+   size_t uMixed, uStep, uBit;
+   int i;
+
+   assert(psFilter != NULL);
+
+   if (psFilter->pucBlocks == NULL) return;
+
+   uMixed = STFilter_mix(uHash);
+   pucBlock = psFilter->pucBlocks
+   + (uMixed % psFilter->uBlocks) * BLOCK_SIZE;
+
+   /* the bits within the block come from double hashing */
+   uStep = (uMixed >> 9) | 1;
+   for (i = 0, uBit = uHash; i < HASH_COUNT; i++, uBit += uStep) {
+      pucBlock[(uBit % BLOCK_BITS) / 8] |=
+      (unsigned char)(1 << (uBit % 8));
+   }
+}
+
+void STFilter_remove(struct STFilter *psFilter)
+{
+   assert(psFilter != NULL);
+
+   psFilter->uRemoved++;
+}
+
+int STFilter_mayContain(const struct STFilter *psFilter, size_t uHash)
+{
+   const unsigned char *pucBlock;
+   size_t uMixed, uStep, uBit;
+   int i;
+
+   assert(psFilter != NULL);
+
+   if (psFilter->pucBlocks == NULL) return 1;
+
+   uMixed = STFilter_mix(uHash);
+   pucBlock = psFilter->pucBlocks
+   + (uMixed % psFilter->uBlocks) * BLOCK_SIZE;
+
+   uStep = (uMixed >> 9) | 1;
+   for (i = 0, uBit = uHash; i < HASH_COUNT; i++, uBit += uStep) {
+      if ((pucBlock[(uBit % BLOCK_BITS) / 8] & (1 << (uBit % 8))) == 0)
+         return 0;
+   }
+
+   return 1;
+}
+
+int STFilter_needsRebuild(const struct STFilter *psFilter,
+size_t uKeys)
+{
+   assert(psFilter != NULL);
+
+   return uKeys > psFilter->uCapacity
+   || psFilter->uRemoved > uKeys + MIN_CAPACITY;
+}
@@ -0,0 +1,65 @@
+/*--------------------------------------------------------------------*/
+/* symtablefilter.h                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEFILTER_INCLUDED
+#define SYMTABLEFILTER_INCLUDED
+
+#include <stddef.h>
+#include "symtablememory.h"
+
+/* STFilter is a blocked Bloom filter over the hash codes of the keys
+of a SymTable: every key sets a few bits in a single 64 byte block, so
+asking whether a key may be present reads one cache line. Bits cannot
+be taken back, so removed keys are only counted and the filter is
+rebuilt once they dominate */
+struct STFilter
+{
+   /* the blocks, aligned to 64 bytes, NULL while there are none */
+   unsigned char *pucBlocks;
+   /* the number of blocks */
+   size_t uBlocks;
+   /* the block the blocks were aligned within */
+   void *pvBlock;
+   /* the number of keys the filter was sized for */
+   size_t uCapacity;
+   /* the number of keys removed since the filter was built */
+   size_t uRemoved;
+};
+
+/* Set up psFilter without any blocks, such a filter answers that
+every key may be present */
+void STFilter_init(struct STFilter *psFilter);
+
+/* Replace the blocks of psFilter with empty ones sized for uCapacity
+keys, taken from psMemory. Returns 1 on success or 0 if there is not
+enough memory, in which case psFilter has no blocks */
+int STFilter_reset(struct STFilter *psFilter,
+struct STMemory *psMemory, size_t uCapacity);
+
+/* Give the blocks of psFilter back to psMemory, leaving it without
+blocks */
+void STFilter_free(struct STFilter *psFilter,
+struct STMemory *psMemory);
+
+/* Forget every key recorded in psFilter, keeping its blocks */
+void STFilter_clear(struct STFilter *psFilter);
+
+/* Record in psFilter a key with hash code uHash */
+void STFilter_add(struct STFilter *psFilter, size_t uHash);
+
+/* Record in psFilter that a key was removed */
+void STFilter_remove(struct STFilter *psFilter);
+
+/* Return 0 if no key with hash code uHash was added to psFilter since
+it was reset, and 1 if one may have been */
+int STFilter_mayContain(const struct STFilter *psFilter, size_t uHash);
+
+/* Return 1 if psFilter, holding uKeys keys, should be reset and filled
+again because it is too full or too many keys were removed from it,
+and 0 otherwise */
+int STFilter_needsRebuild(const struct STFilter *psFilter,
+size_t uKeys);
+
+#endif
@@ -0,0 +1,388 @@
+/*--------------------------------------------------------------------*/
+/* symtablefrozen.c                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtablefrozen.h"
+
+/* Number of keys in a block. The first key of a block is stored
+whole with its '\0', every other key as the varint length of the
+prefix it shares with the key before it, the varint length of the
+rest and the rest, without a '\0' */
+enum {BLOCK_KEYS = 16};
+
+/* SymTableFrozen is the structure for an immutable table with sorted
+and front coded keys */
+struct SymTableFrozen
+{
+   /* the number of bindings */
+   size_t uLength;
+   /* the number of blocks and the offset of each within pucKeys */
+   size_t uBlocks;
+   size_t *puBlocks;
+   /* the blocks of keys and their total size in bytes */
+   unsigned char *pucKeys;
+   size_t uKeysSize;
+   /* the values, in the order of the keys */
+   void **ppvValues;
+   /* the length of the longest key */
+   size_t uMaxKeyLength;
+};
+
+/* STFrozenBinding is a binding of the SymTable a SymTableFrozen is
+made from */
+struct STFrozenBinding
+{
+   const char *pcKey;
+   void *pvValue;
+};
+
+/* STFrozenBuilder collects the bindings of a SymTable */
+struct STFrozenBuilder
+{
+   /* the bindings collected so far */
+   struct STFrozenBinding *psBindings;
+   size_t uCount;
+};
+
+/* Add the binding of pcKey to pvValue to the STFrozenBuilder
+pvBuilder, called by SymTable_map */
+static void SymTableFrozen_collect(const char *pcKey, void *pvValue,
+void *pvBuilder)
+{
+   struct STFrozenBuilder *psBuilder =
+   (struct STFrozenBuilder*)pvBuilder;
+
+   psBuilder->psBindings[psBuilder->uCount].pcKey = pcKey;
+   psBuilder->psBindings[psBuilder->uCount].pvValue = pvValue;
+   psBuilder->uCount++;
+}
+
+/* Compare the keys of the STFrozenBindings pvFirst and pvSecond as
+strcmp does, for qsort */
+static int SymTableFrozen_compare(const void *pvFirst,
+const void *pvSecond)
+{
+   return strcmp(((const struct STFrozenBinding*)pvFirst)->pcKey,
+   ((const struct STFrozenBinding*)pvSecond)->pcKey);
+}
+
+/* Return the number of bytes of uValue as a varint */
+static size_t SymTableFrozen_varintSize(size_t uValue)
+{
+   size_t uSize = 1;
+
+   while (uValue >= 0x80) {
+      uValue >>= 7;
+      uSize++;
+   }
+   return uSize;
+}
+
+/* Store uValue at pucData as a varint and return the byte after it */
+static unsigned char *SymTableFrozen_putVarint(unsigned char *pucData,
+size_t uValue)
+{
+   while (uValue >= 0x80) {
+      *pucData++ = (unsigned char)(uValue | 0x80);
+      uValue >>= 7;
+   }
+   *pucData++ = (unsigned char)uValue;
+   return pucData;
+}
+
+/* Store in *puValue the varint at pucData and return the byte after
+it */
+static const unsigned char *SymTableFrozen_getVarint(
+const unsigned char *pucData, size_t *puValue)
+{
+   size_t uValue = 0;
+   int iShift = 0;
+
+   while (*pucData >= 0x80) {
+      uValue |= (size_t)(*pucData++ & 0x7f) << iShift;
+      iShift += 7;
+   }
+   *puValue = uValue | (size_t)*pucData++ << iShift;
+   return pucData;
+}
+
+/* Return the length of the prefix pcFirst and pcSecond share */
+static size_t SymTableFrozen_shared(const char *pcFirst,
+const char *pcSecond)
+{
+   size_t u = 0;
+
+   while (pcFirst[u] != '\0' && pcFirst[u] == pcSecond[u]) u++;
+   return u;
+}
+
+/* Store the sorted bindings psBindings, uCount of them, in oFrozen,
+whose arrays are allocated, as front coded blocks */
+static void SymTableFrozen_encode(SymTableFrozen_T oFrozen,
+const struct STFrozenBinding *psBindings, size_t uCount)
+{
+   unsigned char *pucData = oFrozen->pucKeys;
+   size_t uShared;
+   size_t uLength;
+   size_t u;
+
+   for (u = 0; u < uCount; u++) {
+      oFrozen->ppvValues[u] = psBindings[u].pvValue;
+      uLength = strlen(psBindings[u].pcKey);
+
+      if (u % BLOCK_KEYS == 0) {
+         oFrozen->puBlocks[u / BLOCK_KEYS] =
+         (size_t)(pucData - oFrozen->pucKeys);
+         memcpy(pucData, psBindings[u].pcKey, uLength + 1);
+         pucData += uLength + 1;
+         continue;
+      }
+
+      uShared = SymTableFrozen_shared(psBindings[u - 1].pcKey,
+      psBindings[u].pcKey);
+      pucData = SymTableFrozen_putVarint(pucData, uShared);
+      pucData = SymTableFrozen_putVarint(pucData, uLength - uShared);
+      memcpy(pucData, psBindings[u].pcKey + uShared, uLength - uShared);
+      pucData += uLength - uShared;
+   }
+}
+
+/* Return the number of bytes the sorted bindings psBindings, uCount
+of them, take as front coded blocks, and store the length of the
+longest key in *puMaxKeyLength */
+static size_t SymTableFrozen_encodedSize(
+const struct STFrozenBinding *psBindings, size_t uCount,
+size_t *puMaxKeyLength)
+{
+   size_t uSize = 0;
+   size_t uShared;
+   size_t uLength;
+   size_t u;
+
+   *puMaxKeyLength = 0;
+   for (u = 0; u < uCount; u++) {
+      uLength = strlen(psBindings[u].pcKey);
+      if (uLength > *puMaxKeyLength) *puMaxKeyLength = uLength;
+
+      if (u % BLOCK_KEYS == 0) {
+         uSize += uLength + 1;
+         continue;
+      }
+      uShared = SymTableFrozen_shared(psBindings[u - 1].pcKey,
+      psBindings[u].pcKey);
+      uSize += SymTableFrozen_varintSize(uShared)
+      + SymTableFrozen_varintSize(uLength - uShared)
+      + uLength - uShared;
+   }
+   return uSize;
+}
+
+/* Return the last block of oFrozen whose first key is not greater
+than pcKey, or uBlocks if there is none */
+static size_t SymTableFrozen_block(SymTableFrozen_T oFrozen,
+const char *pcKey)
+{
+   size_t uLow = 0;
+   size_t uHigh = oFrozen->uBlocks;
+   size_t uMiddle;
+
+   /* the answer is uLow - 1, blocks below uLow start at most at
+   pcKey and blocks from uHigh on start after it */
+   while (uLow < uHigh) {
+      uMiddle = uLow + (uHigh - uLow) / 2;
+      if (strcmp((const char*)oFrozen->pucKeys
+      + oFrozen->puBlocks[uMiddle], pcKey) <= 0)
+         uLow = uMiddle + 1;
+      else
+         uHigh = uMiddle;
+   }
+   return uLow == 0 ? oFrozen->uBlocks : uLow - 1;
+}
+
+/* Return the index of the binding of pcKey in oFrozen, or uLength if
+there is none. The block is scanned without rebuilding its keys:
+uMatch is how much of pcKey the key before matches, and a key that
+shares more than that with the key before is still smaller than
+pcKey, one that shares less is greater */
+static size_t SymTableFrozen_find(SymTableFrozen_T oFrozen,
+const char *pcKey)
+{
+   const unsigned char *pucData;
+   const char *pcSuffix;
+   size_t uBlock;
+   size_t uMatch;
+   size_t uShared;
+   size_t uSuffix;
+   size_t uIndex;
+   size_t u;
+
+   uBlock = SymTableFrozen_block(oFrozen, pcKey);
+   if (uBlock == oFrozen->uBlocks) return oFrozen->uLength;
+
+   uIndex = uBlock * BLOCK_KEYS;
+   pcSuffix = (const char*)oFrozen->pucKeys + oFrozen->puBlocks[uBlock];
+   uMatch = SymTableFrozen_shared(pcSuffix, pcKey);
+   if (pcSuffix[uMatch] == '\0' && pcKey[uMatch] == '\0') return uIndex;
+   pucData = (const unsigned char*)pcSuffix + strlen(pcSuffix) + 1;
+
+   for (uIndex++; uIndex < oFrozen->uLength
+   && uIndex % BLOCK_KEYS != 0; uIndex++) {
+      pucData = SymTableFrozen_getVarint(pucData, &uShared);
+      pucData = SymTableFrozen_getVarint(pucData, &uSuffix);
+      pcSuffix = (const char*)pucData;
+      pucData += uSuffix;
+
+      if (uShared > uMatch) continue;
+      if (uShared < uMatch) break;
+
+      for (u = 0; u < uSuffix && pcSuffix[u] == pcKey[uMatch + u]; u++)
+         ;
+      if (u == uSuffix && pcKey[uMatch + u] == '\0') return uIndex;
+      if (u < uSuffix && (unsigned char)pcSuffix[u]
+      > (unsigned char)pcKey[uMatch + u]) break;
+      uMatch += u;
+   }
+   return oFrozen->uLength;
+}
+
+SymTableFrozen_T SymTableFrozen_new(SymTable_T oSymTable) {
+   SymTableFrozen_T oFrozen;
+   struct STFrozenBuilder sBuilder;
+   size_t uLength;
+
+   assert(oSymTable != NULL);
+
+   uLength = SymTable_getLength(oSymTable);
+   sBuilder.uCount = 0;
+   sBuilder.psBindings = (struct STFrozenBinding*)malloc(
+   (uLength + 1) * sizeof(struct STFrozenBinding));
+   if (sBuilder.psBindings == NULL) return NULL;
+
+   SymTable_map(oSymTable, SymTableFrozen_collect, &sBuilder);
+   assert(sBuilder.uCount == uLength);
+   qsort(sBuilder.psBindings, uLength, sizeof(struct STFrozenBinding),
+   SymTableFrozen_compare);
+
+   oFrozen = (SymTableFrozen_T)malloc(sizeof(struct SymTableFrozen));
+   if (oFrozen == NULL) {
+      free(sBuilder.psBindings);
+      return NULL;
+   }
+   oFrozen->uLength = uLength;
+   oFrozen->uBlocks = (uLength + BLOCK_KEYS - 1) / BLOCK_KEYS;
+   oFrozen->uKeysSize = SymTableFrozen_encodedSize(sBuilder.psBindings,
+   uLength, &oFrozen->uMaxKeyLength);
+   /* one more of each, so that an empty table allocates something */
+   oFrozen->puBlocks = (size_t*)malloc(
+   (oFrozen->uBlocks + 1) * sizeof(size_t));
+   oFrozen->pucKeys = (unsigned char*)malloc(oFrozen->uKeysSize + 1);
+   oFrozen->ppvValues = (void**)malloc((uLength + 1) * sizeof(void*));
+   if (oFrozen->puBlocks == NULL || oFrozen->pucKeys == NULL
+   || oFrozen->ppvValues == NULL) {
+      SymTableFrozen_free(oFrozen);
+      free(sBuilder.psBindings);
+      return NULL;
+   }
+
+   SymTableFrozen_encode(oFrozen, sBuilder.psBindings, uLength);
+   free(sBuilder.psBindings);
+   return oFrozen;
+}
+
+void SymTableFrozen_free(SymTableFrozen_T oFrozen) {
+   assert(oFrozen != NULL);
+
+   free(oFrozen->puBlocks);
+   free(oFrozen->pucKeys);
+   free(oFrozen->ppvValues);
+   free(oFrozen);
+}
+
+size_t SymTableFrozen_getLength(SymTableFrozen_T oFrozen) {
+   assert(oFrozen != NULL);
+
+   return oFrozen->uLength;
+}
+
+size_t SymTableFrozen_getSize(SymTableFrozen_T oFrozen) {
+   assert(oFrozen != NULL);
+
+   return sizeof(struct SymTableFrozen)
+   + oFrozen->uBlocks * sizeof(size_t) + oFrozen->uKeysSize
+   + oFrozen->uLength * sizeof(void*);
+}
+
+int SymTableFrozen_contains(SymTableFrozen_T oFrozen,
+const char *pcKey) {
+   assert(oFrozen != NULL);
+   assert(pcKey != NULL);
+
+   return SymTableFrozen_find(oFrozen, pcKey) < oFrozen->uLength;
+}
+
+void *SymTableFrozen_get(SymTableFrozen_T oFrozen, const char *pcKey) {
+   size_t uIndex;
+
+   assert(oFrozen != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTableFrozen_find(oFrozen, pcKey);
+   if (uIndex == oFrozen->uLength) return NULL;
+   return oFrozen->ppvValues[uIndex];
+}
+
+int SymTableFrozen_map(SymTableFrozen_T oFrozen, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra) {
+   const unsigned char *pucData;
+   char *pcKey;
+   size_t uPrefixLength;
+   size_t uBlock;
+   size_t uShared;
+   size_t uSuffix;
+   size_t uIndex;
+   int iCompare;
+
+   assert(oFrozen != NULL);
+   assert(pcPrefix != NULL);
+   assert(pfApply != NULL);
+
+   pcKey = (char*)malloc(oFrozen->uMaxKeyLength + 1);
+   if (pcKey == NULL) return 0;
+
+   /* start at the block the prefix itself would be in */
+   uBlock = SymTableFrozen_block(oFrozen, pcPrefix);
+   if (uBlock == oFrozen->uBlocks) uBlock = 0;
+   uPrefixLength = strlen(pcPrefix);
+   pucData = oFrozen->pucKeys;
+
+   for (uIndex = uBlock * BLOCK_KEYS; uIndex < oFrozen->uLength;
+   uIndex++) {
+      if (uIndex % BLOCK_KEYS == 0) {
+         pucData = oFrozen->pucKeys
+         + oFrozen->puBlocks[uIndex / BLOCK_KEYS];
+         strcpy(pcKey, (const char*)pucData);
+         pucData += strlen(pcKey) + 1;
+      }
+      else {
+         pucData = SymTableFrozen_getVarint(pucData, &uShared);
+         pucData = SymTableFrozen_getVarint(pucData, &uSuffix);
+         memcpy(pcKey + uShared, pucData, uSuffix);
+         pcKey[uShared + uSuffix] = '\0';
+         pucData += uSuffix;
+      }
+
+      iCompare = strncmp(pcKey, pcPrefix, uPrefixLength);
+      if (iCompare > 0) break;
+      if (iCompare == 0)
+         (*pfApply)(pcKey, oFrozen->ppvValues[uIndex],
+         (void*)pvExtra);
+   }
+
+   free(pcKey);
+   return 1;
+}
@@ -0,0 +1,57 @@
+/*--------------------------------------------------------------------*/
+/* symtablefrozen.h                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEFROZEN_INCLUDED
+#define SYMTABLEFROZEN_INCLUDED
+
+#include <stddef.h>
+#include "symtable.h"
+
+/* Define type SymTableFrozen_T to be a pointer towards a
+SymTableFrozen, an immutable copy of the bindings of a SymTable made
+to take as little memory as possible. The keys are sorted and stored
+in blocks of 16, each key after the first of a block keeping only
+what differs from the key before it, and a lookup binary searches the
+first keys of the blocks before it scans one block. The values are
+kept in a parallel array. A SymTableFrozen can be read by any number
+of threads at once */
+typedef struct SymTableFrozen *SymTableFrozen_T;
+
+/* Return a SymTableFrozen holding copies of the keys of oSymTable
+bound to the same values, or NULL if there is not enough memory. The
+values of a SymTable made by SymTable_newSized point into it, so
+oSymTable must then outlive the SymTableFrozen */
+SymTableFrozen_T SymTableFrozen_new(SymTable_T oSymTable);
+
+/* Free oFrozen, but not its values */
+void SymTableFrozen_free(SymTableFrozen_T oFrozen);
+
+/* Return the number of bindings in oFrozen */
+size_t SymTableFrozen_getLength(SymTableFrozen_T oFrozen);
+
+/* Return the number of bytes oFrozen takes, including its values
+array but not the values themselves */
+size_t SymTableFrozen_getSize(SymTableFrozen_T oFrozen);
+
+/* Return 1 if oFrozen contains a binding whose key is pcKey, and 0
+otherwise */
+int SymTableFrozen_contains(SymTableFrozen_T oFrozen,
+const char *pcKey);
+
+/* Return the value of the binding within oFrozen whose key is pcKey,
+or NULL if no such binding exists */
+void *SymTableFrozen_get(SymTableFrozen_T oFrozen, const char *pcKey);
+
+/* Apply function pfApply to every binding in oFrozen whose key starts
+with pcPrefix, in increasing order of the keys as by strcmp, passing
+pvExtra along. An empty pcPrefix visits every binding. Returns 1 on
+success or 0, without calling pfApply, if there is not enough memory
+to rebuild the keys. The key passed to pfApply is only valid during
+the call */
+int SymTableFrozen_map(SymTableFrozen_T oFrozen, const char *pcPrefix,
+void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+const void *pvExtra);
+
+#endif
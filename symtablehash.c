@@ -4,9 +4,16 @@
 /*--------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "symtable.h"
+#include "symtablefilter.h"
+#include "symtablebatch.h"
+#include "symtablememory.h"
+#include "symtablereclaim.h"
+#include "symtablemerge.h"
 
 /* Constant array of the bucket size thresholds */
 static const size_t BUCKETSIZE[8] = {509, 1021, 2039, 4093, 8191,
@@ -15,6 +22,14 @@ static const size_t BUCKETSIZE[8] = {509, 1021, 2039, 4093, 8191,
 static const size_t BUCKETCOUNT = 
 sizeof(BUCKETSIZE)/sizeof(BUCKETSIZE[0]);
 
+/* Number of bindings a SymTable holds inline before it allocates its
+bucket array */
+enum {SMALL_CAPACITY = 8};
+
+/* A chain of a hardened SymTable longer than TREEIFY_LENGTH is also
+searched as a balanced tree, until it shrinks to UNTREEIFY_LENGTH */
+enum {TREEIFY_LENGTH = 8, UNTREEIFY_LENGTH = 6};
+
 /* STBinding is the structure for a node in SymTable that contains a
 key-value pair and the next binding that follows it to form a linked
 list */
@@ -26,10 +41,43 @@ struct STBinding
    void *pvValue;
    /* the next node in the linked list */
    struct STBinding *psNextNode;
+   /* the number of lookups that found the binding since the last
+   SymTable_optimize, only counted when reordering is enabled */
+   size_t uHits;
+};
+
+/* STTreeNode is the node of a binding in a hardened SymTable, its
+binding comes first so that it can be used wherever a binding is. The
+node stays in its chain when the chain becomes a tree, so only lookups
+need to know about trees */
+struct STTreeNode
+{
+   /* the binding */
+   struct STBinding sBinding;
+   /* the subtree with smaller keys */
+   struct STTreeNode *psLeft;
+   /* the subtree with larger keys */
+   struct STTreeNode *psRight;
+   /* the node before this one in the chain, kept while the chain is a
+   tree so that a node can be unlinked without walking the chain */
+   struct STTreeNode *psPrevNode;
+   /* the height of the subtree rooted at this node */
+   int iHeight;
+};
+
+/* STTree is the AVL tree over one chain of a hardened SymTable */
+struct STTree
+{
+   /* the root, NULL while the chain is short and searched linearly */
+   struct STTreeNode *psRoot;
+   /* the number of nodes in the chain while psRoot is not NULL */
+   size_t uLength;
 };
 
 /* SymTable is the structure for a SymTable that contains its size and
-a pointer to the array of separate chaining linked lists */
+a pointer to the array of separate chaining linked lists. A small
+SymTable has no bucket array yet and keeps its bindings in the inline
+arrays instead, they are moved into buckets once it outgrows them */
 struct SymTable
 {
    /* the number of bindings in the SymTable */
@@ -39,54 +87,399 @@ struct SymTable
    /* the index of threshold */
    size_t bucketCount;
    /* a pointer towards the buckets array with the separate chaining
-   linked lists */
+   linked lists, NULL while the SymTable is small */
    struct STBinding **buckets;
+   /* the keys of a small SymTable, in insertion order until a remove
+   moves the last one into the place of the removed one */
+   char *apcSmallKeys[SMALL_CAPACITY];
+   /* the values of a small SymTable, parallel to apcSmallKeys */
+   void *apvSmallValues[SMALL_CAPACITY];
+   /* the SYMTABLE_REORDER_* policy applied when a lookup finds a
+   binding */
+   int iReorder;
+   /* 1 if the filter is on, 0 otherwise */
+   int iFilter;
+   /* the filter over the keys in the buckets, used while iFilter is 1
+   and the SymTable is not small */
+   struct STFilter sFilter;
+   /* nodes left over by SymTable_clear, linked through psNextNode and 
+   used before new ones are allocated */
+   struct STBinding *psSpareNodes;
+   /* 1 if the SymTable was made with SYMTABLE_HARDENED, its nodes are
+   then STTreeNodes */
+   int iHardened;
+   /* the starting value and multiplier of the hash function, 0 and 
+   65599 unless the SymTable is hardened */
+   size_t uSeed;
+   size_t uMultiplier;
+   /* the trees over the chains, parallel to buckets, for a hardened
+   SymTable that is not small, NULL otherwise */
+   struct STTree *asTrees;
+   /* the most bindings the SymTable holds, 0 if it is not bounded */
+   size_t uMaxBindings;
+   /* called with each binding a bounded SymTable evicts, or NULL */
+   void (*pfEvict)(const char *pcKey, void *pvValue);
+   /* the bucket the clock hand of a bounded SymTable is at */
+   size_t uHand;
+   /* the SymTable of the enclosing scope, or NULL */
+   SymTable_T oParent;
+   /* the source of all memory of the SymTable */
+   struct STMemory sMemory;
 };
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-   inclusive. */
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
+/* Return the full hash code for pcKey in oSymTable, which is reduced
+to a bucket index and also keys the filter */
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey)
 {
-   const size_t HASH_MULTIPLIER = 65599;
    size_t u;
-   size_t uHash = 0;
+   size_t uHash = oSymTable->uSeed;
 
    assert(pcKey != NULL);
 
    for (u = 0; pcKey[u] != '\0'; u++)
-      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+      uHash = uHash * oSymTable->uMultiplier + (size_t)pcKey[u];
+
+   return uHash;
+}
+
+/* Return the hash code of pcKey in oSymTable, taken from *puHash if
+puHash is not NULL and oSymTable is not hardened, since the hash
+function is then the one of SymAtoms and SymKeys */
+static size_t SymTable_keyHash(SymTable_T oSymTable, const char *pcKey,
+const size_t *puHash)
+{
+   if (puHash != NULL && !oSymTable->iHardened) return *puHash;
+   return SymTable_hash(oSymTable, pcKey);
+}
+
+/* Return 1 if pcKey, the key of a binding, equals pcOther and 0
+otherwise, comparing the pointers if iAtom is not 0, which holds when
+both are SymAtoms of an interned SymTable */
+static int SymTable_sameKey(const char *pcKey, const char *pcOther,
+int iAtom)
+{
+   if (iAtom) return pcKey == pcOther;
+   return !strcmp(pcKey, pcOther);
+}
+
+/* Store uCount random numbers in auValues, from /dev/urandom if there
+is one and from the clock and pvSalt otherwise */
+static void SymTable_random(size_t auValues[], size_t uCount,
+const void *pvSalt)
+{
+   FILE *psFile;
+   size_t u;
+
+   psFile = fopen("/dev/urandom", "rb");
+   if (psFile != NULL) {
+      u = fread(auValues, sizeof(size_t), uCount, psFile);
+      fclose(psFile);
+      if (u == uCount) return;
+   }
+
+   for (u = 0; u < uCount; u++) {
+      auValues[u] = (size_t)time(NULL) * 2654435761u
+      ^ (size_t)clock() ^ (size_t)pvSalt ^ (u << 24);
+   }
+}
+
+/* Return the size of the nodes of oSymTable */
+static size_t SymTable_nodeSize(SymTable_T oSymTable)
+{
+   return oSymTable->iHardened ?
+   sizeof(struct STTreeNode) : sizeof(struct STBinding);
+}
+
+/* Return the height of the tree psNode, 0 if it is empty */
+static int SymTable_height(const struct STTreeNode *psNode)
+{
+   return (psNode == NULL) ? 0 : psNode->iHeight;
+}
+
+/* Set the height of psNode from the heights of its subtrees */
+static void SymTable_fixHeight(struct STTreeNode *psNode)
+{
+   int iLeft = SymTable_height(psNode->psLeft);
+   int iRight = SymTable_height(psNode->psRight);
+
+   psNode->iHeight = 1 + ((iLeft > iRight) ? iLeft : iRight);
+}
+
+/* Rotate the tree psNode to the right and return its new root */
+static struct STTreeNode *SymTable_rotateRight(
+struct STTreeNode *psNode)
+{
+   struct STTreeNode *psLeft = psNode->psLeft;
+
+   psNode->psLeft = psLeft->psRight;
+   psLeft->psRight = psNode;
+   SymTable_fixHeight(psNode);
+   SymTable_fixHeight(psLeft);
+   return psLeft;
+}
+
+/* Rotate the tree psNode to the left and return its new root */
+static struct STTreeNode *SymTable_rotateLeft(
+struct STTreeNode *psNode)
+{
+   struct STTreeNode *psRight = psNode->psRight;
+
+   psNode->psRight = psRight->psLeft;
+   psRight->psLeft = psNode;
+   SymTable_fixHeight(psNode);
+   SymTable_fixHeight(psRight);
+   return psRight;
+}
+
+/* Restore the balance of the tree psNode, whose subtrees are balanced
+and differ in height by at most 2, and return its new root */
+static struct STTreeNode *SymTable_balance(struct STTreeNode *psNode)
+{
+   int iBalance;
+
+   SymTable_fixHeight(psNode);
+   iBalance = SymTable_height(psNode->psLeft) 
+   - SymTable_height(psNode->psRight);
+
+   if (iBalance > 1) {
+      if (SymTable_height(psNode->psLeft->psLeft) 
+      < SymTable_height(psNode->psLeft->psRight)) {
+         psNode->psLeft = SymTable_rotateLeft(psNode->psLeft);
+      }
+      return SymTable_rotateRight(psNode);
+   }
+   if (iBalance < -1) {
+      if (SymTable_height(psNode->psRight->psRight) 
+      < SymTable_height(psNode->psRight->psLeft)) {
+         psNode->psRight = SymTable_rotateRight(psNode->psRight);
+      }
+      return SymTable_rotateLeft(psNode);
+   }
+
+   return psNode;
+}
+
+/* Insert psNode, whose key is not in the tree psRoot, into the tree
+and return its new root */
+static struct STTreeNode *SymTable_treeInsert(struct STTreeNode *psRoot,
+struct STTreeNode *psNode)
+{
+   if (psRoot == NULL) {
+      psNode->psLeft = NULL;
+      psNode->psRight = NULL;
+      psNode->iHeight = 1;
+      return psNode;
+   }
+
+   if (strcmp(psNode->sBinding.pcKey, psRoot->sBinding.pcKey) < 0)
+      psRoot->psLeft = SymTable_treeInsert(psRoot->psLeft, psNode);
+   else
+      psRoot->psRight = SymTable_treeInsert(psRoot->psRight, psNode);
+
+   return SymTable_balance(psRoot);
+}
+
+/* Return the node with key pcKey in the tree psRoot, or NULL if there
+is no such node */
+static struct STTreeNode *SymTable_treeFind(struct STTreeNode *psRoot,
+const char *pcKey)
+{
+   int iCompare;
+
+   while (psRoot != NULL) {
+      iCompare = strcmp(pcKey, psRoot->sBinding.pcKey);
+      if (iCompare == 0) break;
+      psRoot = (iCompare < 0) ? psRoot->psLeft : psRoot->psRight;
+   }
+
+   return psRoot;
+}
+
+/* Take the node with the smallest key out of the non-empty tree
+psRoot, store it in *ppsMin and return the new root */
+static struct STTreeNode *SymTable_treeRemoveMin(
+struct STTreeNode *psRoot, struct STTreeNode **ppsMin)
+{
+   if (psRoot->psLeft == NULL) {
+      *ppsMin = psRoot;
+      return psRoot->psRight;
+   }
+
+   psRoot->psLeft = SymTable_treeRemoveMin(psRoot->psLeft, ppsMin);
+   return SymTable_balance(psRoot);
+}
+
+/* Take the node with key pcKey out of the tree psRoot, store it in 
+*ppsRemoved, which is left alone if there is no such node, and return
+the new root */
+static struct STTreeNode *SymTable_treeRemove(struct STTreeNode *psRoot,
+const char *pcKey, struct STTreeNode **ppsRemoved)
+{
+   struct STTreeNode *psMin, *psRight;
+   int iCompare;
+
+   if (psRoot == NULL) return NULL;
+
+   iCompare = strcmp(pcKey, psRoot->sBinding.pcKey);
+   if (iCompare < 0) {
+      psRoot->psLeft = SymTable_treeRemove(psRoot->psLeft, pcKey,
+      ppsRemoved);
+   }
+   else if (iCompare > 0) {
+      psRoot->psRight = SymTable_treeRemove(psRoot->psRight, pcKey,
+      ppsRemoved);
+   }
+   else {
+      *ppsRemoved = psRoot;
+      if (psRoot->psRight == NULL) return psRoot->psLeft;
+
+      /* the smallest larger node takes the place of psRoot */
+      psRight = SymTable_treeRemoveMin(psRoot->psRight, &psMin);
+      psMin->psLeft = psRoot->psLeft;
+      psMin->psRight = psRight;
+      return SymTable_balance(psMin);
+   }
+
+   return SymTable_balance(psRoot);
+}
+
+/* Build the tree over the chain in bucket index of the hardened
+SymTable oSymTable */
+static void SymTable_treeify(SymTable_T oSymTable, size_t index)
+{
+   struct STTree *psTree;
+   struct STTreeNode *psNode, *psPrevious = NULL;
+   struct STBinding *psCurrentNode;
+
+   assert(oSymTable != NULL);
+   assert(oSymTable->asTrees != NULL);
+
+   psTree = &oSymTable->asTrees[index];
+   psTree->psRoot = NULL;
+   psTree->uLength = 0;
+
+   for (psCurrentNode = oSymTable->buckets[index];
+   psCurrentNode != NULL;
+   psCurrentNode = psCurrentNode->psNextNode) {
+      psNode = (struct STTreeNode*)psCurrentNode;
+      psNode->psPrevNode = psPrevious;
+      psTree->psRoot = SymTable_treeInsert(psTree->psRoot, psNode);
+      psTree->uLength++;
+      psPrevious = psNode;
+   }
+}
+
+/* Return the number of nodes in the chain psNode, counting no further
+than TREEIFY_LENGTH + 1 */
+static size_t SymTable_chainLength(const struct STBinding *psNode)
+{
+   size_t uLength;
+
+   for (uLength = 0; psNode != NULL && uLength <= TREEIFY_LENGTH; 
+   psNode = psNode->psNextNode) {
+      uLength++;
+   }
+
+   return uLength;
+}
+
+/* Allocate a cleared tree array for uBuckets buckets from the memory
+of oSymTable, returns NULL if there is not enough memory */
+static struct STTree *SymTable_newTrees(SymTable_T oSymTable,
+size_t uBuckets)
+{
+   struct STTree *asTrees;
+
+   asTrees = (struct STTree*)STMemory_alloc(&oSymTable->sMemory,
+   uBuckets * sizeof(struct STTree));
+   if (asTrees == NULL) return NULL;
+
+   memset(asTrees, 0, uBuckets * sizeof(struct STTree));
+   return asTrees;
+}
+
+/* Size the filter of oSymTable for twice its bindings and add all of
+them, the filter has no blocks if there is not enough memory */
+static void SymTable_rebuildFilter(SymTable_T oSymTable)
+{
+   struct STBinding *psCurrentNode;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(oSymTable->buckets != NULL);
+
+   if (!STFilter_reset(&oSymTable->sFilter, &oSymTable->sMemory,
+   2 * oSymTable->size)) return;
+
+   for (i = 0; i < oSymTable->iBuckets; i++) {
+      for (psCurrentNode = oSymTable->buckets[i]; 
+      psCurrentNode != NULL; 
+      psCurrentNode = psCurrentNode->psNextNode) {
+         STFilter_add(&oSymTable->sFilter, 
+         SymTable_hash(oSymTable, psCurrentNode->pcKey));
+      }
+   }
+}
+
+/* Update the filter of oSymTable, if it is on, after a binding with
+key hash code uHash was inserted, or after one was removed if 
+iInserted is 0 */
+static void SymTable_updateFilter(SymTable_T oSymTable, size_t uHash,
+int iInserted)
+{
+   assert(oSymTable != NULL);
+
+   if (!oSymTable->iFilter || oSymTable->buckets == NULL) return;
 
-   return uHash % uBucketCount;
+   if (iInserted) STFilter_add(&oSymTable->sFilter, uHash);
+   else STFilter_remove(&oSymTable->sFilter);
+
+   if (STFilter_needsRebuild(&oSymTable->sFilter, oSymTable->size))
+      SymTable_rebuildFilter(oSymTable);
 }
 
 /* Expand the size of buckets in oSymTable to the next 
 size threshold and rehashes all bindings, returns a 
-pointer to the expanded SymTable */
+pointer to the expanded SymTable, or NULL if there is not enough
+memory, in which case oSymTable is left unchanged */
 static SymTable_T SymTable_resize(SymTable_T oSymTable)
 {
    struct STBinding *psCurrentNode, *psTempNode;
    struct STBinding **buckets;
+   struct STTree *asTrees = NULL;
    size_t i, oldCount, newHash;
 
    oldCount = oSymTable->bucketCount;
 
    if (oldCount == BUCKETCOUNT - 1) return oSymTable;
 
-   oSymTable->bucketCount++;
-   oSymTable->iBuckets = BUCKETSIZE[oSymTable->bucketCount];
+   buckets = (struct STBinding **)STMemory_alloc(&oSymTable->sMemory,
+   BUCKETSIZE[oldCount + 1] * sizeof(struct STBinding*));
+
+   if (buckets == NULL) return NULL;
+
+   if (oSymTable->asTrees != NULL) {
+      asTrees = SymTable_newTrees(oSymTable, BUCKETSIZE[oldCount + 1]);
+      if (asTrees == NULL) {
+         STMemory_free(&oSymTable->sMemory, buckets,
+         BUCKETSIZE[oldCount + 1] * sizeof(struct STBinding*));
+         return NULL;
+      }
+   }
 
-   buckets = (struct STBinding **)calloc(oSymTable->iBuckets, 
+   memset(buckets, 0, BUCKETSIZE[oldCount + 1] * 
    sizeof(struct STBinding*));
 
-   if (buckets == NULL) return NULL;
+   oSymTable->bucketCount++;
+   oSymTable->iBuckets = BUCKETSIZE[oSymTable->bucketCount];
 
    for (i = 0; i < BUCKETSIZE[oldCount]; i++) {
       for (psCurrentNode = oSymTable->buckets[i]; 
       psCurrentNode != NULL; 
       psCurrentNode = psTempNode) 
       {
-         newHash = SymTable_hash(psCurrentNode->pcKey,
-         oSymTable->iBuckets);
+         newHash = SymTable_hash(oSymTable, psCurrentNode->pcKey)
+         % oSymTable->iBuckets;
 
          psTempNode = psCurrentNode->psNextNode;
          
@@ -95,201 +488,897 @@ static SymTable_T SymTable_resize(SymTable_T oSymTable)
       }
    }
 
-   free(oSymTable->buckets);
+   STMemory_free(&oSymTable->sMemory, oSymTable->buckets,
+   BUCKETSIZE[oldCount] * sizeof(struct STBinding*));
    oSymTable->buckets = buckets;
 
+   if (asTrees != NULL) {
+      STMemory_free(&oSymTable->sMemory, oSymTable->asTrees,
+      BUCKETSIZE[oldCount] * sizeof(struct STTree));
+      oSymTable->asTrees = asTrees;
+      for (i = 0; i < oSymTable->iBuckets; i++) {
+         if (SymTable_chainLength(buckets[i]) > TREEIFY_LENGTH)
+            SymTable_treeify(oSymTable, i);
+      }
+   }
+
    return oSymTable;
 }
 
-SymTable_T SymTable_new(void) {
-   SymTable_T oSymTable;
-   size_t i;
-
-   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
-   if (oSymTable == NULL) return NULL;
-   oSymTable->buckets = 
-   (struct STBinding **)malloc(BUCKETSIZE[0] * sizeof(struct STBinding*));
-   if (oSymTable->buckets == NULL) return NULL;
-
-   if (oSymTable == NULL) return NULL;
+/* Return a node for a new binding of oSymTable, a spare one if there 
+is any, or NULL if there is not enough memory */
+static struct STBinding *SymTable_newNode(SymTable_T oSymTable)
+{
+   struct STBinding *psNode;
 
-   oSymTable->iBuckets = BUCKETSIZE[0];
-   oSymTable->bucketCount = 0;
-   oSymTable->size = 0;
+   assert(oSymTable != NULL);
 
-   for (i = 0; i < BUCKETSIZE[oSymTable->bucketCount]; i++) {
-      oSymTable->buckets[i] = NULL;
+   psNode = oSymTable->psSpareNodes;
+   if (psNode == NULL) {
+      return (struct STBinding*)STMemory_alloc(&oSymTable->sMemory,
+      SymTable_nodeSize(oSymTable));
    }
 
-   return oSymTable;
+   oSymTable->psSpareNodes = psNode->psNextNode;
+   return psNode;
 }
 
-void SymTable_free(SymTable_T oSymTable) {
-   struct STBinding *psCurrentNode;
-   struct STBinding *psNextNode;
+/* Return the index of the binding with key pcKey in the inline arrays
+of the small SymTable oSymTable, or oSymTable->size if there is no
+such binding. Keys are compared as SymTable_sameKey does with iAtom */
+static size_t SymTable_smallFind(SymTable_T oSymTable, 
+const char *pcKey, int iAtom)
+{
    size_t i;
 
    assert(oSymTable != NULL);
+   assert(pcKey != NULL);
 
-   for (i = 0; i < oSymTable->iBuckets; i++) {
-      psCurrentNode = oSymTable->buckets[i];
-      for (; psCurrentNode != NULL; 
-      psCurrentNode = psNextNode) {
-         psNextNode = psCurrentNode->psNextNode;
-         free(psCurrentNode->pcKey);
-         free(psCurrentNode);
-      }
+   for (i = 0; i < oSymTable->size; i++) {
+      if (SymTable_sameKey(oSymTable->apcSmallKeys[i], pcKey, iAtom)) 
+         break;
    }
 
-   free(oSymTable->buckets);
-   free(oSymTable);
-}
-
-size_t SymTable_getLength(SymTable_T oSymTable) {
-   assert(oSymTable != NULL);
-   return oSymTable->size;
+   return i;
 }
 
-int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
-const void *pvValue) {
-   size_t index;
-   struct STBinding *psNewNode, *psCurrentNode;
-   char* keyCopy;
+/* Allocate an array of uBuckets buckets for the small SymTable 
+oSymTable and move its inline bindings into it, returns 1 on success or
+0 if there is not enough memory, in which case oSymTable is left 
+unchanged */
+static int SymTable_promote(SymTable_T oSymTable, size_t uBuckets)
+{
+   struct STBinding *apsNodes[SMALL_CAPACITY];
+   struct STBinding **buckets;
+   size_t i, index;
 
    assert(oSymTable != NULL);
-   assert(pcKey != NULL);
-   
-   if (oSymTable->size == oSymTable->iBuckets) 
-   {
-      oSymTable = SymTable_resize(oSymTable);
+   assert(oSymTable->buckets == NULL);
+
+   buckets = (struct STBinding **)STMemory_alloc(&oSymTable->sMemory,
+   uBuckets * sizeof(struct STBinding*));
+   if (buckets == NULL) return 0;
+   memset(buckets, 0, uBuckets * sizeof(struct STBinding*));
+
+   if (oSymTable->iHardened) {
+      oSymTable->asTrees = SymTable_newTrees(oSymTable, uBuckets);
+      if (oSymTable->asTrees == NULL) {
+         STMemory_free(&oSymTable->sMemory, buckets,
+         uBuckets * sizeof(struct STBinding*));
+         return 0;
+      }
    }
-   index = SymTable_hash(pcKey, oSymTable->iBuckets);
 
-   for (psCurrentNode = oSymTable->buckets[index];
-   psCurrentNode != NULL;
-   psCurrentNode = psCurrentNode->psNextNode) {
-      if (!strcmp(pcKey, psCurrentNode->pcKey)) {
+   for (i = 0; i < oSymTable->size; i++) {
+      apsNodes[i] = SymTable_newNode(oSymTable);
+      if (apsNodes[i] == NULL) {
+         while (i > 0) {
+            apsNodes[--i]->psNextNode = oSymTable->psSpareNodes;
+            oSymTable->psSpareNodes = apsNodes[i];
+         }
+         STMemory_free(&oSymTable->sMemory, buckets,
+         uBuckets * sizeof(struct STBinding*));
+         STMemory_free(&oSymTable->sMemory, oSymTable->asTrees,
+         uBuckets * sizeof(struct STTree));
+         oSymTable->asTrees = NULL;
          return 0;
       }
    }
 
-   keyCopy = malloc(sizeof(char) * (strlen(pcKey) + 1));
-   if (keyCopy == NULL) return 0;
+   for (i = 0; i < oSymTable->size; i++) {
+      index = SymTable_hash(oSymTable, oSymTable->apcSmallKeys[i])
+      % uBuckets;
+      apsNodes[i]->pcKey = oSymTable->apcSmallKeys[i];
+      apsNodes[i]->pvValue = oSymTable->apvSmallValues[i];
+      apsNodes[i]->psNextNode = buckets[index];
+      apsNodes[i]->uHits = 0;
+      buckets[index] = apsNodes[i];
+   }
 
-   keyCopy = strcpy(keyCopy, pcKey);
+   oSymTable->buckets = buckets;
+   oSymTable->iBuckets = uBuckets;
+   oSymTable->bucketCount = 0;
 
-   psNewNode = (struct STBinding*)malloc(sizeof(struct STBinding));
-   if (psNewNode == NULL) return 0;
+   return 1;
+}
 
-   psNewNode->pcKey = keyCopy;
-   psNewNode->pvValue = (void*)pvValue;
-   psNewNode->psNextNode = oSymTable->buckets[index];
+/* Move the binding psNode, found in the chain starting at *ppsHead
+after psPrevious (NULL if psNode is first) which itself follows
+psPrevPrevious, closer to the front of the chain according to
+reordering policy iReorder */
+static void SymTable_reorder(struct STBinding **ppsHead, 
+struct STBinding *psNode, struct STBinding *psPrevious, 
+struct STBinding *psPrevPrevious, int iReorder)
+{
+   assert(ppsHead != NULL);
+   assert(psNode != NULL);
 
-   oSymTable->buckets[index] = psNewNode;
-   oSymTable->size++;
+   if (psPrevious == NULL) return;
 
-   return 1;
+   if (iReorder == SYMTABLE_REORDER_MOVE_TO_FRONT) {
+      psPrevious->psNextNode = psNode->psNextNode;
+      psNode->psNextNode = *ppsHead;
+      *ppsHead = psNode;
+   }
+   else if (iReorder == SYMTABLE_REORDER_TRANSPOSE) {
+      psPrevious->psNextNode = psNode->psNextNode;
+      psNode->psNextNode = psPrevious;
+      if (psPrevPrevious == NULL) *ppsHead = psNode;
+      else psPrevPrevious->psNextNode = psNode;
+   }
 }
 
-void *SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
-const void *pvValue) {
+/* Return a pointer to the value of the binding with key pcKey in 
+oSymTable, or NULL if there is no such binding. The binding is counted
+as a hit and moved according to the reordering policy of oSymTable.
+puHash points to the hash code of pcKey as SymKey_make computes it, or
+is NULL if the caller has none, and iAtom is 1 if pcKey is the string
+of a SymAtom and 0 otherwise */
+static void **SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+const size_t *puHash, int iAtom)
+{
    struct STBinding *psCurrentNode;
-   void *tempValue;
-   size_t index;
+   struct STBinding *psPrevious = NULL, *psPrevPrevious = NULL;
+   struct STTreeNode *psTreeNode;
+   size_t index, uHash;
 
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
 
-   index = SymTable_hash(pcKey, oSymTable->iBuckets);
+   iAtom = iAtom && oSymTable->sMemory.iInterned;
+
+   if (oSymTable->buckets == NULL) {
+      index = SymTable_smallFind(oSymTable, pcKey, iAtom);
+      if (index == oSymTable->size) return NULL;
+
+      /* the values live in the array itself, so moving a binding here
+      would move the value under slot pointers from SymTable_getOrPut,
+      and the array is too short for reordering to pay off */
+      return &oSymTable->apvSmallValues[index];
+   }
+
+   uHash = SymTable_keyHash(oSymTable, pcKey, puHash);
+   if (oSymTable->iFilter 
+   && !STFilter_mayContain(&oSymTable->sFilter, uHash)) return NULL;
+   index = uHash % oSymTable->iBuckets;
+
+   if (oSymTable->asTrees != NULL 
+   && oSymTable->asTrees[index].psRoot != NULL) {
+      /* chain order does not matter to a tree, so only count hits */
+      psTreeNode = SymTable_treeFind(oSymTable->asTrees[index].psRoot,
+      pcKey);
+      if (psTreeNode == NULL) return NULL;
+      if (oSymTable->iReorder != SYMTABLE_REORDER_NONE)
+         psTreeNode->sBinding.uHits++;
+      return &psTreeNode->sBinding.pvValue;
+   }
 
    for (psCurrentNode = oSymTable->buckets[index]; 
    psCurrentNode != NULL; 
    psCurrentNode = psCurrentNode->psNextNode) {
-      if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-         tempValue = psCurrentNode->pvValue;
-         psCurrentNode->pvValue = (void*)pvValue;
-         return tempValue;
+      if (SymTable_sameKey(psCurrentNode->pcKey, pcKey, iAtom)) {
+         /* a bounded SymTable only counts the hit for its clock */
+         if (oSymTable->iReorder != SYMTABLE_REORDER_NONE
+         || oSymTable->uMaxBindings != 0) {
+            psCurrentNode->uHits++;
+            SymTable_reorder(&oSymTable->buckets[index], psCurrentNode,
+            psPrevious, psPrevPrevious, oSymTable->iReorder);
+         }
+         return &psCurrentNode->pvValue;
       }
-    }
+      psPrevPrevious = psPrevious;
+      psPrevious = psCurrentNode;
+   }
 
-    return NULL;
+   return NULL;
 }
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-   struct STBinding *psCurrentNode;
-   size_t index;
-
-   assert(oSymTable != NULL);
-   assert(pcKey != NULL);
+/* Sort the chain psList by decreasing hit count, keeping the relative
+order of bindings with equal counts, and return its new first node */
+static struct STBinding *SymTable_sortByHits(struct STBinding *psList)
+{
+   struct STBinding *psSlow, *psFast, *psSecond;
+   struct STBinding *psMerged = NULL;
+   struct STBinding **ppsTail = &psMerged;
+
+   if (psList == NULL || psList->psNextNode == NULL) return psList;
+
+   /* split the chain in half */
+   psSlow = psList;
+   for (psFast = psList->psNextNode; 
+   psFast != NULL && psFast->psNextNode != NULL;
+   psFast = psFast->psNextNode->psNextNode) {
+      psSlow = psSlow->psNextNode;
+   }
+   psSecond = psSlow->psNextNode;
+   psSlow->psNextNode = NULL;
 
-   index = SymTable_hash(pcKey, oSymTable->iBuckets);
+   psList = SymTable_sortByHits(psList);
+   psSecond = SymTable_sortByHits(psSecond);
 
-   for (psCurrentNode = oSymTable->buckets[index]; 
-   psCurrentNode != NULL; 
-   psCurrentNode = psCurrentNode->psNextNode) {
-      if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-         return 1;
+   while (psList != NULL && psSecond != NULL) {
+      if (psList->uHits >= psSecond->uHits) {
+         *ppsTail = psList;
+         psList = psList->psNextNode;
       }
+      else {
+         *ppsTail = psSecond;
+         psSecond = psSecond->psNextNode;
+      }
+      ppsTail = &(*ppsTail)->psNextNode;
    }
+   *ppsTail = (psList != NULL) ? psList : psSecond;
 
-   return 0;
+   return psMerged;
 }
 
-void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
-   struct STBinding *psCurrentNode;
-   size_t index;
+/* Remove a binding from the full bounded SymTable oSymTable to make
+room for a new one, choosing it with the clock. The hand moves from
+bucket to bucket, clearing the hit counts of the bindings it passes
+and stopping at the first binding whose count was already 0, which is
+passed to the eviction function and its node kept as a spare. Each
+cleared count was paid for by a hit, and a bounded SymTable has one 
+bucket per binding it holds when full, so the empty buckets a sweep 
+passes are no more than the bindings it passes and this takes constant
+amortized time */
+static void SymTable_evict(SymTable_T oSymTable)
+{
+   struct STBinding **ppsLink;
+   struct STBinding *psNode;
 
    assert(oSymTable != NULL);
-   assert(pcKey != NULL);
-
-   index = SymTable_hash(pcKey, oSymTable->iBuckets);
-
-   for (psCurrentNode = oSymTable->buckets[index]; 
-   psCurrentNode != NULL; 
-   psCurrentNode = psCurrentNode->psNextNode) {
-      if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-         return psCurrentNode->pvValue;
+   assert(oSymTable->buckets != NULL);
+   assert(oSymTable->size > 0);
+
+   for (;;) {
+      ppsLink = &oSymTable->buckets[oSymTable->uHand];
+      while ((psNode = *ppsLink) != NULL && psNode->uHits != 0) {
+         psNode->uHits = 0;
+         ppsLink = &psNode->psNextNode;
       }
+      oSymTable->uHand = (oSymTable->uHand + 1) % oSymTable->iBuckets;
+      if (psNode != NULL) break;
    }
 
-   return NULL;
-}
+   *ppsLink = psNode->psNextNode;
+   oSymTable->size--;
+   SymTable_updateFilter(oSymTable, 0, 0);
 
+   if (oSymTable->pfEvict != NULL)
+      (*oSymTable->pfEvict)(psNode->pcKey, psNode->pvValue);
+   STMemory_freeString(&oSymTable->sMemory, psNode->pcKey);
+   psNode->psNextNode = oSymTable->psSpareNodes;
+   oSymTable->psSpareNodes = psNode;
+}
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
-   struct STBinding *psCurrentNode;
-   struct STBinding *psPrevious;
-   void *pvValue;
-   size_t index;
+/* Find the binding with key pcKey in oSymTable, inserting a new
+binding with key pcKey and value pvValue if there is none, hashing
+pcKey once and walking its chain once. Sets *piInserted to 1 if a
+binding was inserted and to 0 otherwise, returns a pointer to the value
+of the binding or NULL if there is not enough memory for a new one.
+puHash and iAtom are as for SymTable_lookup */
+static void **SymTable_lookupOrInsert(SymTable_T oSymTable, 
+const char *pcKey, const size_t *puHash, int iAtom, 
+const void *pvValue, int *piInserted) {
+   size_t index, uHash;
+   struct STBinding *psNewNode, *psCurrentNode;
+   struct STTree *psTree = NULL;
+   char* keyCopy;
 
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
+   assert(piInserted != NULL);
 
-    index = SymTable_hash(pcKey, oSymTable->iBuckets);
+   *piInserted = 0;
+   /* the SymAtom of an interned SymTable is already its key copy */
+   iAtom = iAtom && oSymTable->sMemory.iInterned;
 
-    psCurrentNode = oSymTable->buckets[index];
-    if (psCurrentNode == NULL) return NULL;
+   if (oSymTable->buckets == NULL) {
+      index = SymTable_smallFind(oSymTable, pcKey, iAtom);
+      if (index < oSymTable->size) {
+         return &oSymTable->apvSmallValues[index];
+      }
 
-    if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-        pvValue = psCurrentNode->pvValue;
-        oSymTable->buckets[index] = psCurrentNode->psNextNode;
-        free(psCurrentNode->pcKey);
-        free(psCurrentNode);
-        oSymTable->size--;
-        return pvValue;
-    }
+      if (oSymTable->size < SMALL_CAPACITY) {
+         keyCopy = iAtom ? (char*)pcKey 
+         : STMemory_copyString(&oSymTable->sMemory, pcKey);
+         if (keyCopy == NULL) return NULL;
+
+         oSymTable->apcSmallKeys[index] = keyCopy;
+         oSymTable->apvSmallValues[index] = 
+         STMemory_newValue(&oSymTable->sMemory, keyCopy, pvValue);
+         oSymTable->size++;
+         *piInserted = 1;
+         return &oSymTable->apvSmallValues[index];
+      }
 
-    psPrevious = psCurrentNode;
+      if (!SymTable_promote(oSymTable, BUCKETSIZE[0])) return NULL;
+      if (oSymTable->iFilter) SymTable_rebuildFilter(oSymTable);
+   }
+   
+   /* a bounded SymTable keeps the buckets it was made with */
+   if (oSymTable->size == oSymTable->iBuckets 
+   && oSymTable->uMaxBindings == 0) 
+   {
+      /* on failure keep using the current buckets */
+      (void)SymTable_resize(oSymTable);
+   }
+   uHash = SymTable_keyHash(oSymTable, pcKey, puHash);
+   index = uHash % oSymTable->iBuckets;
+
+   /* a key the filter has never seen is not in the chain */
+   psCurrentNode = oSymTable->buckets[index];
+   if (oSymTable->iFilter 
+   && !STFilter_mayContain(&oSymTable->sFilter, uHash)) {
+      psCurrentNode = NULL;
+   }
+   else if (oSymTable->asTrees != NULL 
+   && oSymTable->asTrees[index].psRoot != NULL) {
+      psTree = &oSymTable->asTrees[index];
+      psCurrentNode = (struct STBinding*)SymTable_treeFind(
+      psTree->psRoot, pcKey);
+      if (psCurrentNode != NULL) return &psCurrentNode->pvValue;
+   }
+
+   for (; psCurrentNode != NULL;
+   psCurrentNode = psCurrentNode->psNextNode) {
+      if (SymTable_sameKey(psCurrentNode->pcKey, pcKey, iAtom)) {
+         if (oSymTable->uMaxBindings != 0) psCurrentNode->uHits++;
+         return &psCurrentNode->pvValue;
+      }
+   }
+
+   keyCopy = iAtom ? (char*)pcKey 
+   : STMemory_copyString(&oSymTable->sMemory, pcKey);
+   if (keyCopy == NULL) return NULL;
+
+   psNewNode = SymTable_newNode(oSymTable);
+   if (psNewNode == NULL) {
+      STMemory_freeString(&oSymTable->sMemory, keyCopy);
+      return NULL;
+   }
+
+   /* evict only once the insertion can no longer fail */
+   if (oSymTable->uMaxBindings != 0 
+   && oSymTable->size == oSymTable->uMaxBindings)
+      SymTable_evict(oSymTable);
+
+   psNewNode->pcKey = keyCopy;
+   psNewNode->pvValue = STMemory_newValue(&oSymTable->sMemory, keyCopy,
+   pvValue);
+   psNewNode->psNextNode = oSymTable->buckets[index];
+   /* a new binding lasts until the clock hand has passed it once */
+   psNewNode->uHits = (oSymTable->uMaxBindings != 0);
+
+   oSymTable->buckets[index] = psNewNode;
+   oSymTable->size++;
+   *piInserted = 1;
+   SymTable_updateFilter(oSymTable, uHash, 1);
+
+   if (oSymTable->asTrees != NULL) {
+      psTree = &oSymTable->asTrees[index];
+      if (psTree->psRoot != NULL) {
+         ((struct STTreeNode*)psNewNode)->psPrevNode = NULL;
+         if (psNewNode->psNextNode != NULL) {
+            ((struct STTreeNode*)psNewNode->psNextNode)->psPrevNode =
+            (struct STTreeNode*)psNewNode;
+         }
+         psTree->psRoot = SymTable_treeInsert(psTree->psRoot,
+         (struct STTreeNode*)psNewNode);
+         psTree->uLength++;
+      }
+      else if (SymTable_chainLength(psNewNode) > TREEIFY_LENGTH) {
+         SymTable_treeify(oSymTable, index);
+      }
+   }
+
+   return &psNewNode->pvValue;
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   if (!STMemory_setValueSize(&oSymTable->sMemory, uValueSize)) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+
+   return oSymTable;
+}
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue)) {
+   SymTable_T oSymTable;
+
+   assert(uMaxBindings > 0);
+
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   /* the clock sweeps the buckets, so a bounded SymTable is never
+   small, and it has one bucket per binding it can hold so that the 
+   hand passes few empty ones */
+   if (!SymTable_promote(oSymTable, uMaxBindings)) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+   oSymTable->uMaxBindings = uMaxBindings;
+   oSymTable->pfEvict = pfEvict;
+
+   return oSymTable;
+}
+
+SymTable_T SymTable_newChild(SymTable_T oParent) {
+   SymTable_T oSymTable;
+
+   assert(oParent != NULL);
+
+   /* the child starts small, so a scope with few bindings allocates
+   no buckets */
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   oSymTable->oParent = oParent;
+   return oSymTable;
+}
+
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags) {
+   SymTable_T oSymTable;
+   struct STMemory sMemory;
+   size_t auRandom[2];
+
+   STMemory_init(&sMemory, psAllocator, iFlags);
+
+   oSymTable = (SymTable_T)STMemory_alloc(&sMemory, 
+   sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      STMemory_releaseAll(&sMemory);
+      return NULL;
+   }
+
+   oSymTable->sMemory = sMemory;
+
+   oSymTable->buckets = NULL;
+   oSymTable->iBuckets = 0;
+   oSymTable->bucketCount = 0;
+   oSymTable->size = 0;
+   oSymTable->iReorder = SYMTABLE_REORDER_NONE;
+   oSymTable->iFilter = 0;
+   STFilter_init(&oSymTable->sFilter);
+   oSymTable->psSpareNodes = NULL;
+   oSymTable->asTrees = NULL;
+   oSymTable->iHardened = (iFlags & SYMTABLE_HARDENED) != 0;
+   oSymTable->uSeed = 0;
+   oSymTable->uMultiplier = 65599;
+   oSymTable->uMaxBindings = 0;
+   oSymTable->pfEvict = NULL;
+   oSymTable->uHand = 0;
+   oSymTable->oParent = NULL;
+
+   if (oSymTable->iHardened) {
+      /* an odd multiplier keeps every character significant */
+      SymTable_random(auRandom, 2, oSymTable);
+      oSymTable->uSeed = auRandom[0];
+      oSymTable->uMultiplier = auRandom[1] | 1;
+   }
+
+   return oSymTable;
+}
+
+/* Free the nodes and keys in buckets uStart up to uEnd of the
+SymTable pvTable, as the first part of freeing it */
+static void SymTable_freeBuckets(void *pvTable, size_t uStart,
+size_t uEnd)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   struct STBinding *psCurrentNode;
+   struct STBinding *psNextNode;
+   size_t i;
+
+   for (i = uStart; i < uEnd; i++) {
+      psCurrentNode = oSymTable->buckets[i];
+      for (; psCurrentNode != NULL; 
+      psCurrentNode = psNextNode) {
+         psNextNode = psCurrentNode->psNextNode;
+         STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+         STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+         SymTable_nodeSize(oSymTable));
+      }
+   }
+}
+
+/* Free the SymTable pvTable once the nodes in all of its buckets are
+freed */
+static void SymTable_freeRest(void *pvTable)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   struct STBinding *psCurrentNode;
+   struct STBinding *psNextNode;
+   size_t i;
+
+   STFilter_free(&oSymTable->sFilter, &oSymTable->sMemory);
+   (void)STMemory_setValueSize(&oSymTable->sMemory, 0);
+
+   for (psCurrentNode = oSymTable->psSpareNodes; 
+   psCurrentNode != NULL; 
+   psCurrentNode = psNextNode) {
+      psNextNode = psCurrentNode->psNextNode;
+      STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+      SymTable_nodeSize(oSymTable));
+   }
+
+   if (oSymTable->buckets == NULL) {
+      for (i = 0; i < oSymTable->size; i++) {
+         STMemory_freeString(&oSymTable->sMemory, 
+         oSymTable->apcSmallKeys[i]);
+      }
+      STMemory_free(&oSymTable->sMemory, oSymTable, 
+      sizeof(struct SymTable));
+      return;
+   }
+
+   STMemory_free(&oSymTable->sMemory, oSymTable->asTrees,
+   oSymTable->iBuckets * sizeof(struct STTree));
+   STMemory_free(&oSymTable->sMemory, oSymTable->buckets,
+   oSymTable->iBuckets * sizeof(struct STBinding*));
+   STMemory_free(&oSymTable->sMemory, oSymTable, 
+   sizeof(struct SymTable));
+}
+
+/* Return the number of buckets of oSymTable whose nodes are freed
+before the rest of it, 0 while it is small */
+static size_t SymTable_freeCount(SymTable_T oSymTable)
+{
+   return oSymTable->buckets == NULL ? 0 : oSymTable->iBuckets;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   struct STMemory sMemory;
+
+   assert(oSymTable != NULL);
+
+   if (oSymTable->sMemory.iArena) {
+      /* the SymTable lives in its own arena, so copy the arena out */
+      sMemory = oSymTable->sMemory;
+      STMemory_releaseAll(&sMemory);
+      return;
+   }
+
+   SymTable_freeBuckets(oSymTable, 0, SymTable_freeCount(oSymTable));
+   SymTable_freeRest(oSymTable);
+}
+
+void SymTable_freeAsync(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)
+   || !STReclaim_async(oSymTable, SymTable_freeCount(oSymTable),
+   SymTable_freeBuckets, SymTable_freeRest))
+      SymTable_free(oSymTable);
+}
+
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)) {
+      SymTable_free(oSymTable);
+      return;
+   }
+   STReclaim_parallel(oSymTable, SymTable_freeCount(oSymTable),
+   SymTable_freeBuckets, SymTable_freeRest, uThreads);
+}
+
+void SymTable_clear(SymTable_T oSymTable, 
+void (*pfFreeValue)(void *pvValue)) {
+   struct STBinding *psCurrentNode;
+   struct STBinding *psNextNode;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   if (oSymTable->buckets == NULL) {
+      for (i = 0; i < oSymTable->size; i++) {
+         if (pfFreeValue != NULL) {
+            (*pfFreeValue)(oSymTable->apvSmallValues[i]);
+         }
+         STMemory_freeString(&oSymTable->sMemory, 
+         oSymTable->apcSmallKeys[i]);
+      }
+      oSymTable->size = 0;
+      return;
+   }
+
+   /* only the buckets that hold a chain are written to */
+   for (i = 0; i < oSymTable->iBuckets && oSymTable->size > 0; i++) {
+      if (oSymTable->buckets[i] == NULL) continue;
+
+      for (psCurrentNode = oSymTable->buckets[i]; 
+      psCurrentNode != NULL; 
+      psCurrentNode = psNextNode) {
+         psNextNode = psCurrentNode->psNextNode;
+         if (pfFreeValue != NULL) {
+            (*pfFreeValue)(psCurrentNode->pvValue);
+         }
+         STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+         psCurrentNode->psNextNode = oSymTable->psSpareNodes;
+         oSymTable->psSpareNodes = psCurrentNode;
+         oSymTable->size--;
+      }
+      oSymTable->buckets[i] = NULL;
+      if (oSymTable->asTrees != NULL) 
+         oSymTable->asTrees[i].psRoot = NULL;
+   }
+
+   STFilter_clear(&oSymTable->sFilter);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, pcKey, NULL, 0, pvValue, 
+   &iInserted) == NULL) return 0;
+
+   return iInserted;
+}
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void **ppvOld) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (ppvOld != NULL) *ppvOld = NULL;
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey, NULL, 0, 
+   pvValue, &iInserted);
+   if (ppvSlot == NULL) return -1;
+   if (iInserted) return 1;
+
+   if (ppvOld != NULL) 
+      *ppvOld = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+   *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, pvValue);
+   return 0;
+}
+
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void ***pppvSlot) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(pppvSlot != NULL);
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey, NULL, 0, 
+   pvValue, &iInserted);
+   *pppvSlot = ppvSlot;
+   if (ppvSlot == NULL) return -1;
+
+   return iInserted;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue) {
+   void **ppvSlot;
+   void *tempValue;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   ppvSlot = SymTable_lookup(oSymTable, pcKey, NULL, 0);
+   if (ppvSlot == NULL) return NULL;
+
+   tempValue = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+   *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, pvValue);
+   return tempValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_lookup(oSymTable, pcKey, NULL, 0) != NULL;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   void **ppvSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   ppvSlot = SymTable_lookup(oSymTable, pcKey, NULL, 0);
+   if (ppvSlot == NULL) return NULL;
+
+   return *ppvSlot;
+}
+
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder) {
+   assert(oSymTable != NULL);
+   assert(iReorder >= SYMTABLE_REORDER_NONE);
+   assert(iReorder <= SYMTABLE_REORDER_TRANSPOSE);
+
+   oSymTable->iReorder = iReorder;
+   return 1;
+}
+
+void SymTable_optimize(SymTable_T oSymTable) {
+   struct STBinding *psCurrentNode;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   if (oSymTable->buckets == NULL) return;
+
+   for (i = 0; i < oSymTable->iBuckets; i++) {
+      /* the order of a tree chain does not matter to lookups */
+      if (oSymTable->asTrees != NULL 
+      && oSymTable->asTrees[i].psRoot != NULL) continue;
+
+      oSymTable->buckets[i] = 
+      SymTable_sortByHits(oSymTable->buckets[i]);
+
+      /* age the counts so that later passes follow shifts in 
+      popularity */
+      for (psCurrentNode = oSymTable->buckets[i]; 
+      psCurrentNode != NULL; 
+      psCurrentNode = psCurrentNode->psNextNode) {
+         psCurrentNode->uHits /= 2;
+      }
+   }
+}
+
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable) {
+   assert(oSymTable != NULL);
+
+   oSymTable->iFilter = (iEnable != 0);
+   if (!oSymTable->iFilter) {
+      STFilter_free(&oSymTable->sFilter, &oSymTable->sMemory);
+   }
+   else if (oSymTable->buckets != NULL) {
+      SymTable_rebuildFilter(oSymTable);
+   }
+
+   return 1;
+}
+
+/* Remove the binding with key pcKey from oSymTable and return its
+value, or NULL if there is no such binding. puHash is as for 
+SymTable_lookup */
+static void *SymTable_delete(SymTable_T oSymTable, const char *pcKey,
+const size_t *puHash)
+{
+   struct STBinding *psCurrentNode;
+   struct STBinding *psPrevious;
+   struct STTreeNode *psTreeNode;
+   struct STTree *psTree;
+   void *pvValue;
+   size_t index, uHash;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (oSymTable->buckets == NULL) {
+      index = SymTable_smallFind(oSymTable, pcKey, 0);
+      if (index == oSymTable->size) return NULL;
+      pvValue = STMemory_saveValue(&oSymTable->sMemory,
+      oSymTable->apvSmallValues[index]);
+      STMemory_freeString(&oSymTable->sMemory, 
+      oSymTable->apcSmallKeys[index]);
+      oSymTable->size--;
+      oSymTable->apcSmallKeys[index] = 
+      oSymTable->apcSmallKeys[oSymTable->size];
+      oSymTable->apvSmallValues[index] = 
+      oSymTable->apvSmallValues[oSymTable->size];
+      return pvValue;
+   }
+
+    uHash = SymTable_keyHash(oSymTable, pcKey, puHash);
+    if (oSymTable->iFilter 
+    && !STFilter_mayContain(&oSymTable->sFilter, uHash)) return NULL;
+    index = uHash % oSymTable->iBuckets;
+
+    if (oSymTable->asTrees != NULL 
+    && oSymTable->asTrees[index].psRoot != NULL) {
+        psTree = &oSymTable->asTrees[index];
+        psTreeNode = NULL;
+        psTree->psRoot = SymTable_treeRemove(psTree->psRoot, pcKey,
+        &psTreeNode);
+        if (psTreeNode == NULL) return NULL;
+
+        /* unlink the node from the chain through its prev link */
+        psCurrentNode = &psTreeNode->sBinding;
+        if (psTreeNode->psPrevNode == NULL)
+            oSymTable->buckets[index] = psCurrentNode->psNextNode;
+        else {
+            psTreeNode->psPrevNode->sBinding.psNextNode = 
+            psCurrentNode->psNextNode;
+        }
+        if (psCurrentNode->psNextNode != NULL) {
+            ((struct STTreeNode*)psCurrentNode->psNextNode)->psPrevNode
+            = psTreeNode->psPrevNode;
+        }
+        if (--psTree->uLength <= UNTREEIFY_LENGTH) 
+            psTree->psRoot = NULL;
+
+        pvValue = STMemory_saveValue(&oSymTable->sMemory, 
+        psCurrentNode->pvValue);
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+        SymTable_nodeSize(oSymTable));
+        oSymTable->size--;
+        SymTable_updateFilter(oSymTable, uHash, 0);
+        return pvValue;
+    }
+
+    psCurrentNode = oSymTable->buckets[index];
+    if (psCurrentNode == NULL) return NULL;
+
+    if (!strcmp(psCurrentNode->pcKey, pcKey)) {
+        pvValue = STMemory_saveValue(&oSymTable->sMemory, 
+        psCurrentNode->pvValue);
+        oSymTable->buckets[index] = psCurrentNode->psNextNode;
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+        SymTable_nodeSize(oSymTable));
+        oSymTable->size--;
+        SymTable_updateFilter(oSymTable, uHash, 0);
+        return pvValue;
+    }
+
+    psPrevious = psCurrentNode;
 
     for (psCurrentNode = psCurrentNode->psNextNode; 
     psCurrentNode != NULL; 
     psCurrentNode = psCurrentNode->psNextNode) {
         if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            pvValue = psCurrentNode->pvValue;
+            pvValue = STMemory_saveValue(&oSymTable->sMemory, 
+            psCurrentNode->pvValue);
             psPrevious->psNextNode = psCurrentNode->psNextNode;
-            free(psCurrentNode->pcKey);
-            free(psCurrentNode);
+            STMemory_freeString(&oSymTable->sMemory, 
+            psCurrentNode->pcKey);
+            STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+            SymTable_nodeSize(oSymTable));
             oSymTable->size--;
+            SymTable_updateFilter(oSymTable, uHash, 0);
             return pvValue;
         }
         
@@ -299,6 +1388,106 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
     return NULL;
 }
 
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey) {
+   void **ppvSlot;
+   size_t uHash = 0;
+   int iHashed = 0;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   for (; oSymTable != NULL; oSymTable = oSymTable->oParent) {
+      /* small SymTables compare keys without hashing them, so hash 
+      only once a SymTable with buckets comes up */
+      if (!iHashed && oSymTable->buckets != NULL) {
+         uHash = SymKey_make(pcKey).uHash;
+         iHashed = 1;
+      }
+      ppvSlot = SymTable_lookup(oSymTable, pcKey, 
+      iHashed ? &uHash : NULL, 0);
+      if (ppvSlot != NULL) return *ppvSlot;
+   }
+
+   return NULL;
+}
+
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue) {
+   size_t uHash;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   uHash = SymAtom_hash(oAtom);
+   if (SymTable_lookupOrInsert(oSymTable, SymAtom_string(oAtom), &uHash,
+   1, pvValue, &iInserted) == NULL) return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom) {
+   void **ppvSlot;
+   size_t uHash;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   uHash = SymAtom_hash(oAtom);
+   ppvSlot = SymTable_lookup(oSymTable, SymAtom_string(oAtom), &uHash,
+   1);
+   if (ppvSlot == NULL) return NULL;
+
+   return *ppvSlot;
+}
+
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, sKey.pcKey, &sKey.uHash, 0,
+   pvValue, &iInserted) == NULL) return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey) {
+   void **ppvSlot;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   ppvSlot = SymTable_lookup(oSymTable, sKey.pcKey, &sKey.uHash, 0);
+   if (ppvSlot == NULL) return NULL;
+
+   return *ppvSlot;
+}
+
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey) {
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_lookup(oSymTable, sKey.pcKey, &sKey.uHash, 0) 
+   != NULL;
+}
+
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey) {
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_delete(oSymTable, sKey.pcKey, &sKey.uHash);
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_delete(oSymTable, pcKey, NULL);
+}
+
 void SymTable_map(SymTable_T oSymTable,
    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
    const void *pvExtra) {
@@ -308,6 +1497,15 @@ void SymTable_map(SymTable_T oSymTable,
       assert(oSymTable != NULL);
       assert(pfApply != NULL);
 
+      if (oSymTable->buckets == NULL) {
+         for (i = 0; i < oSymTable->size; i++) {
+            (*pfApply)(oSymTable->apcSmallKeys[i],
+            oSymTable->apvSmallValues[i],
+            (void*)pvExtra);
+         }
+         return;
+      }
+
       for (i = 0; i < oSymTable->iBuckets; i++) {
          for (psCurrentNode = oSymTable->buckets[i]; 
          psCurrentNode != NULL; 
@@ -317,4 +1515,315 @@ void SymTable_map(SymTable_T oSymTable,
             (void*)pvExtra);
         }
       }
-    }
\ No newline at end of file
+    }
+
+void SymTable_mapBatch(SymTable_T oSymTable,
+   void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra),
+   const void *pvExtra, size_t uBatchSize) {
+   struct STBatch sBatch;
+   struct STBinding *psCurrentNode;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApplyBatch != NULL);
+
+   STBatch_init(&sBatch, pfApplyBatch, pvExtra, uBatchSize,
+   &oSymTable->sMemory);
+
+   if (oSymTable->buckets == NULL) {
+      for (i = 0; i < oSymTable->size; i++) {
+         STBatch_add(&sBatch, oSymTable->apcSmallKeys[i],
+         oSymTable->apvSmallValues[i]);
+      }
+   }
+   else {
+      for (i = 0; i < oSymTable->iBuckets; i++) {
+         for (psCurrentNode = oSymTable->buckets[i];
+         psCurrentNode != NULL;
+         psCurrentNode = psCurrentNode->psNextNode) {
+            STBatch_add(&sBatch, psCurrentNode->pcKey,
+            psCurrentNode->pvValue);
+         }
+      }
+   }
+
+   STBatch_finish(&sBatch);
+}
+
+/* Return the binding with key pcKey in bucket index of oSymTable,
+which has buckets, or NULL if there is none, without counting a hit or
+moving the binding */
+static struct STBinding *SymTable_findIn(SymTable_T oSymTable,
+size_t index, const char *pcKey)
+{
+   struct STBinding *psCurrentNode;
+
+   assert(oSymTable != NULL);
+   assert(oSymTable->buckets != NULL);
+
+   if (oSymTable->asTrees != NULL 
+   && oSymTable->asTrees[index].psRoot != NULL) {
+      return (struct STBinding*)SymTable_treeFind(
+      oSymTable->asTrees[index].psRoot, pcKey);
+   }
+
+   for (psCurrentNode = oSymTable->buckets[index];
+   psCurrentNode != NULL;
+   psCurrentNode = psCurrentNode->psNextNode) {
+      if (!strcmp(psCurrentNode->pcKey, pcKey)) break;
+   }
+
+   return psCurrentNode;
+}
+
+/* Return a pointer to the value of the binding with key pcKey in 
+oSymTable, or NULL if there is no such binding, without counting a hit
+or moving the binding */
+static void **SymTable_peek(SymTable_T oSymTable, const char *pcKey)
+{
+   struct STBinding *psNode;
+   size_t index;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (oSymTable->buckets == NULL) {
+      index = SymTable_smallFind(oSymTable, pcKey, 0);
+      if (index == oSymTable->size) return NULL;
+      return &oSymTable->apvSmallValues[index];
+   }
+
+   psNode = SymTable_findIn(oSymTable, 
+   SymTable_hash(oSymTable, pcKey) % oSymTable->iBuckets, pcKey);
+   if (psNode == NULL) return NULL;
+
+   return &psNode->pvValue;
+}
+
+/* Return 1 if oSymTable and oOther are not hardened and have as many
+buckets, so that a key is in the same bucket of both and they can be
+walked bucket by bucket without hashing any key, and 0 otherwise. A
+bounded oSymTable is not paired, its inserts have to go through the
+clock */
+static int SymTable_paired(SymTable_T oSymTable, SymTable_T oOther)
+{
+   return oSymTable->buckets != NULL && oOther->buckets != NULL
+   && !oSymTable->iHardened && !oOther->iHardened
+   && oSymTable->iBuckets == oOther->iBuckets
+   && oSymTable->uMaxBindings == 0;
+}
+
+/* Resize oSymTable until it has more buckets than bindings, or as 
+many as it can have or there is memory for */
+static void SymTable_grow(SymTable_T oSymTable)
+{
+   size_t oldCount;
+
+   assert(oSymTable != NULL);
+
+   while (oSymTable->size >= oSymTable->iBuckets) {
+      oldCount = oSymTable->bucketCount;
+      if (SymTable_resize(oSymTable) == NULL
+      || oSymTable->bucketCount == oldCount) return;
+   }
+}
+
+/* Merge the binding with key pcKey and value pvOtherValue into 
+oSymTable under psMerge. Returns 1 on success or 0 if there is not 
+enough memory */
+static int SymTable_mergeOne(SymTable_T oSymTable, const char *pcKey,
+void *pvOtherValue, const struct STMerge *psMerge)
+{
+   void **ppvSlot;
+   int iInserted;
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey, NULL, 0,
+   pvOtherValue, &iInserted);
+   if (ppvSlot == NULL) return 0;
+
+   if (!iInserted) {
+      STMerge_resolve(psMerge, &oSymTable->sMemory, pcKey, ppvSlot,
+      pvOtherValue);
+   }
+   return 1;
+}
+
+/* Merge psOther, a binding in bucket index of a SymTable paired with
+oSymTable, into the same bucket of oSymTable under psMerge, without
+growing the bucket array so that the pairing lasts. Returns 1 on 
+success or 0 if there is not enough memory */
+static int SymTable_mergePaired(SymTable_T oSymTable, size_t index,
+const struct STBinding *psOther, const struct STMerge *psMerge)
+{
+   struct STBinding *psNewNode;
+   char *keyCopy;
+
+   psNewNode = SymTable_findIn(oSymTable, index, psOther->pcKey);
+   if (psNewNode != NULL) {
+      STMerge_resolve(psMerge, &oSymTable->sMemory, psNewNode->pcKey,
+      &psNewNode->pvValue, psOther->pvValue);
+      return 1;
+   }
+
+   keyCopy = STMemory_copyString(&oSymTable->sMemory, psOther->pcKey);
+   if (keyCopy == NULL) return 0;
+
+   psNewNode = SymTable_newNode(oSymTable);
+   if (psNewNode == NULL) {
+      STMemory_freeString(&oSymTable->sMemory, keyCopy);
+      return 0;
+   }
+
+   psNewNode->pcKey = keyCopy;
+   psNewNode->pvValue = STMemory_newValue(&oSymTable->sMemory, keyCopy,
+   psOther->pvValue);
+   psNewNode->psNextNode = oSymTable->buckets[index];
+   psNewNode->uHits = 0;
+
+   oSymTable->buckets[index] = psNewNode;
+   oSymTable->size++;
+   /* only the filter needs the full hash code */
+   if (oSymTable->iFilter) {
+      SymTable_updateFilter(oSymTable, 
+      SymTable_hash(oSymTable, keyCopy), 1);
+   }
+   return 1;
+}
+
+/* Remove the bindings of oSymTable that the STMERGE_INTERSECT or
+STMERGE_DIFF psMerge does not keep, given the bindings of oOther */
+static void SymTable_reduce(SymTable_T oSymTable, SymTable_T oOther,
+const struct STMerge *psMerge)
+{
+   struct STBinding **ppsLink;
+   struct STBinding *psCurrentNode, *psNextNode, *psOther;
+   size_t i;
+
+   if (oSymTable->buckets == NULL) {
+      /* a removal moves the last binding, already kept, into i */
+      for (i = oSymTable->size; i-- > 0; ) {
+         if (!STMerge_keep(psMerge, &oSymTable->sMemory,
+         oSymTable->apcSmallKeys[i], &oSymTable->apvSmallValues[i],
+         SymTable_peek(oOther, oSymTable->apcSmallKeys[i]))) {
+            (void)SymTable_remove(oSymTable, 
+            oSymTable->apcSmallKeys[i]);
+         }
+      }
+      return;
+   }
+
+   if (!SymTable_paired(oSymTable, oOther)) {
+      for (i = 0; i < oSymTable->iBuckets; i++) {
+         for (psCurrentNode = oSymTable->buckets[i];
+         psCurrentNode != NULL;
+         psCurrentNode = psNextNode) {
+            psNextNode = psCurrentNode->psNextNode;
+            if (!STMerge_keep(psMerge, &oSymTable->sMemory,
+            psCurrentNode->pcKey, &psCurrentNode->pvValue,
+            SymTable_peek(oOther, psCurrentNode->pcKey))) {
+               (void)SymTable_remove(oSymTable, psCurrentNode->pcKey);
+            }
+         }
+      }
+      return;
+   }
+
+   /* neither table is hardened, so no chain is a tree */
+   for (i = 0; i < oSymTable->iBuckets; i++) {
+      ppsLink = &oSymTable->buckets[i];
+      while ((psCurrentNode = *ppsLink) != NULL) {
+         psOther = SymTable_findIn(oOther, i, psCurrentNode->pcKey);
+         if (STMerge_keep(psMerge, &oSymTable->sMemory,
+         psCurrentNode->pcKey, &psCurrentNode->pvValue,
+         (psOther == NULL) ? NULL : &psOther->pvValue)) {
+            ppsLink = &psCurrentNode->psNextNode;
+            continue;
+         }
+
+         *ppsLink = psCurrentNode->psNextNode;
+         STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+         STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+         SymTable_nodeSize(oSymTable));
+         oSymTable->size--;
+         SymTable_updateFilter(oSymTable, 0, 0);
+      }
+   }
+}
+
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   const void *pvExtra) {
+   struct STMerge sMerge;
+   struct STBinding *psOther;
+   size_t i;
+   int iPaired;
+   int iSuccessful = 1;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_MERGE, pfResolve, NULL, NULL,
+   pvExtra);
+
+   if (oOther->buckets == NULL) {
+      for (i = 0; i < oOther->size && iSuccessful; i++) {
+         iSuccessful = SymTable_mergeOne(oSymTable, 
+         oOther->apcSmallKeys[i], oOther->apvSmallValues[i], &sMerge);
+      }
+      return iSuccessful;
+   }
+
+   iPaired = SymTable_paired(oSymTable, oOther);
+   for (i = 0; i < oOther->iBuckets && iSuccessful; i++) {
+      for (psOther = oOther->buckets[i]; 
+      psOther != NULL && iSuccessful;
+      psOther = psOther->psNextNode) {
+         if (iPaired) {
+            iSuccessful = SymTable_mergePaired(oSymTable, i, psOther,
+            &sMerge);
+         }
+         else {
+            iSuccessful = SymTable_mergeOne(oSymTable, psOther->pcKey,
+            psOther->pvValue, &sMerge);
+         }
+      }
+   }
+
+   /* catch up with the growth held back while the tables were 
+   paired */
+   if (iPaired) SymTable_grow(oSymTable);
+   return iSuccessful;
+}
+
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_INTERSECT, pfResolve, NULL,
+   pfFreeValue, pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
+
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+   int (*pfKeep)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_DIFF, NULL, pfKeep, pfFreeValue,
+   pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
@@ -7,6 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "symtable.h"
+#include "symtablefilter.h"
+#include "symtablebatch.h"
+#include "symtablememory.h"
+#include "symtablereclaim.h"
+#include "symtablemerge.h"
 
 /* STBinding is the structure for a node in SymTable that contains a
 key-value pair and the next binding that follows it to form a linked
@@ -19,6 +24,9 @@ struct STBinding
     void *pvValue;
     /* next node in the linked list */
     struct STBinding *psNextNode;
+    /* number of lookups that found the binding since the last
+    SymTable_optimize, only counted when reordering is enabled */
+    size_t uHits;
 };
 
 /* SymTable is the structure for a SymTable that contains its size and
@@ -29,34 +37,490 @@ struct SymTable
     size_t size;
     /* first node in the linked list */
     struct STBinding *first;
+    /* SYMTABLE_REORDER_* policy applied when a lookup finds a 
+    binding */
+    int iReorder;
+    /* 1 if the filter is on, 0 otherwise */
+    int iFilter;
+    /* filter over the keys, used while iFilter is 1 */
+    struct STFilter sFilter;
+    /* nodes left over by SymTable_clear, linked through psNextNode and
+    used before new ones are allocated */
+    struct STBinding *psSpareNodes;
+    /* most bindings the SymTable holds, 0 if it is not bounded */
+    size_t uMaxBindings;
+    /* called with each binding a bounded SymTable evicts, or NULL */
+    void (*pfEvict)(const char *pcKey, void *pvValue);
+    /* link to the binding the clock hand of a bounded SymTable is at,
+    new bindings are inserted there so that they are passed last */
+    struct STBinding **ppsHand;
+    /* SymTable of the enclosing scope, or NULL */
+    SymTable_T oParent;
+    /* source of all memory of the SymTable */
+    struct STMemory sMemory;
 };
 
+/* Return a hash code for pcKey, the list only hashes keys to use its
+filter */
+static size_t SymTable_hash(const char *pcKey)
+{
+    const size_t HASH_MULTIPLIER = 65599;
+    size_t u;
+    size_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (u = 0; pcKey[u] != '\0'; u++)
+        uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+    return uHash;
+}
+
+/* Size the filter of oSymTable for twice its bindings and add all of
+them, the filter has no blocks if there is not enough memory */
+static void SymTable_rebuildFilter(SymTable_T oSymTable)
+{
+    struct STBinding *psCurrentNode;
+
+    assert(oSymTable != NULL);
+
+    if (!STFilter_reset(&oSymTable->sFilter, &oSymTable->sMemory,
+    2 * oSymTable->size)) return;
+
+    for (psCurrentNode = oSymTable->first; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psCurrentNode->psNextNode) {
+        STFilter_add(&oSymTable->sFilter, 
+        SymTable_hash(psCurrentNode->pcKey));
+    }
+}
+
+/* Update the filter of oSymTable, if it is on, after a binding with
+key hash code uHash was inserted, or after one was removed if 
+iInserted is 0 */
+static void SymTable_updateFilter(SymTable_T oSymTable, size_t uHash,
+int iInserted)
+{
+    assert(oSymTable != NULL);
+
+    if (!oSymTable->iFilter) return;
+
+    if (iInserted) STFilter_add(&oSymTable->sFilter, uHash);
+    else STFilter_remove(&oSymTable->sFilter);
+
+    if (STFilter_needsRebuild(&oSymTable->sFilter, oSymTable->size))
+        SymTable_rebuildFilter(oSymTable);
+}
+
+/* Return 0 if the filter of oSymTable is on and rules out a binding
+with key pcKey, whose hash code it stores in *puHash, and 1 otherwise */
+static int SymTable_mayContain(SymTable_T oSymTable, const char *pcKey,
+size_t *puHash)
+{
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(puHash != NULL);
+
+    *puHash = 0;
+    if (!oSymTable->iFilter) return 1;
+
+    *puHash = SymTable_hash(pcKey);
+    return STFilter_mayContain(&oSymTable->sFilter, *puHash);
+}
+
+/* Move the binding psNode, found in the list of oSymTable after
+psPrevious (NULL if psNode is first) which itself follows 
+psPrevPrevious, closer to the front of the list according to the
+reordering policy of oSymTable */
+static void SymTable_reorder(SymTable_T oSymTable, 
+struct STBinding *psNode, struct STBinding *psPrevious, 
+struct STBinding *psPrevPrevious)
+{
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (psPrevious == NULL) return;
+
+    if (oSymTable->iReorder == SYMTABLE_REORDER_MOVE_TO_FRONT) {
+        psPrevious->psNextNode = psNode->psNextNode;
+        psNode->psNextNode = oSymTable->first;
+        oSymTable->first = psNode;
+    }
+    else if (oSymTable->iReorder == SYMTABLE_REORDER_TRANSPOSE) {
+        psPrevious->psNextNode = psNode->psNextNode;
+        psNode->psNextNode = psPrevious;
+        if (psPrevPrevious == NULL) oSymTable->first = psNode;
+        else psPrevPrevious->psNextNode = psNode;
+    }
+}
+
+/* Return a pointer to the value of the binding with key pcKey in 
+oSymTable, or NULL if there is no such binding. The binding is counted
+as a hit and moved according to the reordering policy of oSymTable */
+static void **SymTable_lookup(SymTable_T oSymTable, const char *pcKey)
+{
+    struct STBinding *psCurrentNode;
+    struct STBinding *psPrevious = NULL, *psPrevPrevious = NULL;
+    size_t uHash;
+
+    assert(pcKey != NULL);
+    assert(oSymTable != NULL);
+
+    if (!SymTable_mayContain(oSymTable, pcKey, &uHash)) return NULL;
+
+    for (psCurrentNode = oSymTable->first; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psCurrentNode->psNextNode) {
+        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
+            /* a bounded SymTable only counts the hit for its clock */
+            if (oSymTable->iReorder != SYMTABLE_REORDER_NONE
+            || oSymTable->uMaxBindings != 0) {
+                psCurrentNode->uHits++;
+                SymTable_reorder(oSymTable, psCurrentNode, psPrevious,
+                psPrevPrevious);
+            }
+            return &psCurrentNode->pvValue;
+        }
+        psPrevPrevious = psPrevious;
+        psPrevious = psCurrentNode;
+    }
+
+    return NULL;
+}
+
+/* Sort the list psList by decreasing hit count, keeping the relative
+order of bindings with equal counts, and return its new first node */
+static struct STBinding *SymTable_sortByHits(struct STBinding *psList)
+{
+    struct STBinding *psSlow, *psFast, *psSecond;
+    struct STBinding *psMerged = NULL;
+    struct STBinding **ppsTail = &psMerged;
+
+    if (psList == NULL || psList->psNextNode == NULL) return psList;
+
+    /* split the list in half */
+    psSlow = psList;
+    for (psFast = psList->psNextNode; 
+    psFast != NULL && psFast->psNextNode != NULL;
+    psFast = psFast->psNextNode->psNextNode) {
+        psSlow = psSlow->psNextNode;
+    }
+    psSecond = psSlow->psNextNode;
+    psSlow->psNextNode = NULL;
+
+    psList = SymTable_sortByHits(psList);
+    psSecond = SymTable_sortByHits(psSecond);
+
+    while (psList != NULL && psSecond != NULL) {
+        if (psList->uHits >= psSecond->uHits) {
+            *ppsTail = psList;
+            psList = psList->psNextNode;
+        }
+        else {
+            *ppsTail = psSecond;
+            psSecond = psSecond->psNextNode;
+        }
+        ppsTail = &(*ppsTail)->psNextNode;
+    }
+    *ppsTail = (psList != NULL) ? psList : psSecond;
+
+    return psMerged;
+}
+
+/* Keep the clock hand of oSymTable valid while psNode, which the link
+*ppsLink points to, is unlinked: a hand at the link in psNode moves
+back to *ppsLink */
+static void SymTable_moveHand(SymTable_T oSymTable, 
+struct STBinding **ppsLink, struct STBinding *psNode)
+{
+    assert(oSymTable != NULL);
+    assert(*ppsLink == psNode);
+
+    if (oSymTable->ppsHand == &psNode->psNextNode) 
+        oSymTable->ppsHand = ppsLink;
+}
+
+/* Remove a binding from the full bounded SymTable oSymTable to make
+room for a new one, choosing it with the clock: the hand moves along
+the list, wrapping around at its end, clearing the hit counts of the
+bindings it passes and stopping at the first binding whose count was
+already 0, which is passed to the eviction function and its node kept
+as a spare. The hand then points to the link left by the binding, 
+where the new one goes */
+static void SymTable_evict(SymTable_T oSymTable)
+{
+    struct STBinding *psNode;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->size > 0);
+
+    for (;;) {
+        if (*oSymTable->ppsHand == NULL) 
+            oSymTable->ppsHand = &oSymTable->first;
+        psNode = *oSymTable->ppsHand;
+        if (psNode->uHits == 0) break;
+        psNode->uHits = 0;
+        oSymTable->ppsHand = &psNode->psNextNode;
+    }
+
+    *oSymTable->ppsHand = psNode->psNextNode;
+    oSymTable->size--;
+    SymTable_updateFilter(oSymTable, 0, 0);
+
+    if (oSymTable->pfEvict != NULL)
+        (*oSymTable->pfEvict)(psNode->pcKey, psNode->pvValue);
+    STMemory_freeString(&oSymTable->sMemory, psNode->pcKey);
+    psNode->psNextNode = oSymTable->psSpareNodes;
+    oSymTable->psSpareNodes = psNode;
+}
+
+/* Find the binding with key pcKey in oSymTable, inserting a new
+binding with key pcKey and value pvValue at the front of the list, or
+behind the clock hand if oSymTable is bounded, if there is none, 
+scanning the list once. Sets *piInserted to 1 if a
+binding was inserted and to 0 otherwise, returns a pointer to the value
+of the binding or NULL if there is not enough memory for a new one */
+static void **SymTable_lookupOrInsert(SymTable_T oSymTable, 
+const char *pcKey, const void *pvValue, int *piInserted) {
+    struct STBinding *psNewNode, *psCurrentNode;
+    struct STBinding **ppsLink;
+    char* keyCopy;
+    size_t uHash;
+
+    assert(pcKey != NULL);
+    assert(oSymTable != NULL);
+    assert(piInserted != NULL);
+
+    *piInserted = 0;
+
+    /* a key the filter has never seen is not in the list */
+    psCurrentNode = oSymTable->first;
+    if (!SymTable_mayContain(oSymTable, pcKey, &uHash)) 
+        psCurrentNode = NULL;
+
+    for (; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psCurrentNode->psNextNode) {
+        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
+            if (oSymTable->uMaxBindings != 0) psCurrentNode->uHits++;
+            return &psCurrentNode->pvValue;
+        }
+    }
+
+    keyCopy = STMemory_copyString(&oSymTable->sMemory, pcKey);
+    if (keyCopy == NULL) return NULL;
+
+    /* reuse a node left over by SymTable_clear if there is one */
+    psNewNode = oSymTable->psSpareNodes;
+    if (psNewNode != NULL) {
+        oSymTable->psSpareNodes = psNewNode->psNextNode;
+    }
+    else {
+        psNewNode = (struct STBinding*)STMemory_alloc(
+        &oSymTable->sMemory, sizeof(struct STBinding));
+    }
+    if (psNewNode == NULL) {
+        STMemory_freeString(&oSymTable->sMemory, keyCopy);
+        return NULL;
+    }
+
+    /* evict only once the insertion can no longer fail */
+    if (oSymTable->uMaxBindings != 0 
+    && oSymTable->size == oSymTable->uMaxBindings)
+        SymTable_evict(oSymTable);
+
+    psNewNode->pcKey = keyCopy;
+    psNewNode->pvValue = STMemory_newValue(&oSymTable->sMemory, 
+    keyCopy, pvValue);
+    ppsLink = &oSymTable->first;
+    if (oSymTable->uMaxBindings != 0) ppsLink = oSymTable->ppsHand;
+
+    psNewNode->psNextNode = *ppsLink;
+    psNewNode->uHits = 0;
+
+    *ppsLink = psNewNode;
+    if (oSymTable->uMaxBindings != 0)
+        oSymTable->ppsHand = &psNewNode->psNextNode;
+    oSymTable->size++;
+    *piInserted = 1;
+    SymTable_updateFilter(oSymTable, uHash, 1);
+
+    return &psNewNode->pvValue;
+}
+
 SymTable_T SymTable_new(void) {
+    return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_newWithAllocator(NULL, 0);
+    if (oSymTable == NULL) return NULL;
+
+    if (!STMemory_setValueSize(&oSymTable->sMemory, uValueSize)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+
+    return oSymTable;
+}
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue)) {
+    SymTable_T oSymTable;
+
+    assert(uMaxBindings > 0);
+
+    oSymTable = SymTable_newWithAllocator(NULL, 0);
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->uMaxBindings = uMaxBindings;
+    oSymTable->pfEvict = pfEvict;
+    return oSymTable;
+}
+
+SymTable_T SymTable_newChild(SymTable_T oParent) {
     SymTable_T oSymTable;
-    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+
+    assert(oParent != NULL);
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->oParent = oParent;
+    return oSymTable;
+}
+
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags) {
+    SymTable_T oSymTable;
+    struct STMemory sMemory;
+
+    STMemory_init(&sMemory, psAllocator, iFlags);
+    oSymTable = (SymTable_T)STMemory_alloc(&sMemory, 
+    sizeof(struct SymTable));
     if (oSymTable == NULL) {
+        STMemory_releaseAll(&sMemory);
         return NULL;
     }
+    oSymTable->sMemory = sMemory;
     oSymTable->first = NULL;
     oSymTable->size = 0;
+    oSymTable->iReorder = SYMTABLE_REORDER_NONE;
+    oSymTable->iFilter = 0;
+    STFilter_init(&oSymTable->sFilter);
+    oSymTable->psSpareNodes = NULL;
+    oSymTable->uMaxBindings = 0;
+    oSymTable->pfEvict = NULL;
+    oSymTable->ppsHand = &oSymTable->first;
+    oSymTable->oParent = NULL;
     return oSymTable;
 }
 
-void SymTable_free(SymTable_T oSymTable) {
+/* Free the first uEnd - uStart bindings of the SymTable pvTable, as
+part of freeing it in chunks. The list is only ever freed from the
+front, so uStart itself does not matter */
+static void SymTable_freeFront(void *pvTable, size_t uStart,
+size_t uEnd)
+{
+    SymTable_T oSymTable = (SymTable_T)pvTable;
+    struct STBinding *psCurrentNode;
+    size_t u;
+
+    for (u = uStart; u < uEnd && oSymTable->first != NULL; u++)
+    {
+        psCurrentNode = oSymTable->first;
+        oSymTable->first = psCurrentNode->psNextNode;
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+        sizeof(struct STBinding));
+    }
+}
+
+/* Free the bindings left in the SymTable pvTable and the SymTable
+itself */
+static void SymTable_freeRest(void *pvTable)
+{
+    SymTable_T oSymTable = (SymTable_T)pvTable;
     struct STBinding *psCurrentNode, *psNextNode;
 
-    assert(oSymTable != NULL);
+    STFilter_free(&oSymTable->sFilter, &oSymTable->sMemory);
+    (void)STMemory_setValueSize(&oSymTable->sMemory, 0);
 
     for (psCurrentNode = oSymTable->first; 
     psCurrentNode != NULL; 
     psCurrentNode = psNextNode)
     {
       psNextNode = psCurrentNode->psNextNode;
-      free(psCurrentNode->pcKey);
-      free(psCurrentNode);
+      STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+      STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+      sizeof(struct STBinding));
+    }
+
+    for (psCurrentNode = oSymTable->psSpareNodes; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psNextNode)
+    {
+      psNextNode = psCurrentNode->psNextNode;
+      STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+      sizeof(struct STBinding));
+    }
+
+   STMemory_free(&oSymTable->sMemory, oSymTable, 
+   sizeof(struct SymTable));
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+    struct STMemory sMemory;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->sMemory.iArena) {
+        /* the SymTable lives in its own arena, so copy the arena out */
+        sMemory = oSymTable->sMemory;
+        STMemory_releaseAll(&sMemory);
+        return;
+    }
+
+    SymTable_freeRest(oSymTable);
+}
+
+void SymTable_freeAsync(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (!STMemory_isConcurrent(&oSymTable->sMemory)
+    || !STReclaim_async(oSymTable, oSymTable->size,
+    SymTable_freeFront, SymTable_freeRest))
+        SymTable_free(oSymTable);
+}
+
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads) {
+    /* a list cannot be split into ranges without walking it, which
+    is most of the work of freeing it */
+    SymTable_free(oSymTable);
+}
+
+void SymTable_clear(SymTable_T oSymTable, 
+void (*pfFreeValue)(void *pvValue)) {
+    struct STBinding *psCurrentNode, *psNextNode;
+
+    assert(oSymTable != NULL);
+
+    for (psCurrentNode = oSymTable->first; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psNextNode) {
+        psNextNode = psCurrentNode->psNextNode;
+        if (pfFreeValue != NULL) (*pfFreeValue)(psCurrentNode->pvValue);
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        psCurrentNode->psNextNode = oSymTable->psSpareNodes;
+        oSymTable->psSpareNodes = psCurrentNode;
     }
 
-   free(oSymTable);
+    oSymTable->first = NULL;
+    oSymTable->ppsHand = &oSymTable->first;
+    oSymTable->size = 0;
+    STFilter_clear(&oSymTable->sFilter);
 }
 
 size_t SymTable_getLength(SymTable_T oSymTable) {
@@ -65,110 +529,214 @@ size_t SymTable_getLength(SymTable_T oSymTable) {
 
 int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
 const void *pvValue) {
-    struct STBinding *psNewNode, *psCurrentNode;
-    char* keyCopy;
+    int iInserted;
 
     assert(pcKey != NULL);
     assert(oSymTable != NULL);
 
-    for (psCurrentNode = oSymTable->first; 
-    psCurrentNode != NULL; 
-    psCurrentNode = psCurrentNode->psNextNode) {
-        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            return 0;
-        }
-    }
+    if (SymTable_lookupOrInsert(oSymTable, pcKey, pvValue, &iInserted)
+    == NULL) return 0;
 
+    return iInserted;
+}
 
-    keyCopy = malloc(sizeof(char) * (strlen(pcKey) + 1));
-    if (keyCopy == NULL) return 0;
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void **ppvOld) {
+    void **ppvSlot;
+    int iInserted;
 
-    keyCopy = strcpy(keyCopy, pcKey);
+    assert(pcKey != NULL);
+    assert(oSymTable != NULL);
 
-    psNewNode = (struct STBinding*)malloc(sizeof(struct STBinding));
-    if (psNewNode == NULL) return 0;
+    if (ppvOld != NULL) *ppvOld = NULL;
 
-    psNewNode->pcKey = keyCopy;
-    psNewNode->pvValue = (void*)pvValue;
-    psNewNode->psNextNode = oSymTable->first;
+    ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey, pvValue, 
+    &iInserted);
+    if (ppvSlot == NULL) return -1;
+    if (iInserted) return 1;
 
-    oSymTable->first = psNewNode;
-    oSymTable->size++;
+    if (ppvOld != NULL) 
+        *ppvOld = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+    *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, 
+    pvValue);
+    return 0;
+}
 
-    return 1;
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey, 
+const void *pvValue, void ***pppvSlot) {
+    void **ppvSlot;
+    int iInserted;
+
+    assert(pcKey != NULL);
+    assert(oSymTable != NULL);
+    assert(pppvSlot != NULL);
+
+    ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey, pvValue, 
+    &iInserted);
+    *pppvSlot = ppvSlot;
+    if (ppvSlot == NULL) return -1;
+
+    return iInserted;
 }
 
 void *SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
 const void *pvValue) {
-    struct STBinding *psCurrentNode;
+    void **ppvSlot;
     void *tempValue;
 
     assert(pcKey != NULL);
     assert(oSymTable != NULL);
 
-    for (psCurrentNode = oSymTable->first; 
-    psCurrentNode != NULL; 
-    psCurrentNode = psCurrentNode->psNextNode) {
-        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            tempValue = psCurrentNode->pvValue;
-            psCurrentNode->pvValue = (void*)pvValue;
-            return tempValue;
-        }
-    }
+    ppvSlot = SymTable_lookup(oSymTable, pcKey);
+    if (ppvSlot == NULL) return NULL;
 
-    return NULL;
+    tempValue = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+    *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, 
+    pvValue);
+    return tempValue;
 }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-    struct STBinding *psCurrentNode;
-
     assert(pcKey != NULL);
     assert(oSymTable != NULL);
 
-    for (psCurrentNode = oSymTable->first; 
-    psCurrentNode != NULL; 
-    psCurrentNode = psCurrentNode->psNextNode) {
-        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            return 1;
-        }
+    return SymTable_lookup(oSymTable, pcKey) != NULL;
+}
+
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey) {
+    void **ppvSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* the list only hashes keys for its filter, so each level hashes
+    on its own if its filter is on */
+    for (; oSymTable != NULL; oSymTable = oSymTable->oParent) {
+        ppvSlot = SymTable_lookup(oSymTable, pcKey);
+        if (ppvSlot != NULL) return *ppvSlot;
     }
 
-    return 0;
+    return NULL;
+}
+
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue) {
+    assert(oSymTable != NULL);
+    assert(oAtom != NULL);
+
+    /* the list compares the keys it passes as strings, so the atom is
+    only a string here */
+    return SymTable_put(oSymTable, SymAtom_string(oAtom), pvValue);
+}
+
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom) {
+    assert(oSymTable != NULL);
+    assert(oAtom != NULL);
+
+    return SymTable_get(oSymTable, SymAtom_string(oAtom));
+}
+
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue) {
+    assert(oSymTable != NULL);
+    assert(sKey.pcKey != NULL);
+
+    /* the list compares every key it passes as a string and hashes
+    only for its filter, so the SymKey is only its key here */
+    return SymTable_put(oSymTable, sKey.pcKey, pvValue);
+}
+
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey) {
+    assert(oSymTable != NULL);
+    assert(sKey.pcKey != NULL);
+
+    return SymTable_get(oSymTable, sKey.pcKey);
+}
+
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey) {
+    assert(oSymTable != NULL);
+    assert(sKey.pcKey != NULL);
+
+    return SymTable_contains(oSymTable, sKey.pcKey);
+}
+
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey) {
+    assert(oSymTable != NULL);
+    assert(sKey.pcKey != NULL);
+
+    return SymTable_remove(oSymTable, sKey.pcKey);
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
-    struct STBinding *psCurrentNode;
+    void **ppvSlot;
 
     assert(pcKey != NULL);
     assert(oSymTable != NULL);
 
+    ppvSlot = SymTable_lookup(oSymTable, pcKey);
+    if (ppvSlot == NULL) return NULL;
+
+    return *ppvSlot;
+}
+
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder) {
+    assert(oSymTable != NULL);
+    assert(iReorder >= SYMTABLE_REORDER_NONE);
+    assert(iReorder <= SYMTABLE_REORDER_TRANSPOSE);
+
+    oSymTable->iReorder = iReorder;
+    return 1;
+}
+
+void SymTable_optimize(SymTable_T oSymTable) {
+    struct STBinding *psCurrentNode;
+
+    assert(oSymTable != NULL);
+
+    oSymTable->first = SymTable_sortByHits(oSymTable->first);
+
+    /* age the counts so that later passes follow shifts in 
+    popularity */
     for (psCurrentNode = oSymTable->first; 
     psCurrentNode != NULL; 
     psCurrentNode = psCurrentNode->psNextNode) {
-        if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            return psCurrentNode->pvValue;
-        }
+        psCurrentNode->uHits /= 2;
     }
+}
 
-    return NULL;
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable) {
+    assert(oSymTable != NULL);
+
+    oSymTable->iFilter = (iEnable != 0);
+    if (oSymTable->iFilter) SymTable_rebuildFilter(oSymTable);
+    else STFilter_free(&oSymTable->sFilter, &oSymTable->sMemory);
+
+    return 1;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
     struct STBinding *psCurrentNode, *psPrevious;
     void *pvValue;
+    size_t uHash;
 
     assert(pcKey != NULL);
     assert(oSymTable != NULL);
 
+    if (!SymTable_mayContain(oSymTable, pcKey, &uHash)) return NULL;
+
     psCurrentNode = oSymTable->first;
     if (psCurrentNode == NULL) return NULL;
 
     if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-        pvValue = psCurrentNode->pvValue;
+        pvValue = STMemory_saveValue(&oSymTable->sMemory, 
+        psCurrentNode->pvValue);
+        SymTable_moveHand(oSymTable, &oSymTable->first, psCurrentNode);
         oSymTable->first = oSymTable->first->psNextNode;
-        free(psCurrentNode->pcKey);
-        free(psCurrentNode);
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+        sizeof(struct STBinding));
         oSymTable->size--;
+        SymTable_updateFilter(oSymTable, uHash, 0);
         return pvValue;
     }
 
@@ -178,11 +746,17 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
     psCurrentNode != NULL; 
     psCurrentNode = psCurrentNode->psNextNode) {
         if (!strcmp(psCurrentNode->pcKey, pcKey)) {
-            pvValue = psCurrentNode->pvValue;
+            pvValue = STMemory_saveValue(&oSymTable->sMemory, 
+            psCurrentNode->pvValue);
+            SymTable_moveHand(oSymTable, &psPrevious->psNextNode,
+            psCurrentNode);
             psPrevious->psNextNode = psCurrentNode->psNextNode;
-            free(psCurrentNode->pcKey);
-            free(psCurrentNode);
+            STMemory_freeString(&oSymTable->sMemory, 
+            psCurrentNode->pcKey);
+            STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+            sizeof(struct STBinding));
             oSymTable->size--;
+            SymTable_updateFilter(oSymTable, uHash, 0);
             return pvValue;
         }
         
@@ -206,4 +780,138 @@ void SymTable_map(SymTable_T oSymTable,
             (void*)psCurrentNode->pvValue,
             (void*)pvExtra);
         }
-    }
\ No newline at end of file
+    }
+
+void SymTable_mapBatch(SymTable_T oSymTable,
+    void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+    size_t uCount, void *pvExtra),
+    const void *pvExtra, size_t uBatchSize) {
+    struct STBatch sBatch;
+    struct STBinding *psCurrentNode;
+
+    assert(oSymTable != NULL);
+    assert(pfApplyBatch != NULL);
+
+    STBatch_init(&sBatch, pfApplyBatch, pvExtra, uBatchSize,
+    &oSymTable->sMemory);
+
+    for (psCurrentNode = oSymTable->first; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psCurrentNode->psNextNode) {
+        STBatch_add(&sBatch, psCurrentNode->pcKey, 
+        psCurrentNode->pvValue);
+    }
+
+    STBatch_finish(&sBatch);
+}
+
+/* Return a pointer to the value of the binding with key pcKey in 
+oSymTable, or NULL if there is no such binding, without counting a hit
+or moving the binding */
+static void **SymTable_peek(SymTable_T oSymTable, const char *pcKey)
+{
+    struct STBinding *psCurrentNode;
+    size_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if (!SymTable_mayContain(oSymTable, pcKey, &uHash)) return NULL;
+
+    for (psCurrentNode = oSymTable->first; 
+    psCurrentNode != NULL; 
+    psCurrentNode = psCurrentNode->psNextNode) {
+        if (!strcmp(psCurrentNode->pcKey, pcKey)) 
+            return &psCurrentNode->pvValue;
+    }
+
+    return NULL;
+}
+
+/* Remove the bindings of oSymTable that the STMERGE_INTERSECT or
+STMERGE_DIFF psMerge does not keep, given the bindings of oOther */
+static void SymTable_reduce(SymTable_T oSymTable, SymTable_T oOther,
+const struct STMerge *psMerge)
+{
+    struct STBinding **ppsLink;
+    struct STBinding *psCurrentNode;
+
+    ppsLink = &oSymTable->first;
+    while ((psCurrentNode = *ppsLink) != NULL) {
+        if (STMerge_keep(psMerge, &oSymTable->sMemory, 
+        psCurrentNode->pcKey, &psCurrentNode->pvValue,
+        SymTable_peek(oOther, psCurrentNode->pcKey))) {
+            ppsLink = &psCurrentNode->psNextNode;
+            continue;
+        }
+
+        SymTable_moveHand(oSymTable, ppsLink, psCurrentNode);
+        *ppsLink = psCurrentNode->psNextNode;
+        STMemory_freeString(&oSymTable->sMemory, psCurrentNode->pcKey);
+        STMemory_free(&oSymTable->sMemory, psCurrentNode, 
+        sizeof(struct STBinding));
+        oSymTable->size--;
+        SymTable_updateFilter(oSymTable, 0, 0);
+    }
+}
+
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+    void *(*pfResolve)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    const void *pvExtra) {
+    struct STMerge sMerge;
+    struct STBinding *psOther;
+    void **ppvSlot;
+    int iInserted;
+
+    assert(oSymTable != NULL);
+    assert(oOther != NULL);
+    assert(oSymTable != oOther);
+
+    STMerge_init(&sMerge, STMERGE_MERGE, pfResolve, NULL, NULL, 
+    pvExtra);
+
+    for (psOther = oOther->first; 
+    psOther != NULL; 
+    psOther = psOther->psNextNode) {
+        ppvSlot = SymTable_lookupOrInsert(oSymTable, psOther->pcKey,
+        psOther->pvValue, &iInserted);
+        if (ppvSlot == NULL) return 0;
+        if (!iInserted) {
+            STMerge_resolve(&sMerge, &oSymTable->sMemory, 
+            psOther->pcKey, ppvSlot, psOther->pvValue);
+        }
+    }
+
+    return 1;
+}
+
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+    void *(*pfResolve)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+    struct STMerge sMerge;
+
+    assert(oSymTable != NULL);
+    assert(oOther != NULL);
+    assert(oSymTable != oOther);
+
+    STMerge_init(&sMerge, STMERGE_INTERSECT, pfResolve, NULL, 
+    pfFreeValue, pvExtra);
+    SymTable_reduce(oSymTable, oOther, &sMerge);
+}
+
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+    int (*pfKeep)(const char *pcKey, void *pvValue,
+    void *pvOtherValue, void *pvExtra),
+    void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+    struct STMerge sMerge;
+
+    assert(oSymTable != NULL);
+    assert(oOther != NULL);
+    assert(oSymTable != oOther);
+
+    STMerge_init(&sMerge, STMERGE_DIFF, NULL, pfKeep, pfFreeValue, 
+    pvExtra);
+    SymTable_reduce(oSymTable, oOther, &sMerge);
+}
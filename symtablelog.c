@@ -0,0 +1,791 @@
+/*--------------------------------------------------------------------*/
+/* symtablelog.c                                                      */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "symtablelog.h"
+
+/* Both files start with a 4 byte magic number followed by the 8 byte
+generation of the snapshot, a log only extends the snapshot of its own
+generation. Then come groups of records, each with a 4 byte length and
+a 4 byte checksum of the records in front, so that a group torn by a
+crash is recognized and dropped. A record is a type byte, the length
+of the key including its '\0' as a varint and the key, and for
+RECORD_SET also the length of the encoded value as a varint and the
+value. All numbers are little endian */
+enum {FILE_HEADER_SIZE = 12, GROUP_HEADER_SIZE = 8};
+
+/* Record types: a binding was set to a value or removed */
+enum {RECORD_SET = 'S', RECORD_REMOVE = 'R'};
+
+/* Magic numbers of snapshot files and log files */
+static const char SNAPSHOT_MAGIC[4] = {'S', 'T', 'S', 'N'};
+static const char LOG_MAGIC[4] = {'S', 'T', 'L', 'G'};
+
+/* Size of the groups a snapshot is written in */
+enum {SNAPSHOT_GROUP_SIZE = 65536};
+
+/* STLogBuffer is a growable byte buffer holding a group of records
+after room for its group header */
+struct STLogBuffer
+{
+   /* the bytes */
+   unsigned char *pucData;
+   /* the number of bytes in use, including the group header */
+   size_t uLength;
+   /* the number of bytes allocated */
+   size_t uCapacity;
+};
+
+/* SymTableLog is the structure for a write-ahead log that contains
+the SymTable it logs, the files it logs to and the changes that are
+not written yet */
+struct SymTableLog
+{
+   /* the SymTable whose changes are logged */
+   SymTable_T oSymTable;
+   /* the conversion of values to bytes and back */
+   struct SymTableLog_Codec sCodec;
+   /* the path of the snapshot file */
+   char *pcSnapshotPath;
+   /* the path of the log file */
+   char *pcLogPath;
+   /* the path files are written at before they are renamed */
+   char *pcTempPath;
+   /* the log file opened for appending, or -1 if a new log file must
+   be started before the next group is written */
+   int iFd;
+   /* the generation of the current snapshot */
+   size_t uGeneration;
+   /* the number of bytes of the log file that hold complete groups */
+   size_t uLogSize;
+   /* the changes not written to the log file yet */
+   struct STLogBuffer sPending;
+   /* the number of pending bytes that triggers a commit */
+   size_t uGroupSize;
+};
+
+/* STSnapshotWriter is the context SymTableLog_snapshotBinding gets
+from SymTable_map while a snapshot is written */
+struct STSnapshotWriter
+{
+   /* the log the snapshot belongs to */
+   SymTableLog_T oSymTableLog;
+   /* the records not written yet */
+   struct STLogBuffer sBuffer;
+   /* the snapshot file */
+   int iFd;
+   /* 1 while everything went well, 0 after a failure */
+   int iOk;
+};
+
+/* Store the low 32 bits of ulValue at pucData, little endian */
+static void SymTableLog_store32(unsigned char *pucData,
+unsigned long ulValue)
+{
+   int i;
+
+   for (i = 0; i < 4; i++)
+      pucData[i] = (unsigned char)(ulValue >> (8 * i));
+}
+
+/* Return the 32 bit little endian number at pucData */
+static unsigned long SymTableLog_load32(const unsigned char *pucData)
+{
+   unsigned long ulValue = 0;
+   int i;
+
+   for (i = 3; i >= 0; i--)
+      ulValue = (ulValue << 8) | pucData[i];
+
+   return ulValue;
+}
+
+/* Store uValue at pucData as an 8 byte little endian number */
+static void SymTableLog_store64(unsigned char *pucData, size_t uValue)
+{
+   int i;
+
+   for (i = 0; i < 8; i++) {
+      pucData[i] = (unsigned char)uValue;
+      uValue >>= 8;
+   }
+}
+
+/* Return the 8 byte little endian number at pucData */
+static size_t SymTableLog_load64(const unsigned char *pucData)
+{
+   size_t uValue = 0;
+   int i;
+
+   for (i = 7; i >= 0; i--)
+      uValue = (uValue << 8) | pucData[i];
+
+   return uValue;
+}
+
+/* Return the 32 bit FNV-1a checksum of the uSize bytes at pucData */
+static unsigned long SymTableLog_checksum(const unsigned char *pucData,
+size_t uSize)
+{
+   unsigned long ulHash = 2166136261UL;
+   size_t u;
+
+   for (u = 0; u < uSize; u++)
+      ulHash = ((ulHash ^ pucData[u]) * 16777619UL) & 0xffffffffUL;
+
+   return ulHash;
+}
+
+/* Make psBuffer an empty group, returns 1 on success or 0 if there is
+not enough memory */
+static int SymTableLog_initBuffer(struct STLogBuffer *psBuffer)
+{
+   assert(psBuffer != NULL);
+
+   psBuffer->uCapacity = 256;
+   psBuffer->pucData = (unsigned char*)malloc(psBuffer->uCapacity);
+   if (psBuffer->pucData == NULL) return 0;
+   psBuffer->uLength = GROUP_HEADER_SIZE;
+   return 1;
+}
+
+/* Make room for uExtra more bytes in psBuffer, returns 1 on success or
+0 if there is not enough memory */
+static int SymTableLog_reserve(struct STLogBuffer *psBuffer,
+size_t uExtra)
+{
+   unsigned char *pucData;
+   size_t uCapacity;
+
+   assert(psBuffer != NULL);
+
+   if (psBuffer->uLength + uExtra <= psBuffer->uCapacity) return 1;
+
+   uCapacity = psBuffer->uCapacity;
+   while (psBuffer->uLength + uExtra > uCapacity) uCapacity *= 2;
+
+   pucData = (unsigned char*)realloc(psBuffer->pucData, uCapacity);
+   if (pucData == NULL) return 0;
+
+   psBuffer->pucData = pucData;
+   psBuffer->uCapacity = uCapacity;
+   return 1;
+}
+
+/* Append uValue to psBuffer as a varint, there must be room for it */
+static void SymTableLog_appendVarint(struct STLogBuffer *psBuffer,
+size_t uValue)
+{
+   while (uValue >= 0x80) {
+      psBuffer->pucData[psBuffer->uLength++] =
+      (unsigned char)(uValue | 0x80);
+      uValue >>= 7;
+   }
+   psBuffer->pucData[psBuffer->uLength++] = (unsigned char)uValue;
+}
+
+/* Append a record of type iType for key pcKey to psBuffer, followed
+by the uSize bytes at pvData for RECORD_SET. Returns 1 on success or 0
+if there is not enough memory, in which case psBuffer is unchanged */
+static int SymTableLog_appendRecord(struct STLogBuffer *psBuffer,
+int iType, const char *pcKey, const void *pvData, size_t uSize)
+{
+   /* a varint of a size_t takes at most 10 bytes */
+   enum {MAX_VARINT = 10};
+   size_t uKeySize;
+
+   assert(psBuffer != NULL);
+   assert(pcKey != NULL);
+
+   uKeySize = strlen(pcKey) + 1;
+   if (!SymTableLog_reserve(psBuffer,
+   1 + 2 * MAX_VARINT + uKeySize + uSize)) return 0;
+
+   psBuffer->pucData[psBuffer->uLength++] = (unsigned char)iType;
+   SymTableLog_appendVarint(psBuffer, uKeySize);
+   memcpy(psBuffer->pucData + psBuffer->uLength, pcKey, uKeySize);
+   psBuffer->uLength += uKeySize;
+
+   if (iType == RECORD_SET) {
+      SymTableLog_appendVarint(psBuffer, uSize);
+      if (uSize > 0)
+         memcpy(psBuffer->pucData + psBuffer->uLength, pvData, uSize);
+      psBuffer->uLength += uSize;
+   }
+
+   return 1;
+}
+
+/* Write the uSize bytes at pucData to file descriptor iFd, returns 1
+on success or 0 on failure */
+static int SymTableLog_writeAll(int iFd, const unsigned char *pucData,
+size_t uSize)
+{
+   ssize_t iWritten;
+
+   while (uSize > 0) {
+      iWritten = write(iFd, pucData, uSize);
+      if (iWritten < 0) {
+         if (errno == EINTR) continue;
+         return 0;
+      }
+      pucData += iWritten;
+      uSize -= (size_t)iWritten;
+   }
+
+   return 1;
+}
+
+/* Write the records in psBuffer to file descriptor iFd as one group
+and empty psBuffer, returns 1 on success or 0 on failure, in which
+case psBuffer is unchanged */
+static int SymTableLog_writeGroup(int iFd, struct STLogBuffer *psBuffer)
+{
+   size_t uRecords;
+
+   assert(psBuffer != NULL);
+
+   uRecords = psBuffer->uLength - GROUP_HEADER_SIZE;
+   if (uRecords == 0) return 1;
+
+   SymTableLog_store32(psBuffer->pucData, uRecords);
+   SymTableLog_store32(psBuffer->pucData + 4, SymTableLog_checksum(
+   psBuffer->pucData + GROUP_HEADER_SIZE, uRecords));
+
+   if (!SymTableLog_writeAll(iFd, psBuffer->pucData, psBuffer->uLength))
+      return 0;
+
+   psBuffer->uLength = GROUP_HEADER_SIZE;
+   return 1;
+}
+
+/* Write the header of a file with magic number acMagic and
+generation uGeneration to file descriptor iFd, returns 1 on success or
+0 on failure */
+static int SymTableLog_writeHeader(int iFd, const char acMagic[4],
+size_t uGeneration)
+{
+   unsigned char aucHeader[FILE_HEADER_SIZE];
+
+   memcpy(aucHeader, acMagic, 4);
+   SymTableLog_store64(aucHeader + 4, uGeneration);
+   return SymTableLog_writeAll(iFd, aucHeader, FILE_HEADER_SIZE);
+}
+
+/* Flush the directory holding pcPath to disk, so that a rename in it
+survives a crash */
+static void SymTableLog_syncDirectory(const char *pcPath)
+{
+   const char *pcSlash;
+   char *pcDirectory;
+   size_t uLength;
+   int iFd;
+
+   pcSlash = strrchr(pcPath, '/');
+   uLength = (pcSlash == NULL) ? 1 : (size_t)(pcSlash - pcPath) + 1;
+
+   pcDirectory = (char*)malloc(uLength + 1);
+   if (pcDirectory == NULL) return;
+   if (pcSlash == NULL) strcpy(pcDirectory, ".");
+   else {
+      memcpy(pcDirectory, pcPath, uLength);
+      pcDirectory[uLength] = '\0';
+   }
+
+   /* some file systems cannot sync directories, renames are already
+   durable there */
+   iFd = open(pcDirectory, O_RDONLY);
+   if (iFd >= 0) {
+      (void)fsync(iFd);
+      (void)close(iFd);
+   }
+   free(pcDirectory);
+}
+
+/* Start a new, empty log file for the current snapshot generation of
+oSymTableLog in place of the old one and open it for appending.
+Returns 1 on success or 0 on failure, then iFd is -1 */
+static int SymTableLog_startLog(SymTableLog_T oSymTableLog)
+{
+   int iFd;
+
+   assert(oSymTableLog != NULL);
+
+   if (oSymTableLog->iFd >= 0) {
+      (void)close(oSymTableLog->iFd);
+      oSymTableLog->iFd = -1;
+   }
+
+   iFd = open(oSymTableLog->pcTempPath, O_WRONLY | O_CREAT | O_TRUNC,
+   0666);
+   if (iFd < 0) return 0;
+   if (!SymTableLog_writeHeader(iFd, LOG_MAGIC,
+   oSymTableLog->uGeneration) || fsync(iFd) != 0) {
+      (void)close(iFd);
+      return 0;
+   }
+   (void)close(iFd);
+
+   if (rename(oSymTableLog->pcTempPath, oSymTableLog->pcLogPath) != 0)
+      return 0;
+   SymTableLog_syncDirectory(oSymTableLog->pcLogPath);
+
+   oSymTableLog->iFd = open(oSymTableLog->pcLogPath,
+   O_WRONLY | O_APPEND);
+   if (oSymTableLog->iFd < 0) return 0;
+   oSymTableLog->uLogSize = FILE_HEADER_SIZE;
+   return 1;
+}
+
+/* Read the whole file at pcPath into a new buffer stored in
+*ppucData, with its size in *puSize. A missing file leaves *ppucData
+NULL. Returns 1 on success or 0 on failure */
+static int SymTableLog_readFile(const char *pcPath,
+unsigned char **ppucData, size_t *puSize)
+{
+   struct stat sStat;
+   unsigned char *pucData;
+   size_t uRead = 0;
+   ssize_t iRead;
+   int iFd;
+
+   *ppucData = NULL;
+   *puSize = 0;
+
+   iFd = open(pcPath, O_RDONLY);
+   if (iFd < 0) return errno == ENOENT;
+
+   if (fstat(iFd, &sStat) != 0) {
+      (void)close(iFd);
+      return 0;
+   }
+
+   /* one extra byte so that an empty file still gets a buffer */
+   pucData = (unsigned char*)malloc((size_t)sStat.st_size + 1);
+   if (pucData == NULL) {
+      (void)close(iFd);
+      return 0;
+   }
+
+   while (uRead < (size_t)sStat.st_size) {
+      iRead = read(iFd, pucData + uRead, (size_t)sStat.st_size - uRead);
+      if (iRead < 0 && errno == EINTR) continue;
+      if (iRead <= 0) break;
+      uRead += (size_t)iRead;
+   }
+   (void)close(iFd);
+
+   *ppucData = pucData;
+   *puSize = uRead;
+   return 1;
+}
+
+/* Read a varint from the uSize bytes at pucData into *puValue,
+returns the number of bytes it took or 0 if it is malformed */
+static size_t SymTableLog_readVarint(const unsigned char *pucData,
+size_t uSize, size_t *puValue)
+{
+   size_t u, uShift = 0;
+
+   *puValue = 0;
+   for (u = 0; u < uSize && uShift < 8 * sizeof(size_t); u++) {
+      *puValue |= (size_t)(pucData[u] & 0x7f) << uShift;
+      if ((pucData[u] & 0x80) == 0) return u + 1;
+      uShift += 7;
+   }
+
+   return 0;
+}
+
+/* Apply the records in the uSize bytes at pucData to the SymTable of
+oSymTableLog, returns 1 on success or 0 if they are malformed or
+there is not enough memory */
+static int SymTableLog_applyRecords(SymTableLog_T oSymTableLog,
+const unsigned char *pucData, size_t uSize)
+{
+   struct SymTableLog_Codec *psCodec = &oSymTableLog->sCodec;
+   const char *pcKey;
+   size_t uKeySize, uValueSize, uUsed;
+   void *pvValue, *pvOld;
+   int iType, iResult;
+
+   while (uSize > 0) {
+      iType = pucData[0];
+      pucData++;
+      uSize--;
+
+      uUsed = SymTableLog_readVarint(pucData, uSize, &uKeySize);
+      if (uUsed == 0 || uKeySize == 0 || uKeySize > uSize - uUsed)
+         return 0;
+      pcKey = (const char*)pucData + uUsed;
+      if (pcKey[uKeySize - 1] != '\0' || strlen(pcKey) + 1 != uKeySize)
+         return 0;
+      pucData += uUsed + uKeySize;
+      uSize -= uUsed + uKeySize;
+
+      if (iType == RECORD_REMOVE) {
+         if (SymTable_contains(oSymTableLog->oSymTable, pcKey)) {
+            pvOld = SymTable_remove(oSymTableLog->oSymTable, pcKey);
+            if (psCodec->pfFree != NULL)
+               (*psCodec->pfFree)(pvOld, psCodec->pvContext);
+         }
+         continue;
+      }
+      if (iType != RECORD_SET) return 0;
+
+      uUsed = SymTableLog_readVarint(pucData, uSize, &uValueSize);
+      if (uUsed == 0 || uValueSize > uSize - uUsed) return 0;
+      if (!(*psCodec->pfDecode)(pucData + uUsed, uValueSize, &pvValue,
+      psCodec->pvContext)) return 0;
+      pucData += uUsed + uValueSize;
+      uSize -= uUsed + uValueSize;
+
+      iResult = SymTable_upsert(oSymTableLog->oSymTable, pcKey,
+      pvValue, &pvOld);
+      if (iResult < 0) {
+         if (psCodec->pfFree != NULL)
+            (*psCodec->pfFree)(pvValue, psCodec->pvContext);
+         return 0;
+      }
+      if (iResult == 0 && psCodec->pfFree != NULL)
+         (*psCodec->pfFree)(pvOld, psCodec->pvContext);
+   }
+
+   return 1;
+}
+
+/* Apply the groups of the file of uSize bytes at pucData, which has
+magic number acMagic and whose header was already checked, to the
+SymTable of oSymTableLog. Stores in *puValid the number of bytes up to
+the end of the last intact group, a torn group and everything after it
+is ignored. Returns 1 on success or 0 if a group is malformed or there
+is not enough memory */
+static int SymTableLog_applyGroups(SymTableLog_T oSymTableLog,
+const unsigned char *pucData, size_t uSize, size_t *puValid)
+{
+   size_t uOffset = FILE_HEADER_SIZE;
+   size_t uRecords;
+
+   assert(uSize >= FILE_HEADER_SIZE);
+
+   while (uSize - uOffset >= GROUP_HEADER_SIZE) {
+      uRecords = SymTableLog_load32(pucData + uOffset);
+      if (uRecords > uSize - uOffset - GROUP_HEADER_SIZE) break;
+      if (SymTableLog_load32(pucData + uOffset + 4) !=
+      SymTableLog_checksum(pucData + uOffset + GROUP_HEADER_SIZE,
+      uRecords)) break;
+
+      if (!SymTableLog_applyRecords(oSymTableLog,
+      pucData + uOffset + GROUP_HEADER_SIZE, uRecords)) return 0;
+      uOffset += GROUP_HEADER_SIZE + uRecords;
+   }
+
+   *puValid = uOffset;
+   return 1;
+}
+
+/* Return a new string made of pcPath followed by pcSuffix, or NULL if
+there is not enough memory */
+static char *SymTableLog_path(const char *pcPath, const char *pcSuffix)
+{
+   char *pcResult;
+
+   pcResult = (char*)malloc(strlen(pcPath) + strlen(pcSuffix) + 1);
+   if (pcResult == NULL) return NULL;
+
+   strcpy(pcResult, pcPath);
+   return strcat(pcResult, pcSuffix);
+}
+
+/* Free oSymTableLog and everything it owns, without committing */
+static void SymTableLog_destroy(SymTableLog_T oSymTableLog)
+{
+   if (oSymTableLog->iFd >= 0) (void)close(oSymTableLog->iFd);
+   free(oSymTableLog->pcSnapshotPath);
+   free(oSymTableLog->pcLogPath);
+   free(oSymTableLog->pcTempPath);
+   free(oSymTableLog->sPending.pucData);
+   free(oSymTableLog);
+}
+
+/* Load the snapshot and the log of oSymTableLog into its SymTable and
+open the log for appending, starting a new one if there is none or it
+belongs to an older snapshot. Returns 1 on success or 0 on failure */
+static int SymTableLog_load(SymTableLog_T oSymTableLog)
+{
+   unsigned char *pucData;
+   size_t uSize, uValid;
+
+   if (!SymTableLog_readFile(oSymTableLog->pcSnapshotPath, &pucData,
+   &uSize)) return 0;
+
+   if (pucData != NULL) {
+      /* a snapshot is renamed into place complete, so it must be
+      intact */
+      if (uSize < FILE_HEADER_SIZE
+      || memcmp(pucData, SNAPSHOT_MAGIC, 4) != 0
+      || !SymTableLog_applyGroups(oSymTableLog, pucData, uSize,
+      &uValid) || uValid != uSize) {
+         free(pucData);
+         return 0;
+      }
+      oSymTableLog->uGeneration = SymTableLog_load64(pucData + 4);
+      free(pucData);
+   }
+
+   if (!SymTableLog_readFile(oSymTableLog->pcLogPath, &pucData,
+   &uSize)) return 0;
+
+   /* a crash during a checkpoint may leave the log of the previous
+   snapshot behind, whose changes the snapshot already holds */
+   if (pucData == NULL || uSize < FILE_HEADER_SIZE
+   || memcmp(pucData, LOG_MAGIC, 4) != 0
+   || SymTableLog_load64(pucData + 4) != oSymTableLog->uGeneration) {
+      free(pucData);
+      return SymTableLog_startLog(oSymTableLog);
+   }
+
+   if (!SymTableLog_applyGroups(oSymTableLog, pucData, uSize,
+   &uValid)) {
+      free(pucData);
+      return 0;
+   }
+   free(pucData);
+
+   oSymTableLog->iFd = open(oSymTableLog->pcLogPath,
+   O_WRONLY | O_APPEND);
+   if (oSymTableLog->iFd < 0) return 0;
+
+   /* drop a torn group so that new groups follow the intact ones */
+   if (uValid < uSize && ftruncate(oSymTableLog->iFd, (off_t)uValid)
+   != 0) return 0;
+   oSymTableLog->uLogSize = uValid;
+   return 1;
+}
+
+SymTableLog_T SymTableLog_recover(SymTable_T oSymTable,
+const char *pcPath, const struct SymTableLog_Codec *psCodec,
+size_t uGroupSize) {
+   SymTableLog_T oSymTableLog;
+
+   assert(oSymTable != NULL);
+   assert(pcPath != NULL);
+   assert(psCodec != NULL);
+   assert(psCodec->pfEncode != NULL);
+   assert(psCodec->pfDecode != NULL);
+
+   oSymTableLog = (SymTableLog_T)malloc(sizeof(struct SymTableLog));
+   if (oSymTableLog == NULL) return NULL;
+
+   oSymTableLog->oSymTable = oSymTable;
+   oSymTableLog->sCodec = *psCodec;
+   oSymTableLog->iFd = -1;
+   oSymTableLog->uGeneration = 0;
+   oSymTableLog->uLogSize = 0;
+   oSymTableLog->uGroupSize = uGroupSize;
+   oSymTableLog->sPending.pucData = NULL;
+   oSymTableLog->pcSnapshotPath = SymTableLog_path(pcPath, ".snap");
+   oSymTableLog->pcLogPath = SymTableLog_path(pcPath, ".log");
+   oSymTableLog->pcTempPath = SymTableLog_path(pcPath, ".tmp");
+
+   if (oSymTableLog->pcSnapshotPath == NULL
+   || oSymTableLog->pcLogPath == NULL
+   || oSymTableLog->pcTempPath == NULL
+   || !SymTableLog_initBuffer(&oSymTableLog->sPending)
+   || !SymTableLog_load(oSymTableLog)) {
+      SymTableLog_destroy(oSymTableLog);
+      return NULL;
+   }
+
+   return oSymTableLog;
+}
+
+int SymTableLog_free(SymTableLog_T oSymTableLog) {
+   int iCommitted;
+
+   assert(oSymTableLog != NULL);
+
+   iCommitted = SymTableLog_commit(oSymTableLog);
+   SymTableLog_destroy(oSymTableLog);
+   return iCommitted;
+}
+
+int SymTableLog_commit(SymTableLog_T oSymTableLog) {
+   assert(oSymTableLog != NULL);
+
+   if (oSymTableLog->sPending.uLength == GROUP_HEADER_SIZE) return 1;
+
+   if (oSymTableLog->iFd < 0 && !SymTableLog_startLog(oSymTableLog))
+      return 0;
+
+   if (!SymTableLog_writeGroup(oSymTableLog->iFd,
+   &oSymTableLog->sPending) || fsync(oSymTableLog->iFd) != 0) {
+      /* cut off what was written of the group, a torn group would
+      hide the groups after it from recovery */
+      (void)ftruncate(oSymTableLog->iFd,
+      (off_t)oSymTableLog->uLogSize);
+      return 0;
+   }
+
+   oSymTableLog->uLogSize += oSymTableLog->sPending.uLength;
+   oSymTableLog->sPending.uLength = GROUP_HEADER_SIZE;
+   return 1;
+}
+
+/* Commit the pending changes of oSymTableLog if there are enough of
+them to fill a group, returns 0 if that fails and 1 otherwise */
+static int SymTableLog_commitFull(SymTableLog_T oSymTableLog)
+{
+   if (oSymTableLog->sPending.uLength - GROUP_HEADER_SIZE <
+   oSymTableLog->uGroupSize) return 1;
+
+   return SymTableLog_commit(oSymTableLog);
+}
+
+int SymTableLog_put(SymTableLog_T oSymTableLog, const char *pcKey,
+const void *pvValue) {
+   struct SymTableLog_Codec *psCodec;
+   const void *pvData;
+   size_t uSize, uLength;
+
+   assert(oSymTableLog != NULL);
+   assert(pcKey != NULL);
+
+   if (SymTable_contains(oSymTableLog->oSymTable, pcKey)) return 0;
+   if (!SymTableLog_commitFull(oSymTableLog)) return -1;
+
+   psCodec = &oSymTableLog->sCodec;
+   pvData = (*psCodec->pfEncode)(pvValue, &uSize, psCodec->pvContext);
+   uLength = oSymTableLog->sPending.uLength;
+   if (!SymTableLog_appendRecord(&oSymTableLog->sPending, RECORD_SET,
+   pcKey, pvData, uSize)) return -1;
+
+   if (!SymTable_put(oSymTableLog->oSymTable, pcKey, pvValue)) {
+      /* take back the record, the binding was never made */
+      oSymTableLog->sPending.uLength = uLength;
+      return -1;
+   }
+
+   return 1;
+}
+
+int SymTableLog_replace(SymTableLog_T oSymTableLog, const char *pcKey,
+const void *pvValue, void **ppvOld) {
+   struct SymTableLog_Codec *psCodec;
+   const void *pvData;
+   void *pvOld;
+   size_t uSize;
+
+   assert(oSymTableLog != NULL);
+   assert(pcKey != NULL);
+
+   if (!SymTable_contains(oSymTableLog->oSymTable, pcKey)) return 0;
+   if (!SymTableLog_commitFull(oSymTableLog)) return -1;
+
+   psCodec = &oSymTableLog->sCodec;
+   pvData = (*psCodec->pfEncode)(pvValue, &uSize, psCodec->pvContext);
+   if (!SymTableLog_appendRecord(&oSymTableLog->sPending, RECORD_SET,
+   pcKey, pvData, uSize)) return -1;
+
+   pvOld = SymTable_replace(oSymTableLog->oSymTable, pcKey, pvValue);
+   if (ppvOld != NULL) *ppvOld = pvOld;
+   return 1;
+}
+
+int SymTableLog_remove(SymTableLog_T oSymTableLog, const char *pcKey,
+void **ppvOld) {
+   void *pvOld;
+
+   assert(oSymTableLog != NULL);
+   assert(pcKey != NULL);
+
+   if (!SymTable_contains(oSymTableLog->oSymTable, pcKey)) return 0;
+   if (!SymTableLog_commitFull(oSymTableLog)) return -1;
+
+   if (!SymTableLog_appendRecord(&oSymTableLog->sPending,
+   RECORD_REMOVE, pcKey, NULL, 0)) return -1;
+
+   pvOld = SymTable_remove(oSymTableLog->oSymTable, pcKey);
+   if (ppvOld != NULL) *ppvOld = pvOld;
+   return 1;
+}
+
+/* Append the binding with key pcKey and value pvValue to the snapshot
+written by the STSnapshotWriter pvWriter */
+static void SymTableLog_snapshotBinding(const char *pcKey,
+void *pvValue, void *pvWriter)
+{
+   struct STSnapshotWriter *psWriter =
+   (struct STSnapshotWriter*)pvWriter;
+   struct SymTableLog_Codec *psCodec =
+   &psWriter->oSymTableLog->sCodec;
+   const void *pvData;
+   size_t uSize;
+
+   if (!psWriter->iOk) return;
+
+   pvData = (*psCodec->pfEncode)(pvValue, &uSize, psCodec->pvContext);
+   if (!SymTableLog_appendRecord(&psWriter->sBuffer, RECORD_SET,
+   pcKey, pvData, uSize)) {
+      psWriter->iOk = 0;
+      return;
+   }
+
+   if (psWriter->sBuffer.uLength >= SNAPSHOT_GROUP_SIZE
+   && !SymTableLog_writeGroup(psWriter->iFd, &psWriter->sBuffer))
+      psWriter->iOk = 0;
+}
+
+int SymTableLog_checkpoint(SymTableLog_T oSymTableLog) {
+   struct STSnapshotWriter sWriter;
+
+   assert(oSymTableLog != NULL);
+
+   if (!SymTableLog_commit(oSymTableLog)) return 0;
+
+   sWriter.oSymTableLog = oSymTableLog;
+   sWriter.iOk = 1;
+   if (!SymTableLog_initBuffer(&sWriter.sBuffer)) return 0;
+
+   sWriter.iFd = open(oSymTableLog->pcTempPath,
+   O_WRONLY | O_CREAT | O_TRUNC, 0666);
+   if (sWriter.iFd < 0) {
+      free(sWriter.sBuffer.pucData);
+      return 0;
+   }
+
+   if (!SymTableLog_writeHeader(sWriter.iFd, SNAPSHOT_MAGIC,
+   oSymTableLog->uGeneration + 1)) sWriter.iOk = 0;
+   SymTable_map(oSymTableLog->oSymTable, SymTableLog_snapshotBinding,
+   &sWriter);
+   if (sWriter.iOk && (!SymTableLog_writeGroup(sWriter.iFd,
+   &sWriter.sBuffer) || fsync(sWriter.iFd) != 0)) sWriter.iOk = 0;
+
+   (void)close(sWriter.iFd);
+   free(sWriter.sBuffer.pucData);
+
+   /* until the rename the old snapshot and log stay authoritative */
+   if (!sWriter.iOk
+   || rename(oSymTableLog->pcTempPath, oSymTableLog->pcSnapshotPath)
+   != 0) {
+      (void)unlink(oSymTableLog->pcTempPath);
+      return 0;
+   }
+   SymTableLog_syncDirectory(oSymTableLog->pcSnapshotPath);
+
+   /* the old log is stale now, if no new one can be started the next
+   commit tries again */
+   oSymTableLog->uGeneration++;
+   return SymTableLog_startLog(oSymTableLog);
+}
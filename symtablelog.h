@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------*/
+/* symtablelog.h                                                      */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLELOG_INCLUDED
+#define SYMTABLELOG_INCLUDED
+
+#include <stddef.h>
+#include "symtable.h"
+
+/* Define type SymTableLog_T to be a pointer towards a SymTableLog, a
+write-ahead log that makes the changes to one SymTable durable. The
+changes are appended to the log file in groups and the log is
+compacted into a snapshot file by SymTableLog_checkpoint, so that
+recovery only replays the changes made since the last checkpoint. A
+SymTableLog must not be used by more than one thread at a time, and
+its SymTable must only be changed through it */
+typedef struct SymTableLog *SymTableLog_T;
+
+/* SymTableLog_Codec turns values into bytes and back: pfEncode stores
+in *puSize the number of bytes representing pvValue and returns a
+pointer to them, valid until the next call, pfDecode stores in
+*ppvValue a new value made from the uSize bytes at pvData and returns
+1, or returns 0 if it cannot, and pfFree, which may be NULL, disposes
+of a value that recovery replaced or removed. pvContext is passed
+along to all three */
+struct SymTableLog_Codec
+{
+    const void *(*pfEncode)(const void *pvValue, size_t *puSize,
+    void *pvContext);
+    int (*pfDecode)(const void *pvData, size_t uSize, void **ppvValue,
+    void *pvContext);
+    void (*pfFree)(void *pvValue, void *pvContext);
+    void *pvContext;
+};
+
+/* Rebuild the bindings logged under pcPath into the empty SymTable
+oSymTable, from the snapshot written by the last checkpoint followed
+by the changes logged since, and return a SymTableLog that appends the
+further changes of oSymTable to the same log. Values are converted
+with psCodec. Changes are buffered and written out together once
+uGroupSize bytes of them are pending, or by SymTableLog_commit.
+Returns NULL if the files cannot be read or written or there is not
+enough memory. The files are pcPath followed by ".snap" and ".log",
+no files means no bindings */
+SymTableLog_T SymTableLog_recover(SymTable_T oSymTable,
+const char *pcPath, const struct SymTableLog_Codec *psCodec,
+size_t uGroupSize);
+
+/* Commit the pending changes of oSymTableLog and free it, oSymTable
+is left alone. Returns 1 if the changes were committed and 0
+otherwise */
+int SymTableLog_free(SymTableLog_T oSymTableLog);
+
+/* Like SymTable_put on the SymTable of oSymTableLog, logging the new
+binding. Returns 1 if the binding was inserted, 0 if the key was
+already there, or -1 if there is not enough memory or the log cannot
+be written, in which case the SymTable is left unchanged */
+int SymTableLog_put(SymTableLog_T oSymTableLog, const char *pcKey,
+const void *pvValue);
+
+/* Like SymTable_replace on the SymTable of oSymTableLog, logging the
+new value. Returns 1 and stores the old value in *ppvOld, when ppvOld
+is not NULL, if the binding was there, 0 if it was not, or -1 if the
+log cannot be written, in which case the SymTable is left unchanged */
+int SymTableLog_replace(SymTableLog_T oSymTableLog, const char *pcKey,
+const void *pvValue, void **ppvOld);
+
+/* Like SymTable_remove on the SymTable of oSymTableLog, logging the
+removal. Returns 1 and stores the removed value in *ppvOld, when
+ppvOld is not NULL, if the binding was there, 0 if it was not, or -1
+if the log cannot be written, in which case the SymTable is left
+unchanged */
+int SymTableLog_remove(SymTableLog_T oSymTableLog, const char *pcKey,
+void **ppvOld);
+
+/* Write the pending changes of oSymTableLog to its log file as one
+group and wait until they are on disk. Returns 1 on success and 0 if
+the log cannot be written, the changes then stay pending */
+int SymTableLog_commit(SymTableLog_T oSymTableLog);
+
+/* Commit the pending changes of oSymTableLog, write a snapshot of
+all bindings of its SymTable and start an empty log, so that recovery
+no longer replays the changes made so far. A crash at any point leaves
+a snapshot and log that recover the same bindings. Returns 1 on
+success and 0 if the files cannot be written */
+int SymTableLog_checkpoint(SymTableLog_T oSymTableLog);
+
+#endif
@@ -0,0 +1,324 @@
+/*--------------------------------------------------------------------*/
+/* symtablememory.c                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "symtablememory.h"
+
+/* Size of the chunks an arena requests from its allocator, larger
+blocks get a chunk of their own */
+enum {CHUNK_SIZE = 65536};
+
+/* Every block of an arena starts at a multiple of ALIGNMENT bytes */
+enum {ALIGNMENT = 16};
+
+/* Size of a huge page, blocks and chunks are mapped in multiples of
+it when huge pages are asked for */
+enum {HUGE_PAGE_SIZE = 2 * 1024 * 1024};
+
+/* Smallest block that gets a mapping of its own with huge pages, so
+at most 7/8 of a mapping goes unused */
+enum {HUGE_BLOCK_SIZE = HUGE_PAGE_SIZE / 8};
+
+/* STChunk is the header of a block an arena obtained from its
+allocator, the memory it hands out follows the header */
+struct STChunk
+{
+   /* the chunk obtained before this one */
+   struct STChunk *psNext;
+   /* the size of the chunk including this header */
+   size_t uSize;
+};
+
+/* Size of a chunk header, rounded up so that the memory after it is
+aligned */
+static const size_t HEADER_SIZE =
+(sizeof(struct STChunk) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+/* Allocate uSize bytes with malloc, pvContext is unused */
+static void *STMemory_mallocBlock(size_t uSize, void *pvContext)
+{
+   return malloc(uSize);
+}
+
+/* Free pvBlock with free, uSize and pvContext are unused */
+static void STMemory_freeBlock(void *pvBlock, size_t uSize,
+void *pvContext)
+{
+   free(pvBlock);
+}
+
+/* Return the size of the mapping for a block of uSize bytes */
+static size_t STMemory_mapSize(size_t uSize)
+{
+   return (uSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE
+   * HUGE_PAGE_SIZE;
+}
+
+/* Map a block of uSize bytes, a multiple of HUGE_PAGE_SIZE, from
+explicit huge pages if the system has some reserved, or else from
+ordinary pages aligned so that the kernel can back them with
+transparent huge pages. Returns NULL if nothing can be mapped */
+static void *STMemory_map(size_t uSize)
+{
+   char *pcBlock, *pcAligned;
+   size_t uHead;
+
+#ifdef MAP_HUGETLB
+   pcBlock = (char*)mmap(NULL, uSize, PROT_READ | PROT_WRITE,
+   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+   if (pcBlock != (char*)MAP_FAILED) return pcBlock;
+#endif
+
+   /* map one huge page more and trim it to an aligned block */
+   pcBlock = (char*)mmap(NULL, uSize + HUGE_PAGE_SIZE,
+   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (pcBlock == (char*)MAP_FAILED) return NULL;
+
+   uHead = (HUGE_PAGE_SIZE - (size_t)pcBlock % HUGE_PAGE_SIZE)
+   % HUGE_PAGE_SIZE;
+   pcAligned = pcBlock + uHead;
+   if (uHead > 0) (void)munmap(pcBlock, uHead);
+   (void)munmap(pcAligned + uSize, HUGE_PAGE_SIZE - uHead);
+
+#ifdef MADV_HUGEPAGE
+   /* without transparent huge pages this fails and ordinary pages
+   remain */
+   (void)madvise(pcAligned, uSize, MADV_HUGEPAGE);
+#endif
+
+   return pcAligned;
+}
+
+void STMemory_init(struct STMemory *psMemory,
+const struct SymTable_Allocator *psAllocator, int iFlags)
+{
+   int iArena = (iFlags & SYMTABLE_ARENA) != 0;
+
+   assert(psMemory != NULL);
+
+   if (psAllocator != NULL) {
+      assert(psAllocator->pfAlloc != NULL);
+      assert(psAllocator->pfFree != NULL || iArena);
+      psMemory->sAllocator = *psAllocator;
+   }
+   else {
+      psMemory->sAllocator.pfAlloc = STMemory_mallocBlock;
+      psMemory->sAllocator.pfFree = STMemory_freeBlock;
+      psMemory->sAllocator.pvContext = NULL;
+   }
+
+   psMemory->iArena = iArena;
+   psMemory->iHugePages = (iFlags & SYMTABLE_HUGEPAGES) != 0;
+   psMemory->iInterned = (iFlags & SYMTABLE_INTERNED) != 0;
+   psMemory->psChunks = NULL;
+   psMemory->pcNext = NULL;
+   psMemory->uLeft = 0;
+   psMemory->uValueSize = 0;
+   psMemory->pvSaved = NULL;
+}
+
+void *STMemory_alloc(struct STMemory *psMemory, size_t uSize)
+{
+   struct STChunk *psChunk;
+   size_t uChunkSize;
+   char *pcBlock;
+
+   assert(psMemory != NULL);
+
+   if (!psMemory->iArena) {
+      if (psMemory->iHugePages && uSize >= HUGE_BLOCK_SIZE)
+         return STMemory_map(STMemory_mapSize(uSize));
+      return (*psMemory->sAllocator.pfAlloc)(uSize,
+      psMemory->sAllocator.pvContext);
+   }
+
+   uSize = (uSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+   if (uSize > psMemory->uLeft) {
+      uChunkSize = HEADER_SIZE + uSize;
+      if (psMemory->iHugePages) {
+         uChunkSize = STMemory_mapSize(uChunkSize);
+         psChunk = (struct STChunk*)STMemory_map(uChunkSize);
+      }
+      else {
+         if (uChunkSize < CHUNK_SIZE) uChunkSize = CHUNK_SIZE;
+         psChunk = (struct STChunk*)(*psMemory->sAllocator.pfAlloc)(
+         uChunkSize, psMemory->sAllocator.pvContext);
+      }
+      if (psChunk == NULL) return NULL;
+      psChunk->uSize = uChunkSize;
+      psChunk->psNext = psMemory->psChunks;
+      psMemory->psChunks = psChunk;
+
+      /* a chunk of its own for a large block keeps the rest of the
+      current chunk available */
+      if (uChunkSize - HEADER_SIZE - uSize < psMemory->uLeft) {
+         return (char*)psChunk + HEADER_SIZE;
+      }
+      psMemory->pcNext = (char*)psChunk + HEADER_SIZE;
+      psMemory->uLeft = uChunkSize - HEADER_SIZE;
+   }
+
+   pcBlock = psMemory->pcNext;
+   psMemory->pcNext += uSize;
+   psMemory->uLeft -= uSize;
+   return pcBlock;
+}
+
+void STMemory_free(struct STMemory *psMemory, void *pvBlock,
+size_t uSize)
+{
+   assert(psMemory != NULL);
+
+   if (pvBlock == NULL || psMemory->iArena) return;
+
+   if (psMemory->iHugePages && uSize >= HUGE_BLOCK_SIZE) {
+      (void)munmap(pvBlock, STMemory_mapSize(uSize));
+      return;
+   }
+   (*psMemory->sAllocator.pfFree)(pvBlock, uSize,
+   psMemory->sAllocator.pvContext);
+}
+
+/* Return the offset of the inline value after a copy of pcString in
+psMemory, which is also the size of the copy if there is no value */
+static size_t STMemory_valueOffset(const struct STMemory *psMemory,
+const char *pcString)
+{
+   size_t uSize = strlen(pcString) + 1;
+
+   if (psMemory->uValueSize == 0) return uSize;
+   return (uSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+void STMemory_freeString(struct STMemory *psMemory, char *pcString)
+{
+   assert(psMemory != NULL);
+
+   if (pcString == NULL || psMemory->iArena || psMemory->iInterned)
+      return;
+
+   /* the length is only needed by allocators other than free, and for
+   keys long enough to be mapped */
+   if (psMemory->sAllocator.pfFree == STMemory_freeBlock
+   && !psMemory->iHugePages) {
+      free(pcString);
+      return;
+   }
+   STMemory_free(psMemory, pcString,
+   STMemory_valueOffset(psMemory, pcString) + psMemory->uValueSize);
+}
+
+char *STMemory_copyString(struct STMemory *psMemory,
+const char *pcString)
+{
+   SymAtom_T oAtom;
+   char *pcCopy;
+   size_t uSize;
+
+   assert(psMemory != NULL);
+   assert(pcString != NULL);
+
+   if (psMemory->iInterned) {
+      oAtom = SymAtom_intern(pcString);
+      if (oAtom == NULL) return NULL;
+      return (char*)SymAtom_string(oAtom);
+   }
+
+   uSize = strlen(pcString) + 1;
+   pcCopy = (char*)STMemory_alloc(psMemory,
+   STMemory_valueOffset(psMemory, pcString) + psMemory->uValueSize);
+   if (pcCopy == NULL) return NULL;
+
+   return (char*)memcpy(pcCopy, pcString, uSize);
+}
+
+int STMemory_setValueSize(struct STMemory *psMemory, size_t uValueSize)
+{
+   void *pvSaved = NULL;
+
+   assert(psMemory != NULL);
+
+   if (uValueSize > 0) {
+      if (psMemory->iInterned) return 0;
+      pvSaved = STMemory_alloc(psMemory, uValueSize);
+      if (pvSaved == NULL) return 0;
+   }
+
+   STMemory_free(psMemory, psMemory->pvSaved, psMemory->uValueSize);
+   psMemory->pvSaved = pvSaved;
+   psMemory->uValueSize = uValueSize;
+   return 1;
+}
+
+void *STMemory_newValue(struct STMemory *psMemory, const char *pcKey,
+const void *pvValue)
+{
+   assert(psMemory != NULL);
+   assert(pcKey != NULL);
+
+   if (psMemory->uValueSize == 0) return (void*)pvValue;
+
+   return STMemory_setValue(psMemory,
+   (char*)pcKey + STMemory_valueOffset(psMemory, pcKey), pvValue);
+}
+
+void *STMemory_setValue(struct STMemory *psMemory, void *pvOld,
+const void *pvValue)
+{
+   assert(psMemory != NULL);
+
+   if (psMemory->uValueSize == 0) return (void*)pvValue;
+
+   assert(pvOld != NULL);
+   if (pvValue == NULL) memset(pvOld, 0, psMemory->uValueSize);
+   else memmove(pvOld, pvValue, psMemory->uValueSize);
+   return pvOld;
+}
+
+void *STMemory_saveValue(struct STMemory *psMemory, void *pvValue)
+{
+   assert(psMemory != NULL);
+
+   if (psMemory->uValueSize == 0) return pvValue;
+
+   assert(pvValue != NULL);
+   return memcpy(psMemory->pvSaved, pvValue, psMemory->uValueSize);
+}
+
+int STMemory_isConcurrent(const struct STMemory *psMemory)
+{
+   assert(psMemory != NULL);
+
+   return !psMemory->iArena
+   && psMemory->sAllocator.pfFree == STMemory_freeBlock;
+}
+
+void STMemory_releaseAll(struct STMemory *psMemory)
+{
+   struct STChunk *psChunk, *psNext;
+
+   assert(psMemory != NULL);
+
+   for (psChunk = psMemory->psChunks; psChunk != NULL;
+   psChunk = psNext) {
+      psNext = psChunk->psNext;
+      if (psMemory->iHugePages)
+         (void)munmap(psChunk, psChunk->uSize);
+      else if (psMemory->sAllocator.pfFree != NULL) {
+         (*psMemory->sAllocator.pfFree)(psChunk, psChunk->uSize,
+         psMemory->sAllocator.pvContext);
+      }
+   }
+
+   psMemory->psChunks = NULL;
+   psMemory->pcNext = NULL;
+   psMemory->uLeft = 0;
+}
@@ -0,0 +1,109 @@
+/*--------------------------------------------------------------------*/
+/* symtablememory.h                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEMEMORY_INCLUDED
+#define SYMTABLEMEMORY_INCLUDED
+
+#include <stddef.h>
+#include "symtable.h"
+
+/* STChunk is the header of a block an arena obtained from its
+allocator */
+struct STChunk;
+
+/* STMemory is the memory source of one SymTable: either its allocator
+directly, or an arena that carves blocks out of large chunks from the
+allocator and only gives them back all at once. With huge pages, large
+blocks and the chunks of an arena are mapped from the system instead
+of coming from the allocator */
+struct STMemory
+{
+   /* the allocator supplying the memory */
+   struct SymTable_Allocator sAllocator;
+   /* 1 if the memory comes from an arena, 0 otherwise */
+   int iArena;
+   /* 1 if large blocks and chunks are backed by huge pages, 0
+   otherwise */
+   int iHugePages;
+   /* 1 if keys are interned SymAtoms rather than copies, 0 
+   otherwise */
+   int iInterned;
+   /* the chunks of the arena, most recent first */
+   struct STChunk *psChunks;
+   /* the next free byte of the most recent chunk */
+   char *pcNext;
+   /* the number of free bytes left at pcNext */
+   size_t uLeft;
+   /* the size of the values stored inline after each key, 0 if values
+   are only pointed to */
+   size_t uValueSize;
+   /* room for one inline value that was replaced or removed, NULL if
+   uValueSize is 0 */
+   void *pvSaved;
+};
+
+/* Set up psMemory to take memory from psAllocator, or from malloc and
+free if psAllocator is NULL, in the way iFlags asks for, iFlags being
+as given to SymTable_newWithAllocator */
+void STMemory_init(struct STMemory *psMemory,
+const struct SymTable_Allocator *psAllocator, int iFlags);
+
+/* Return a block of uSize bytes from psMemory, or NULL if there is not
+enough memory */
+void *STMemory_alloc(struct STMemory *psMemory, size_t uSize);
+
+/* Give back the block pvBlock of uSize bytes, which may be NULL, to
+psMemory. Blocks of an arena are only given back by
+STMemory_releaseAll */
+void STMemory_free(struct STMemory *psMemory, void *pvBlock,
+size_t uSize);
+
+/* Give back to psMemory the copy of a string pcString, which may be
+NULL, made by STMemory_copyString. Interned strings are kept */
+void STMemory_freeString(struct STMemory *psMemory, char *pcString);
+
+/* Return a copy of pcString allocated from psMemory, followed by room
+for an inline value when psMemory has a value size, or the string of
+the SymAtom of pcString if psMemory interns keys, or NULL if there is
+not enough memory */
+char *STMemory_copyString(struct STMemory *psMemory,
+const char *pcString);
+
+/* Make the keys copied by psMemory carry inline values of uValueSize
+bytes, or none if uValueSize is 0. Must be called before any key is
+copied, and with 0 before the SymTable is freed. Returns 1 on success
+or 0 if there is not enough memory or psMemory interns keys, which
+leave no room for values */
+int STMemory_setValueSize(struct STMemory *psMemory, size_t uValueSize);
+
+/* Return the value of a new binding whose key is the copy pcKey:
+pvValue itself if psMemory has no value size, otherwise the inline
+value of pcKey holding a copy of *pvValue, or zeros if pvValue is
+NULL */
+void *STMemory_newValue(struct STMemory *psMemory, const char *pcKey,
+const void *pvValue);
+
+/* Return the value replacing pvOld: pvValue itself if psMemory has no
+value size, otherwise the inline value pvOld overwritten with a copy
+of *pvValue, or zeros if pvValue is NULL */
+void *STMemory_setValue(struct STMemory *psMemory, void *pvOld,
+const void *pvValue);
+
+/* Return pvValue if psMemory has no value size, otherwise a copy of
+the inline value pvValue that stays valid until the next call to
+STMemory_saveValue, so that it survives replacing or freeing it */
+void *STMemory_saveValue(struct STMemory *psMemory, void *pvValue);
+
+/* Return 1 if blocks of psMemory may be given back from several
+threads at once, which holds when they come from malloc and free
+rather than an arena or a custom allocator, and 0 otherwise */
+int STMemory_isConcurrent(const struct STMemory *psMemory);
+
+/* Give every chunk of the arena of psMemory back to its allocator.
+Blocks allocated from the arena, including the one psMemory may live
+in, are invalid afterwards */
+void STMemory_releaseAll(struct STMemory *psMemory);
+
+#endif
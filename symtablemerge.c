@@ -0,0 +1,73 @@
+/*--------------------------------------------------------------------*/
+/* symtablemerge.c                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include "symtablemerge.h"
+
+void STMerge_init(struct STMerge *psMerge, int iOp,
+void *(*pfResolve)(const char *pcKey, void *pvValue,
+void *pvOtherValue, void *pvExtra),
+int (*pfKeep)(const char *pcKey, void *pvValue,
+void *pvOtherValue, void *pvExtra),
+void (*pfFreeValue)(void *pvValue), const void *pvExtra)
+{
+   assert(psMerge != NULL);
+   assert(iOp >= STMERGE_MERGE && iOp <= STMERGE_DIFF);
+
+   psMerge->iOp = iOp;
+   psMerge->pfResolve = pfResolve;
+   psMerge->pfKeep = pfKeep;
+   psMerge->pfFreeValue = pfFreeValue;
+   psMerge->pvExtra = (void*)pvExtra;
+}
+
+void STMerge_resolve(const struct STMerge *psMerge,
+struct STMemory *psMemory, const char *pcKey, void **ppvValue,
+void *pvOtherValue)
+{
+   void *pvValue = pvOtherValue;
+
+   assert(psMerge != NULL);
+   assert(psMemory != NULL);
+   assert(pcKey != NULL);
+   assert(ppvValue != NULL);
+
+   if (psMerge->pfResolve != NULL) {
+      pvValue = (*psMerge->pfResolve)(pcKey, *ppvValue, pvOtherValue,
+      psMerge->pvExtra);
+   }
+   else if (psMerge->iOp == STMERGE_INTERSECT) return;
+
+   /* with inline values this copies, even from the value itself */
+   *ppvValue = STMemory_setValue(psMemory, *ppvValue, pvValue);
+}
+
+int STMerge_keep(const struct STMerge *psMerge,
+struct STMemory *psMemory, const char *pcKey, void **ppvValue,
+void **ppvOther)
+{
+   int iKeep;
+
+   assert(psMerge != NULL);
+   assert(psMerge->iOp != STMERGE_MERGE);
+   assert(ppvValue != NULL);
+
+   if (psMerge->iOp == STMERGE_INTERSECT) {
+      iKeep = (ppvOther != NULL);
+      if (iKeep) {
+         STMerge_resolve(psMerge, psMemory, pcKey, ppvValue,
+         *ppvOther);
+      }
+   }
+   else {
+      iKeep = (ppvOther == NULL || (psMerge->pfKeep != NULL
+      && (*psMerge->pfKeep)(pcKey, *ppvValue, *ppvOther,
+      psMerge->pvExtra)));
+   }
+
+   if (!iKeep && psMerge->pfFreeValue != NULL)
+      (*psMerge->pfFreeValue)(*ppvValue);
+   return iKeep;
+}
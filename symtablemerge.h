@@ -0,0 +1,58 @@
+/*--------------------------------------------------------------------*/
+/* symtablemerge.h                                                    */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEMERGE_INCLUDED
+#define SYMTABLEMERGE_INCLUDED
+
+#include "symtablememory.h"
+
+/* The operations an STMerge stands for */
+enum {STMERGE_MERGE, STMERGE_INTERSECT, STMERGE_DIFF};
+
+/* STMerge is one call to SymTable_merge, SymTable_intersect or
+SymTable_diff: the implementations walk the two tables in their own
+way and leave what happens to a binding found in both, or in only one
+of them, to STMerge_resolve and STMerge_keep */
+struct STMerge
+{
+   /* one of the STMERGE_* operations */
+   int iOp;
+   /* the callbacks of the operation, NULL if not given */
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra);
+   int (*pfKeep)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra);
+   void (*pfFreeValue)(void *pvValue);
+   /* the extra argument of the callbacks */
+   void *pvExtra;
+};
+
+/* Set up psMerge for the operation iOp with the given callbacks, any
+of which may be NULL, and their extra argument pvExtra */
+void STMerge_init(struct STMerge *psMerge, int iOp,
+void *(*pfResolve)(const char *pcKey, void *pvValue,
+void *pvOtherValue, void *pvExtra),
+int (*pfKeep)(const char *pcKey, void *pvValue,
+void *pvOtherValue, void *pvExtra),
+void (*pfFreeValue)(void *pvValue), const void *pvExtra);
+
+/* Set *ppvValue, the value of the binding with key pcKey in a table
+whose memory is psMemory, to what psMerge makes of it and the value
+pvOtherValue that pcKey has in the other table */
+void STMerge_resolve(const struct STMerge *psMerge,
+struct STMemory *psMemory, const char *pcKey, void **ppvValue,
+void *pvOtherValue);
+
+/* Return 1 if the binding with key pcKey and value *ppvValue stays in
+its table under the STMERGE_INTERSECT or STMERGE_DIFF psMerge, after
+resolving it for an intersection, or 0 if it is to be removed, after
+passing its value to the pfFreeValue of psMerge. ppvOther points to
+the value of pcKey in the other table, or is NULL if pcKey is not bound
+there */
+int STMerge_keep(const struct STMerge *psMerge,
+struct STMemory *psMemory, const char *pcKey, void **ppvValue,
+void **ppvOther);
+
+#endif
@@ -0,0 +1,813 @@
+/*--------------------------------------------------------------------*/
+/* symtableordered.c                                                  */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "symtablebatch.h"
+#include "symtablememory.h"
+#include "symtablereclaim.h"
+#include "symtablemerge.h"
+
+/* Number of index slots allocated by the first put, must be a power
+of 2 */
+enum {INITIAL_SLOTS = 8};
+
+/* Values of an index slot: EMPTY_SLOT ends a probe sequence,
+REMOVED_SLOT marks a binding that was removed and lets probing go on,
+and any other value is FIRST_ENTRY plus the position of an entry */
+enum {EMPTY_SLOT = 0, REMOVED_SLOT = 1, FIRST_ENTRY = 2};
+
+/* STEntry is one binding in the entry array of a SymTable, it is a
+hole left by a removed binding when pcKey is NULL */
+struct STEntry
+{
+   /* the full hash code of the key */
+   size_t uHash;
+   /* a pointer to the key of the binding */
+   char *pcKey;
+   /* a pointer to the value of the binding */
+   void *pvValue;
+};
+
+/* SymTable is the structure for a SymTable that keeps its bindings in
+insertion order in a dense entry array, found through a separate open
+addressing index of small integers. The index slots are 1, 2, 4 or 8
+bytes wide, whichever is enough to number the entries, so the index
+costs little more than a byte per binding in small tables. Removed
+bindings leave holes in the entry array, which are squeezed out when
+the entry array is full and is rebuilt */
+struct SymTable
+{
+   /* the number of bindings in the SymTable */
+   size_t size;
+   /* the number of index slots, 0 or a power of 2 */
+   size_t uSlots;
+   /* the width of an index slot in bytes */
+   size_t uWidth;
+   /* the index slots, NULL until the first put */
+   void *pvIndex;
+   /* the number of entries in use, holes included */
+   size_t uEntries;
+   /* the number of entries there is room for, 2/3 of uSlots */
+   size_t uCapacity;
+   /* the entry array */
+   struct STEntry *psEntries;
+   /* the SymTable of the enclosing scope, or NULL */
+   SymTable_T oParent;
+   /* the source of all memory of the SymTable */
+   struct STMemory sMemory;
+};
+
+/* Return uHash, the hash code of a key before mixing, which is also
+the hash code of its SymAtom, mixed so that its low bits can index a
+power of 2 sized index */
+static size_t SymTable_mix(size_t uHash)
+{
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+
+   return uHash;
+}
+
+/* Return a hash code for pcKey, mixed so that its low bits can index
+a power of 2 sized index */
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return SymTable_mix(uHash);
+}
+
+/* Return the width in bytes of index slots that can hold every value
+up to uLargest */
+static size_t SymTable_width(size_t uLargest)
+{
+   if (uLargest <= UINT8_MAX) return 1;
+   if (uLargest <= UINT16_MAX) return 2;
+   if (uLargest <= UINT32_MAX) return 4;
+   return 8;
+}
+
+/* Return the value of index slot uSlot of pvIndex, whose slots are
+uWidth bytes wide */
+static size_t SymTable_getSlot(const void *pvIndex, size_t uWidth,
+size_t uSlot)
+{
+   switch (uWidth) {
+      case 1: return ((const uint8_t*)pvIndex)[uSlot];
+      case 2: return ((const uint16_t*)pvIndex)[uSlot];
+      case 4: return ((const uint32_t*)pvIndex)[uSlot];
+      default: return (size_t)((const uint64_t*)pvIndex)[uSlot];
+   }
+}
+
+/* Set index slot uSlot of pvIndex, whose slots are uWidth bytes wide,
+to uValue */
+static void SymTable_setSlot(void *pvIndex, size_t uWidth,
+size_t uSlot, size_t uValue)
+{
+   switch (uWidth) {
+      case 1: ((uint8_t*)pvIndex)[uSlot] = (uint8_t)uValue; break;
+      case 2: ((uint16_t*)pvIndex)[uSlot] = (uint16_t)uValue; break;
+      case 4: ((uint32_t*)pvIndex)[uSlot] = (uint32_t)uValue; break;
+      default: ((uint64_t*)pvIndex)[uSlot] = (uint64_t)uValue; break;
+   }
+}
+
+/* Rebuild the index and entry array of oSymTable with uSlots index
+slots, a power of 2 large enough for all its bindings, keeping the
+bindings in order and squeezing out the holes. Returns 1 on success
+or 0 if there is not enough memory, in which case oSymTable is left
+unchanged */
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlots)
+{
+   struct STEntry *psEntries;
+   void *pvIndex;
+   size_t uCapacity, uWidth, uMask, uSlot, i, uEntries = 0;
+
+   assert(oSymTable != NULL);
+
+   uCapacity = uSlots / 3 * 2;
+   assert(uCapacity > oSymTable->size);
+   uWidth = SymTable_width(uCapacity - 1 + FIRST_ENTRY);
+
+   pvIndex = STMemory_alloc(&oSymTable->sMemory, uSlots * uWidth);
+   if (pvIndex == NULL) return 0;
+   psEntries = (struct STEntry*)STMemory_alloc(&oSymTable->sMemory,
+   uCapacity * sizeof(struct STEntry));
+   if (psEntries == NULL) {
+      STMemory_free(&oSymTable->sMemory, pvIndex, uSlots * uWidth);
+      return 0;
+   }
+   memset(pvIndex, 0, uSlots * uWidth);
+
+   /* no binding is removed from the new index, so each one takes the
+   first empty slot of its probe sequence */
+   uMask = uSlots - 1;
+   for (i = 0; i < oSymTable->uEntries; i++) {
+      if (oSymTable->psEntries[i].pcKey == NULL) continue;
+
+      psEntries[uEntries] = oSymTable->psEntries[i];
+      for (uSlot = psEntries[uEntries].uHash & uMask;
+      SymTable_getSlot(pvIndex, uWidth, uSlot) != EMPTY_SLOT;
+      uSlot = (uSlot + 1) & uMask) {
+      }
+      SymTable_setSlot(pvIndex, uWidth, uSlot, uEntries + FIRST_ENTRY);
+      uEntries++;
+   }
+
+   STMemory_free(&oSymTable->sMemory, oSymTable->pvIndex,
+   oSymTable->uSlots * oSymTable->uWidth);
+   STMemory_free(&oSymTable->sMemory, oSymTable->psEntries,
+   oSymTable->uCapacity * sizeof(struct STEntry));
+
+   oSymTable->pvIndex = pvIndex;
+   oSymTable->uSlots = uSlots;
+   oSymTable->uWidth = uWidth;
+   oSymTable->psEntries = psEntries;
+   oSymTable->uEntries = uEntries;
+   oSymTable->uCapacity = uCapacity;
+   return 1;
+}
+
+/* Return the index slot of oSymTable that refers to the binding with
+key pcKey, whose hash code is uHash, or oSymTable->uSlots if there is
+no such binding. If puFree is not NULL, store in it the slot where the
+binding would be inserted: the first slot of the probe sequence that
+is empty or marks a removed binding */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+size_t uHash, size_t *puFree)
+{
+   const struct STEntry *psEntry;
+   size_t uMask, uSlot, uValue;
+   int iFreeSeen = 0;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (oSymTable->uSlots == 0) return 0;
+
+   uMask = oSymTable->uSlots - 1;
+
+   for (uSlot = uHash & uMask; ; uSlot = (uSlot + 1) & uMask) {
+      uValue = SymTable_getSlot(oSymTable->pvIndex, oSymTable->uWidth,
+      uSlot);
+      if (uValue == EMPTY_SLOT) break;
+
+      if (uValue == REMOVED_SLOT) {
+         if (!iFreeSeen && puFree != NULL) *puFree = uSlot;
+         iFreeSeen = 1;
+         continue;
+      }
+
+      psEntry = &oSymTable->psEntries[uValue - FIRST_ENTRY];
+      /* interned keys that are equal are the same pointer */
+      if (psEntry->uHash == uHash && (psEntry->pcKey == pcKey
+      || !strcmp(psEntry->pcKey, pcKey)))
+         return uSlot;
+   }
+
+   if (!iFreeSeen && puFree != NULL) *puFree = uSlot;
+   return oSymTable->uSlots;
+}
+
+/* Return the entry of oSymTable that index slot uSlot refers to */
+static struct STEntry *SymTable_entry(SymTable_T oSymTable,
+size_t uSlot)
+{
+   assert(oSymTable != NULL);
+   assert(uSlot < oSymTable->uSlots);
+
+   return &oSymTable->psEntries[SymTable_getSlot(oSymTable->pvIndex,
+   oSymTable->uWidth, uSlot) - FIRST_ENTRY];
+}
+
+/* Find the binding with key pcKey, whose hash code is uHash, in
+oSymTable, appending a new binding with key pcKey and value pvValue if
+there is none. Sets *piInserted to 1 if a binding was inserted and to
+0 otherwise, returns a pointer to the value of the binding or NULL if
+there is not enough memory for a new one */
+static void **SymTable_lookupOrInsert(SymTable_T oSymTable,
+const char *pcKey, size_t uHash, const void *pvValue, int *piInserted) {
+   struct STEntry *psEntry;
+   size_t uSlot, uFree, uSlots;
+   char* keyCopy;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   uSlot = SymTable_find(oSymTable, pcKey, uHash, &uFree);
+   if (uSlot < oSymTable->uSlots) {
+      return &SymTable_entry(oSymTable, uSlot)->pvValue;
+   }
+
+   if (oSymTable->uEntries == oSymTable->uCapacity) {
+      /* leave room for as many new bindings as there are now, which
+      may mean the same size if the holes make room */
+      uSlots = INITIAL_SLOTS;
+      while (uSlots / 3 * 2 < 2 * (oSymTable->size + 1)) uSlots *= 2;
+      if (!SymTable_resize(oSymTable, uSlots)) return NULL;
+      (void)SymTable_find(oSymTable, pcKey, uHash, &uFree);
+   }
+
+   keyCopy = STMemory_copyString(&oSymTable->sMemory, pcKey);
+   if (keyCopy == NULL) return NULL;
+
+   psEntry = &oSymTable->psEntries[oSymTable->uEntries];
+   psEntry->uHash = uHash;
+   psEntry->pcKey = keyCopy;
+   psEntry->pvValue = STMemory_newValue(&oSymTable->sMemory, keyCopy,
+   pvValue);
+   SymTable_setSlot(oSymTable->pvIndex, oSymTable->uWidth, uFree,
+   oSymTable->uEntries + FIRST_ENTRY);
+   oSymTable->uEntries++;
+   oSymTable->size++;
+   *piInserted = 1;
+
+   return &psEntry->pvValue;
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   if (!STMemory_setValueSize(&oSymTable->sMemory, uValueSize)) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+
+   return oSymTable;
+}
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue)) {
+   assert(uMaxBindings > 0);
+
+   /* the entries have no room for the marks of a clock, and would grow
+   by a third for every SymTable to make some */
+   return NULL;
+}
+
+SymTable_T SymTable_newChild(SymTable_T oParent) {
+   SymTable_T oSymTable;
+
+   assert(oParent != NULL);
+
+   /* the child has no index or entries until its first put */
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   oSymTable->oParent = oParent;
+   return oSymTable;
+}
+
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags) {
+   SymTable_T oSymTable;
+   struct STMemory sMemory;
+
+   STMemory_init(&sMemory, psAllocator, iFlags);
+
+   oSymTable = (SymTable_T)STMemory_alloc(&sMemory,
+   sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      STMemory_releaseAll(&sMemory);
+      return NULL;
+   }
+
+   oSymTable->sMemory = sMemory;
+   oSymTable->size = 0;
+   oSymTable->uSlots = 0;
+   oSymTable->uWidth = 1;
+   oSymTable->pvIndex = NULL;
+   oSymTable->uEntries = 0;
+   oSymTable->uCapacity = 0;
+   oSymTable->psEntries = NULL;
+   oSymTable->oParent = NULL;
+
+   return oSymTable;
+}
+
+/* Free the keys of entries uStart up to uEnd of the SymTable
+pvTable, as the first part of freeing it */
+static void SymTable_freeEntries(void *pvTable, size_t uStart,
+size_t uEnd)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   size_t i;
+
+   for (i = uStart; i < uEnd; i++) {
+      STMemory_freeString(&oSymTable->sMemory,
+      oSymTable->psEntries[i].pcKey);
+   }
+}
+
+/* Free the SymTable pvTable once the keys of all of its entries are
+freed */
+static void SymTable_freeRest(void *pvTable)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+
+   (void)STMemory_setValueSize(&oSymTable->sMemory, 0);
+   STMemory_free(&oSymTable->sMemory, oSymTable->pvIndex,
+   oSymTable->uSlots * oSymTable->uWidth);
+   STMemory_free(&oSymTable->sMemory, oSymTable->psEntries,
+   oSymTable->uCapacity * sizeof(struct STEntry));
+   STMemory_free(&oSymTable->sMemory, oSymTable,
+   sizeof(struct SymTable));
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   struct STMemory sMemory;
+
+   assert(oSymTable != NULL);
+
+   if (oSymTable->sMemory.iArena) {
+      /* the SymTable lives in its own arena, so copy the arena out */
+      sMemory = oSymTable->sMemory;
+      STMemory_releaseAll(&sMemory);
+      return;
+   }
+
+   SymTable_freeEntries(oSymTable, 0, oSymTable->uEntries);
+   SymTable_freeRest(oSymTable);
+}
+
+void SymTable_freeAsync(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)
+   || !STReclaim_async(oSymTable, oSymTable->uEntries,
+   SymTable_freeEntries, SymTable_freeRest))
+      SymTable_free(oSymTable);
+}
+
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)) {
+      SymTable_free(oSymTable);
+      return;
+   }
+   STReclaim_parallel(oSymTable, oSymTable->uEntries,
+   SymTable_freeEntries, SymTable_freeRest, uThreads);
+}
+
+void SymTable_clear(SymTable_T oSymTable,
+void (*pfFreeValue)(void *pvValue)) {
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   /* the index and entry array are kept */
+   for (i = 0; i < oSymTable->uEntries; i++) {
+      if (oSymTable->psEntries[i].pcKey == NULL) continue;
+
+      if (pfFreeValue != NULL) {
+         (*pfFreeValue)(oSymTable->psEntries[i].pvValue);
+      }
+      STMemory_freeString(&oSymTable->sMemory,
+      oSymTable->psEntries[i].pcKey);
+   }
+
+   if (oSymTable->pvIndex != NULL) {
+      memset(oSymTable->pvIndex, 0,
+      oSymTable->uSlots * oSymTable->uWidth);
+   }
+   oSymTable->uEntries = 0;
+   oSymTable->size = 0;
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, pcKey, SymTable_hash(pcKey),
+   pvValue, &iInserted) == NULL) return 0;
+
+   return iInserted;
+}
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvOld) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (ppvOld != NULL) *ppvOld = NULL;
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey,
+   SymTable_hash(pcKey), pvValue, &iInserted);
+   if (ppvSlot == NULL) return -1;
+   if (iInserted) return 1;
+
+   if (ppvOld != NULL)
+      *ppvOld = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+   *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, pvValue);
+   return 0;
+}
+
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void ***pppvSlot) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(pppvSlot != NULL);
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey,
+   SymTable_hash(pcKey), pvValue, &iInserted);
+   *pppvSlot = ppvSlot;
+   if (ppvSlot == NULL) return -1;
+
+   return iInserted;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   struct STEntry *psEntry;
+   void *tempValue;
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   psEntry = SymTable_entry(oSymTable, uSlot);
+   tempValue = STMemory_saveValue(&oSymTable->sMemory,
+   psEntry->pvValue);
+   psEntry->pvValue = STMemory_setValue(&oSymTable->sMemory,
+   psEntry->pvValue, pvValue);
+   return tempValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL)
+   < oSymTable->uSlots;
+}
+
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey) {
+   size_t uHash, uSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uHash = SymTable_hash(pcKey);
+   for (; oSymTable != NULL; oSymTable = oSymTable->oParent) {
+      uSlot = SymTable_find(oSymTable, pcKey, uHash, NULL);
+      if (uSlot < oSymTable->uSlots)
+         return SymTable_entry(oSymTable, uSlot)->pvValue;
+   }
+
+   return NULL;
+}
+
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, SymAtom_string(oAtom), 
+   SymTable_mix(SymAtom_hash(oAtom)), pvValue, &iInserted) == NULL) 
+      return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom) {
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   uSlot = SymTable_find(oSymTable, SymAtom_string(oAtom), 
+   SymTable_mix(SymAtom_hash(oAtom)), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   return SymTable_entry(oSymTable, uSlot)->pvValue;
+}
+
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash), pvValue, &iInserted) == NULL) 
+      return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey) {
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   uSlot = SymTable_find(oSymTable, sKey.pcKey,
+   SymTable_mix(sKey.uHash), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   return SymTable_entry(oSymTable, uSlot)->pvValue;
+}
+
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey) {
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_find(oSymTable, sKey.pcKey,
+   SymTable_mix(sKey.uHash), NULL) < oSymTable->uSlots;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   return SymTable_entry(oSymTable, uSlot)->pvValue;
+}
+
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder) {
+   assert(oSymTable != NULL);
+
+   /* bindings keep their insertion order */
+   return iReorder == SYMTABLE_REORDER_NONE;
+}
+
+void SymTable_optimize(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+}
+
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable) {
+   assert(oSymTable != NULL);
+
+   /* the stored hash codes already keep lookups of absent keys away
+   from the keys */
+   return iEnable == 0;
+}
+
+/* Remove the binding that index slot uSlot of oSymTable refers to
+and return its value */
+static void *SymTable_removeAt(SymTable_T oSymTable, size_t uSlot)
+{
+   struct STEntry *psEntry;
+   void *pvValue;
+
+   assert(oSymTable != NULL);
+
+   psEntry = SymTable_entry(oSymTable, uSlot);
+   pvValue = STMemory_saveValue(&oSymTable->sMemory, psEntry->pvValue);
+   STMemory_freeString(&oSymTable->sMemory, psEntry->pcKey);
+   psEntry->pcKey = NULL;
+   oSymTable->size--;
+
+   /* probes for other keys may pass through this slot */
+   SymTable_setSlot(oSymTable->pvIndex, oSymTable->uWidth, uSlot,
+   REMOVED_SLOT);
+
+   return pvValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   return SymTable_removeAt(oSymTable, uSlot);
+}
+
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey) {
+   size_t uSlot;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   uSlot = SymTable_find(oSymTable, sKey.pcKey,
+   SymTable_mix(sKey.uHash), NULL);
+   if (uSlot == oSymTable->uSlots) return NULL;
+
+   return SymTable_removeAt(oSymTable, uSlot);
+}
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+      size_t i;
+
+      assert(oSymTable != NULL);
+      assert(pfApply != NULL);
+
+      /* bindings are visited in the order they were put */
+      for (i = 0; i < oSymTable->uEntries; i++) {
+         if (oSymTable->psEntries[i].pcKey != NULL) {
+            (*pfApply)(oSymTable->psEntries[i].pcKey,
+            oSymTable->psEntries[i].pvValue,
+            (void*)pvExtra);
+         }
+      }
+   }
+
+void SymTable_mapBatch(SymTable_T oSymTable,
+   void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra),
+   const void *pvExtra, size_t uBatchSize) {
+   struct STBatch sBatch;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApplyBatch != NULL);
+
+   STBatch_init(&sBatch, pfApplyBatch, pvExtra, uBatchSize,
+   &oSymTable->sMemory);
+
+   /* batches follow the order the bindings were put in */
+   for (i = 0; i < oSymTable->uEntries; i++) {
+      if (oSymTable->psEntries[i].pcKey != NULL) {
+         STBatch_add(&sBatch, oSymTable->psEntries[i].pcKey,
+         oSymTable->psEntries[i].pvValue);
+      }
+   }
+
+   STBatch_finish(&sBatch);
+}
+
+/* Remove the bindings of oSymTable that the STMERGE_INTERSECT or
+STMERGE_DIFF psMerge does not keep, given the bindings of oOther. The
+stored hash codes serve for the lookups in both tables */
+static void SymTable_reduce(SymTable_T oSymTable, SymTable_T oOther,
+const struct STMerge *psMerge)
+{
+   struct STEntry *psEntry;
+   size_t i, uOther;
+
+   /* a removal leaves a hole, so the entries stay where they are */
+   for (i = 0; i < oSymTable->uEntries; i++) {
+      psEntry = &oSymTable->psEntries[i];
+      if (psEntry->pcKey == NULL) continue;
+
+      uOther = SymTable_find(oOther, psEntry->pcKey, psEntry->uHash,
+      NULL);
+      if (!STMerge_keep(psMerge, &oSymTable->sMemory, psEntry->pcKey,
+      &psEntry->pvValue, (uOther == oOther->uSlots) ? NULL :
+      &SymTable_entry(oOther, uOther)->pvValue)) {
+         (void)SymTable_removeAt(oSymTable, SymTable_find(oSymTable,
+         psEntry->pcKey, psEntry->uHash, NULL));
+      }
+   }
+}
+
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   const void *pvExtra) {
+   struct STMerge sMerge;
+   struct STEntry *psOther;
+   void **ppvSlot;
+   size_t i;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_MERGE, pfResolve, NULL, NULL,
+   pvExtra);
+
+   /* new keys are appended in the order of oOther, and keep the hash
+   codes stored there */
+   for (i = 0; i < oOther->uEntries; i++) {
+      psOther = &oOther->psEntries[i];
+      if (psOther->pcKey == NULL) continue;
+
+      ppvSlot = SymTable_lookupOrInsert(oSymTable, psOther->pcKey,
+      psOther->uHash, psOther->pvValue, &iInserted);
+      if (ppvSlot == NULL) return 0;
+      if (!iInserted) {
+         STMerge_resolve(&sMerge, &oSymTable->sMemory, psOther->pcKey,
+         ppvSlot, psOther->pvValue);
+      }
+   }
+
+   return 1;
+}
+
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_INTERSECT, pfResolve, NULL,
+   pfFreeValue, pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
+
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+   int (*pfKeep)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_DIFF, NULL, pfKeep, pfFreeValue,
+   pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
@@ -0,0 +1,142 @@
+/*--------------------------------------------------------------------*/
+/* symtablereclaim.c                                                  */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "symtablereclaim.h"
+
+/* The most threads STReclaim_parallel uses */
+enum {MAX_THREADS = 64};
+
+/* STReclaimJob is a range of pieces of a table to free, and for a
+background thread also what to do after it */
+struct STReclaimJob
+{
+   /* the table */
+   void *pvTable;
+   /* the first piece and one past the last piece of the range */
+   size_t uStart;
+   size_t uEnd;
+   /* frees a range of pieces of the table */
+   void (*pfFreeRange)(void *pvTable, size_t uStart, size_t uEnd);
+   /* frees the rest of the table, NULL for a range of
+   STReclaim_parallel */
+   void (*pfFinish)(void *pvTable);
+};
+
+/* Free the range of the STReclaimJob pvJob in chunks, then the rest
+of its table, and free the job, on a background thread */
+static void *STReclaim_runAsync(void *pvJob)
+{
+   struct STReclaimJob *psJob = (struct STReclaimJob*)pvJob;
+   size_t uStart;
+   size_t uEnd;
+
+   for (uStart = psJob->uStart; uStart < psJob->uEnd; uStart = uEnd) {
+      uEnd = psJob->uEnd - uStart > STRECLAIM_CHUNK ?
+      uStart + STRECLAIM_CHUNK : psJob->uEnd;
+      (*psJob->pfFreeRange)(psJob->pvTable, uStart, uEnd);
+      /* let the threads serving requests run between chunks */
+      sched_yield();
+   }
+   (*psJob->pfFinish)(psJob->pvTable);
+
+   free(psJob);
+   return NULL;
+}
+
+/* Free the range of the STReclaimJob pvJob */
+static void *STReclaim_runRange(void *pvJob)
+{
+   struct STReclaimJob *psJob = (struct STReclaimJob*)pvJob;
+
+   (*psJob->pfFreeRange)(psJob->pvTable, psJob->uStart, psJob->uEnd);
+   return NULL;
+}
+
+int STReclaim_async(void *pvTable, size_t uCount,
+void (*pfFreeRange)(void *pvTable, size_t uStart, size_t uEnd),
+void (*pfFinish)(void *pvTable))
+{
+   struct STReclaimJob *psJob;
+   pthread_attr_t sAttr;
+   pthread_t iThread;
+   int iStarted;
+
+   assert(pvTable != NULL);
+   assert(pfFreeRange != NULL);
+   assert(pfFinish != NULL);
+
+   if (uCount <= STRECLAIM_CHUNK) return 0;
+
+   psJob = (struct STReclaimJob*)malloc(sizeof(struct STReclaimJob));
+   if (psJob == NULL) return 0;
+   psJob->pvTable = pvTable;
+   psJob->uStart = 0;
+   psJob->uEnd = uCount;
+   psJob->pfFreeRange = pfFreeRange;
+   psJob->pfFinish = pfFinish;
+
+   if (pthread_attr_init(&sAttr) != 0) {
+      free(psJob);
+      return 0;
+   }
+   iStarted = pthread_attr_setdetachstate(&sAttr,
+   PTHREAD_CREATE_DETACHED) == 0
+   && pthread_create(&iThread, &sAttr, STReclaim_runAsync, psJob) == 0;
+   pthread_attr_destroy(&sAttr);
+
+   if (!iStarted) free(psJob);
+   return iStarted;
+}
+
+void STReclaim_parallel(void *pvTable, size_t uCount,
+void (*pfFreeRange)(void *pvTable, size_t uStart, size_t uEnd),
+void (*pfFinish)(void *pvTable), size_t uThreads)
+{
+   struct STReclaimJob asJobs[MAX_THREADS];
+   pthread_t aiThreads[MAX_THREADS];
+   int aiStarted[MAX_THREADS];
+   long lProcessors;
+   size_t u;
+
+   assert(pvTable != NULL);
+   assert(pfFreeRange != NULL);
+   assert(pfFinish != NULL);
+
+   if (uThreads == 0) {
+      lProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+      uThreads = lProcessors > 0 ? (size_t)lProcessors : 1;
+   }
+   if (uThreads > MAX_THREADS) uThreads = MAX_THREADS;
+   if (uThreads > uCount / STRECLAIM_CHUNK)
+      uThreads = uCount / STRECLAIM_CHUNK;
+   if (uThreads == 0) uThreads = 1;
+
+   for (u = 0; u < uThreads; u++) {
+      asJobs[u].pvTable = pvTable;
+      asJobs[u].uStart = uCount / uThreads * u;
+      asJobs[u].uEnd = u + 1 == uThreads ?
+      uCount : uCount / uThreads * (u + 1);
+      asJobs[u].pfFreeRange = pfFreeRange;
+      asJobs[u].pfFinish = NULL;
+      aiStarted[u] = u > 0 && pthread_create(&aiThreads[u], NULL,
+      STReclaim_runRange, &asJobs[u]) == 0;
+   }
+
+   for (u = 0; u < uThreads; u++) {
+      if (!aiStarted[u]) STReclaim_runRange(&asJobs[u]);
+   }
+   for (u = 0; u < uThreads; u++) {
+      if (aiStarted[u]) pthread_join(aiThreads[u], NULL);
+   }
+
+   (*pfFinish)(pvTable);
+}
@@ -0,0 +1,34 @@
+/*--------------------------------------------------------------------*/
+/* symtablereclaim.h                                                  */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLERECLAIM_INCLUDED
+#define SYMTABLERECLAIM_INCLUDED
+
+#include <stddef.h>
+
+/* Number of pieces of a table freed in one go, tables with no more
+pieces are not worth a thread */
+enum {STRECLAIM_CHUNK = 4096};
+
+/* Free the table pvTable, made of uCount pieces such as buckets or
+slots, on a new detached thread: pfFreeRange is called on consecutive
+ranges of at most STRECLAIM_CHUNK pieces, yielding the processor in
+between, and then pfFinish frees what is left. Returns 1 if the
+thread was started, or 0 without calling anything if uCount is not
+above STRECLAIM_CHUNK or the thread cannot be started */
+int STReclaim_async(void *pvTable, size_t uCount,
+void (*pfFreeRange)(void *pvTable, size_t uStart, size_t uEnd),
+void (*pfFinish)(void *pvTable));
+
+/* Free the table pvTable, made of uCount pieces, by calling
+pfFreeRange on uThreads ranges of the pieces at once, or on one range
+per processor if uThreads is 0, and then pfFinish. The calling thread
+takes the first range and any range whose thread cannot be started,
+and no range is smaller than STRECLAIM_CHUNK pieces */
+void STReclaim_parallel(void *pvTable, size_t uCount,
+void (*pfFreeRange)(void *pvTable, size_t uStart, size_t uEnd),
+void (*pfFinish)(void *pvTable), size_t uThreads);
+
+#endif
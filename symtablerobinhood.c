@@ -0,0 +1,781 @@
+/*--------------------------------------------------------------------*/
+/* symtablerobinhood.c                                                */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtable.h"
+#include "symtablebatch.h"
+#include "symtablememory.h"
+#include "symtablereclaim.h"
+#include "symtablemerge.h"
+
+/* Number of slots allocated by the first put, must be a power of 2 */
+enum {INITIAL_SLOTS = 8};
+
+/* The slot array grows once more than MAX_LOAD_NUMERATOR /
+MAX_LOAD_DENOMINATOR of it would be in use */
+enum {MAX_LOAD_NUMERATOR = 9, MAX_LOAD_DENOMINATOR = 10};
+
+/* STSlot is one entry of the open addressing slot array of a SymTable,
+it is empty when pcKey is NULL */
+struct STSlot
+{
+   /* the full hash code of the key */
+   size_t uHash;
+   /* a pointer to the key of the binding */
+   char *pcKey;
+   /* a pointer to the value of the binding */
+   void *pvValue;
+};
+
+/* SymTable is the structure for a SymTable that contains its size and
+a flat array of slots managed with Robin Hood linear probing: a binding
+never sits further from its home slot than the binding it displaced,
+so a lookup can stop as soon as it passes a binding that is closer to
+home than the key it looks for would be */
+struct SymTable
+{
+   /* the number of bindings in the SymTable */
+   size_t size;
+   /* the number of slots, 0 or a power of 2 */
+   size_t uSlots;
+   /* the slot array, NULL until the first put */
+   struct STSlot *psSlots;
+   /* the SymTable of the enclosing scope, or NULL */
+   SymTable_T oParent;
+   /* the source of all memory of the SymTable */
+   struct STMemory sMemory;
+};
+
+/* Return uHash, the hash code of a key before mixing, which is also
+the hash code of its SymAtom, mixed so that its low bits can index a
+power of 2 sized slot array */
+static size_t SymTable_mix(size_t uHash)
+{
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+
+   return uHash;
+}
+
+/* Return a hash code for pcKey, mixed so that its low bits can index
+a power of 2 sized slot array */
+static size_t SymTable_hash(const char *pcKey)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return SymTable_mix(uHash);
+}
+
+/* Return how far slot uIndex of oSymTable, which must hold a binding,
+is from the home slot of that binding */
+static size_t SymTable_distance(SymTable_T oSymTable, size_t uIndex)
+{
+   assert(oSymTable != NULL);
+   assert(oSymTable->psSlots[uIndex].pcKey != NULL);
+
+   return (uIndex - oSymTable->psSlots[uIndex].uHash)
+   & (oSymTable->uSlots - 1);
+}
+
+/* Place sSlot, whose key is not in oSymTable, into the slot array of
+oSymTable, displacing bindings that are closer to their home slot.
+There must be a free slot. Returns the index where sSlot itself ended
+up */
+static size_t SymTable_place(SymTable_T oSymTable, struct STSlot sSlot)
+{
+   struct STSlot sTemp;
+   size_t uMask, uIndex, uDistance, uResident, uResult;
+   int iPlaced = 0;
+
+   assert(oSymTable != NULL);
+   assert(oSymTable->size < oSymTable->uSlots);
+
+   uMask = oSymTable->uSlots - 1;
+   uIndex = sSlot.uHash & uMask;
+   uResult = uIndex;
+
+   for (uDistance = 0; ; uDistance++, uIndex = (uIndex + 1) & uMask) {
+      if (oSymTable->psSlots[uIndex].pcKey == NULL) {
+         oSymTable->psSlots[uIndex] = sSlot;
+         return iPlaced ? uResult : uIndex;
+      }
+
+      uResident = SymTable_distance(oSymTable, uIndex);
+      if (uResident < uDistance) {
+         /* the resident binding is richer, so it gives up its slot and
+         goes on probing from its own distance */
+         sTemp = oSymTable->psSlots[uIndex];
+         oSymTable->psSlots[uIndex] = sSlot;
+         sSlot = sTemp;
+         uDistance = uResident;
+         if (!iPlaced) {
+            uResult = uIndex;
+            iPlaced = 1;
+         }
+      }
+   }
+}
+
+/* Grow the slot array of oSymTable to uSlots slots, a power of 2 large
+enough for all its bindings, and place every binding again. Returns 1
+on success or 0 if there is not enough memory, in which case oSymTable
+is left unchanged */
+static int SymTable_resize(SymTable_T oSymTable, size_t uSlots)
+{
+   struct STSlot *psOldSlots;
+   size_t i, uOldSlots;
+
+   assert(oSymTable != NULL);
+   assert(uSlots > oSymTable->size);
+
+   psOldSlots = oSymTable->psSlots;
+   uOldSlots = oSymTable->uSlots;
+
+   oSymTable->psSlots = (struct STSlot*)STMemory_alloc(
+   &oSymTable->sMemory, uSlots * sizeof(struct STSlot));
+   if (oSymTable->psSlots == NULL) {
+      oSymTable->psSlots = psOldSlots;
+      return 0;
+   }
+   memset(oSymTable->psSlots, 0, uSlots * sizeof(struct STSlot));
+   oSymTable->uSlots = uSlots;
+
+   for (i = 0; i < uOldSlots; i++) {
+      if (psOldSlots[i].pcKey != NULL) {
+         (void)SymTable_place(oSymTable, psOldSlots[i]);
+      }
+   }
+
+   STMemory_free(&oSymTable->sMemory, psOldSlots,
+   uOldSlots * sizeof(struct STSlot));
+   return 1;
+}
+
+/* Return the index of the slot holding the binding with key pcKey,
+whose hash code is uHash, in oSymTable, or oSymTable->uSlots if there
+is no such binding */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+size_t uHash)
+{
+   size_t uMask, uIndex, uDistance;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (oSymTable->size == 0) return oSymTable->uSlots;
+
+   uMask = oSymTable->uSlots - 1;
+   uIndex = uHash & uMask;
+
+   for (uDistance = 0; ; uDistance++, uIndex = (uIndex + 1) & uMask) {
+      if (oSymTable->psSlots[uIndex].pcKey == NULL) break;
+      /* pcKey would have displaced this binding, so it is absent */
+      if (SymTable_distance(oSymTable, uIndex) < uDistance) break;
+      /* interned keys that are equal are the same pointer */
+      if (oSymTable->psSlots[uIndex].uHash == uHash
+      && (oSymTable->psSlots[uIndex].pcKey == pcKey
+      || !strcmp(oSymTable->psSlots[uIndex].pcKey, pcKey))) {
+         return uIndex;
+      }
+   }
+
+   return oSymTable->uSlots;
+}
+
+/* Find the binding with key pcKey, whose hash code is uHash, in
+oSymTable, inserting a new binding with key pcKey and value pvValue if
+there is none. Sets *piInserted to 1 if a binding was inserted and to
+0 otherwise, returns a pointer to the value of the binding or NULL if
+there is not enough memory for a new one */
+static void **SymTable_lookupOrInsert(SymTable_T oSymTable,
+const char *pcKey, size_t uHash, const void *pvValue, int *piInserted) {
+   struct STSlot sSlot;
+   size_t uIndex;
+   char* keyCopy;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   uIndex = SymTable_find(oSymTable, pcKey, uHash);
+   if (uIndex < oSymTable->uSlots) {
+      return &oSymTable->psSlots[uIndex].pvValue;
+   }
+
+   if ((oSymTable->size + 1) * MAX_LOAD_DENOMINATOR >
+   oSymTable->uSlots * MAX_LOAD_NUMERATOR) {
+      if (!SymTable_resize(oSymTable, oSymTable->uSlots == 0 ?
+      INITIAL_SLOTS : oSymTable->uSlots * 2)) return NULL;
+   }
+
+   keyCopy = STMemory_copyString(&oSymTable->sMemory, pcKey);
+   if (keyCopy == NULL) return NULL;
+
+   sSlot.uHash = uHash;
+   sSlot.pcKey = keyCopy;
+   sSlot.pvValue = STMemory_newValue(&oSymTable->sMemory, keyCopy,
+   pvValue);
+
+   uIndex = SymTable_place(oSymTable, sSlot);
+   oSymTable->size++;
+   *piInserted = 1;
+
+   return &oSymTable->psSlots[uIndex].pvValue;
+}
+
+SymTable_T SymTable_new(void) {
+   return SymTable_newWithAllocator(NULL, 0);
+}
+
+SymTable_T SymTable_newSized(size_t uValueSize) {
+   SymTable_T oSymTable;
+
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   if (!STMemory_setValueSize(&oSymTable->sMemory, uValueSize)) {
+      SymTable_free(oSymTable);
+      return NULL;
+   }
+
+   return oSymTable;
+}
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+void (*pfEvict)(const char *pcKey, void *pvValue)) {
+   assert(uMaxBindings > 0);
+
+   /* the slots have no room for the marks of a clock, and would grow
+   by a third for every SymTable to make some */
+   return NULL;
+}
+
+SymTable_T SymTable_newChild(SymTable_T oParent) {
+   SymTable_T oSymTable;
+
+   assert(oParent != NULL);
+
+   /* the child has no slots until its first put */
+   oSymTable = SymTable_newWithAllocator(NULL, 0);
+   if (oSymTable == NULL) return NULL;
+
+   oSymTable->oParent = oParent;
+   return oSymTable;
+}
+
+SymTable_T SymTable_newWithAllocator(
+const struct SymTable_Allocator *psAllocator, int iFlags) {
+   SymTable_T oSymTable;
+   struct STMemory sMemory;
+
+   STMemory_init(&sMemory, psAllocator, iFlags);
+
+   oSymTable = (SymTable_T)STMemory_alloc(&sMemory,
+   sizeof(struct SymTable));
+   if (oSymTable == NULL) {
+      STMemory_releaseAll(&sMemory);
+      return NULL;
+   }
+
+   oSymTable->sMemory = sMemory;
+   oSymTable->size = 0;
+   oSymTable->uSlots = 0;
+   oSymTable->psSlots = NULL;
+   oSymTable->oParent = NULL;
+
+   return oSymTable;
+}
+
+/* Free the keys in slots uStart up to uEnd of the SymTable pvTable,
+as the first part of freeing it */
+static void SymTable_freeSlots(void *pvTable, size_t uStart,
+size_t uEnd)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+   size_t i;
+
+   for (i = uStart; i < uEnd; i++) {
+      STMemory_freeString(&oSymTable->sMemory,
+      oSymTable->psSlots[i].pcKey);
+   }
+}
+
+/* Free the SymTable pvTable once the keys in all of its slots are
+freed */
+static void SymTable_freeRest(void *pvTable)
+{
+   SymTable_T oSymTable = (SymTable_T)pvTable;
+
+   (void)STMemory_setValueSize(&oSymTable->sMemory, 0);
+   STMemory_free(&oSymTable->sMemory, oSymTable->psSlots,
+   oSymTable->uSlots * sizeof(struct STSlot));
+   STMemory_free(&oSymTable->sMemory, oSymTable,
+   sizeof(struct SymTable));
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+   struct STMemory sMemory;
+
+   assert(oSymTable != NULL);
+
+   if (oSymTable->sMemory.iArena) {
+      /* the SymTable lives in its own arena, so copy the arena out */
+      sMemory = oSymTable->sMemory;
+      STMemory_releaseAll(&sMemory);
+      return;
+   }
+
+   SymTable_freeSlots(oSymTable, 0, oSymTable->uSlots);
+   SymTable_freeRest(oSymTable);
+}
+
+void SymTable_freeAsync(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)
+   || !STReclaim_async(oSymTable, oSymTable->uSlots,
+   SymTable_freeSlots, SymTable_freeRest))
+      SymTable_free(oSymTable);
+}
+
+void SymTable_freeParallel(SymTable_T oSymTable, size_t uThreads) {
+   assert(oSymTable != NULL);
+
+   if (!STMemory_isConcurrent(&oSymTable->sMemory)) {
+      SymTable_free(oSymTable);
+      return;
+   }
+   STReclaim_parallel(oSymTable, oSymTable->uSlots,
+   SymTable_freeSlots, SymTable_freeRest, uThreads);
+}
+
+void SymTable_clear(SymTable_T oSymTable,
+void (*pfFreeValue)(void *pvValue)) {
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   /* only the slots in use are written to, the slot array is kept */
+   for (i = 0; i < oSymTable->uSlots && oSymTable->size > 0; i++) {
+      if (oSymTable->psSlots[i].pcKey == NULL) continue;
+
+      if (pfFreeValue != NULL) {
+         (*pfFreeValue)(oSymTable->psSlots[i].pvValue);
+      }
+      STMemory_freeString(&oSymTable->sMemory,
+      oSymTable->psSlots[i].pcKey);
+      oSymTable->psSlots[i].pcKey = NULL;
+      oSymTable->size--;
+   }
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+   return oSymTable->size;
+}
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, pcKey, SymTable_hash(pcKey),
+   pvValue, &iInserted) == NULL) return 0;
+
+   return iInserted;
+}
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void **ppvOld) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   if (ppvOld != NULL) *ppvOld = NULL;
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey,
+   SymTable_hash(pcKey), pvValue, &iInserted);
+   if (ppvSlot == NULL) return -1;
+   if (iInserted) return 1;
+
+   if (ppvOld != NULL) 
+      *ppvOld = STMemory_saveValue(&oSymTable->sMemory, *ppvSlot);
+   *ppvSlot = STMemory_setValue(&oSymTable->sMemory, *ppvSlot, pvValue);
+   return 0;
+}
+
+int SymTable_getOrPut(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue, void ***pppvSlot) {
+   void **ppvSlot;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(pppvSlot != NULL);
+
+   ppvSlot = SymTable_lookupOrInsert(oSymTable, pcKey,
+   SymTable_hash(pcKey), pvValue, &iInserted);
+   *pppvSlot = ppvSlot;
+   if (ppvSlot == NULL) return -1;
+
+   return iInserted;
+}
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+const void *pvValue) {
+   void *tempValue;
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   tempValue = STMemory_saveValue(&oSymTable->sMemory,
+   oSymTable->psSlots[uIndex].pvValue);
+   oSymTable->psSlots[uIndex].pvValue = STMemory_setValue(
+   &oSymTable->sMemory, oSymTable->psSlots[uIndex].pvValue, pvValue);
+   return tempValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey))
+   < oSymTable->uSlots;
+}
+
+void *SymTable_lookupScoped(SymTable_T oSymTable, const char *pcKey) {
+   size_t uHash, uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uHash = SymTable_hash(pcKey);
+   for (; oSymTable != NULL; oSymTable = oSymTable->oParent) {
+      uIndex = SymTable_find(oSymTable, pcKey, uHash);
+      if (uIndex < oSymTable->uSlots)
+         return oSymTable->psSlots[uIndex].pvValue;
+   }
+
+   return NULL;
+}
+
+int SymTable_putAtom(SymTable_T oSymTable, SymAtom_T oAtom, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, SymAtom_string(oAtom), 
+   SymTable_mix(SymAtom_hash(oAtom)), pvValue, &iInserted) == NULL) 
+      return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getAtom(SymTable_T oSymTable, SymAtom_T oAtom) {
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(oAtom != NULL);
+
+   uIndex = SymTable_find(oSymTable, SymAtom_string(oAtom), 
+   SymTable_mix(SymAtom_hash(oAtom)));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   return oSymTable->psSlots[uIndex].pvValue;
+}
+
+int SymTable_putK(SymTable_T oSymTable, SymKey_T sKey, 
+const void *pvValue) {
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   if (SymTable_lookupOrInsert(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash), pvValue, &iInserted) == NULL) 
+      return 0;
+
+   return iInserted;
+}
+
+void *SymTable_getK(SymTable_T oSymTable, SymKey_T sKey) {
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   return oSymTable->psSlots[uIndex].pvValue;
+}
+
+int SymTable_containsK(SymTable_T oSymTable, SymKey_T sKey) {
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   return SymTable_find(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash)) < oSymTable->uSlots;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   return oSymTable->psSlots[uIndex].pvValue;
+}
+
+int SymTable_setReorder(SymTable_T oSymTable, int iReorder) {
+   assert(oSymTable != NULL);
+
+   /* bindings cannot leave the position Robin Hood probing gives
+   them */
+   return iReorder == SYMTABLE_REORDER_NONE;
+}
+
+void SymTable_optimize(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+}
+
+int SymTable_setFilter(SymTable_T oSymTable, int iEnable) {
+   assert(oSymTable != NULL);
+
+   /* the stored hash codes already keep lookups of absent keys away
+   from the keys */
+   return iEnable == 0;
+}
+
+/* Remove the binding in slot uIndex of oSymTable and return its
+value */
+static void *SymTable_removeAt(SymTable_T oSymTable, size_t uIndex)
+{
+   void *pvValue;
+   size_t uMask, uNext;
+
+   assert(oSymTable != NULL);
+   assert(oSymTable->psSlots[uIndex].pcKey != NULL);
+
+   pvValue = STMemory_saveValue(&oSymTable->sMemory,
+   oSymTable->psSlots[uIndex].pvValue);
+   STMemory_freeString(&oSymTable->sMemory,
+   oSymTable->psSlots[uIndex].pcKey);
+   oSymTable->size--;
+
+   /* shift the following bindings of the cluster back by one slot
+   until one is already home, so that no tombstone is needed */
+   uMask = oSymTable->uSlots - 1;
+   for (uNext = (uIndex + 1) & uMask;
+   oSymTable->psSlots[uNext].pcKey != NULL
+   && SymTable_distance(oSymTable, uNext) > 0;
+   uNext = (uNext + 1) & uMask) {
+      oSymTable->psSlots[uIndex] = oSymTable->psSlots[uNext];
+      uIndex = uNext;
+   }
+   oSymTable->psSlots[uIndex].pcKey = NULL;
+
+   return pvValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   return SymTable_removeAt(oSymTable, uIndex);
+}
+
+void *SymTable_removeK(SymTable_T oSymTable, SymKey_T sKey) {
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, sKey.pcKey, 
+   SymTable_mix(sKey.uHash));
+   if (uIndex == oSymTable->uSlots) return NULL;
+
+   return SymTable_removeAt(oSymTable, uIndex);
+}
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+      size_t i;
+
+      assert(oSymTable != NULL);
+      assert(pfApply != NULL);
+
+      for (i = 0; i < oSymTable->uSlots; i++) {
+         if (oSymTable->psSlots[i].pcKey != NULL) {
+            (*pfApply)(oSymTable->psSlots[i].pcKey,
+            oSymTable->psSlots[i].pvValue,
+            (void*)pvExtra);
+         }
+      }
+   }
+
+void SymTable_mapBatch(SymTable_T oSymTable,
+   void (*pfApplyBatch)(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra),
+   const void *pvExtra, size_t uBatchSize) {
+   struct STBatch sBatch;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApplyBatch != NULL);
+
+   STBatch_init(&sBatch, pfApplyBatch, pvExtra, uBatchSize,
+   &oSymTable->sMemory);
+
+   for (i = 0; i < oSymTable->uSlots; i++) {
+      if (oSymTable->psSlots[i].pcKey != NULL) {
+         STBatch_add(&sBatch, oSymTable->psSlots[i].pcKey,
+         oSymTable->psSlots[i].pvValue);
+      }
+   }
+
+   STBatch_finish(&sBatch);
+}
+
+/* Remove the bindings of oSymTable that the STMERGE_INTERSECT or
+STMERGE_DIFF psMerge does not keep, given the bindings of oOther. The
+stored hash codes serve for the lookups in oOther */
+static void SymTable_reduce(SymTable_T oSymTable, SymTable_T oOther,
+const struct STMerge *psMerge)
+{
+   struct STSlot *psSlot;
+   size_t uMask, uStart, uCount, uIndex, uOther;
+
+   if (oSymTable->size == 0) return;
+
+   /* a cluster never reaches past an empty slot, so starting after
+   one, the bindings that removals shift back were not visited yet */
+   for (uStart = 0; oSymTable->psSlots[uStart].pcKey != NULL; uStart++)
+      ;
+   uMask = oSymTable->uSlots - 1;
+
+   for (uCount = 1; uCount < oSymTable->uSlots; ) {
+      uIndex = (uStart + uCount) & uMask;
+      psSlot = &oSymTable->psSlots[uIndex];
+      if (psSlot->pcKey == NULL) {
+         uCount++;
+         continue;
+      }
+
+      uOther = SymTable_find(oOther, psSlot->pcKey, psSlot->uHash);
+      if (STMerge_keep(psMerge, &oSymTable->sMemory, psSlot->pcKey,
+      &psSlot->pvValue, (uOther == oOther->uSlots) ? NULL :
+      &oOther->psSlots[uOther].pvValue)) uCount++;
+      /* the next binding may have shifted into uIndex */
+      else (void)SymTable_removeAt(oSymTable, uIndex);
+   }
+}
+
+int SymTable_merge(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   const void *pvExtra) {
+   struct STMerge sMerge;
+   struct STSlot *psOther;
+   void **ppvSlot;
+   size_t i, uSlots;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_MERGE, pfResolve, NULL, NULL,
+   pvExtra);
+
+   /* the union holds at least as many bindings as oOther, make room
+   for them at once, or later one by one if there is not enough
+   memory */
+   uSlots = (oSymTable->uSlots == 0) ? INITIAL_SLOTS : 
+   oSymTable->uSlots;
+   while (oOther->size * MAX_LOAD_DENOMINATOR > 
+   uSlots * MAX_LOAD_NUMERATOR) uSlots *= 2;
+   if (uSlots > oSymTable->uSlots) 
+      (void)SymTable_resize(oSymTable, uSlots);
+
+   /* the stored hash codes are the same in both tables, and with as
+   many slots the lookups in oSymTable follow the walk of oOther */
+   for (i = 0; i < oOther->uSlots; i++) {
+      psOther = &oOther->psSlots[i];
+      if (psOther->pcKey == NULL) continue;
+
+      ppvSlot = SymTable_lookupOrInsert(oSymTable, psOther->pcKey,
+      psOther->uHash, psOther->pvValue, &iInserted);
+      if (ppvSlot == NULL) return 0;
+      if (!iInserted) {
+         STMerge_resolve(&sMerge, &oSymTable->sMemory, psOther->pcKey,
+         ppvSlot, psOther->pvValue);
+      }
+   }
+
+   return 1;
+}
+
+void SymTable_intersect(SymTable_T oSymTable, SymTable_T oOther,
+   void *(*pfResolve)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_INTERSECT, pfResolve, NULL,
+   pfFreeValue, pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
+
+void SymTable_diff(SymTable_T oSymTable, SymTable_T oOther,
+   int (*pfKeep)(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra),
+   void (*pfFreeValue)(void *pvValue), const void *pvExtra) {
+   struct STMerge sMerge;
+
+   assert(oSymTable != NULL);
+   assert(oOther != NULL);
+   assert(oSymTable != oOther);
+
+   STMerge_init(&sMerge, STMERGE_DIFF, NULL, pfKeep, pfFreeValue,
+   pvExtra);
+   SymTable_reduce(oSymTable, oOther, &sMerge);
+}
@@ -0,0 +1,568 @@
+/*--------------------------------------------------------------------*/
+/* symtableshared.c                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "symtableshared.h"
+
+/* The table starts with a STSharedHeader, padded to HEADER_SIZE
+bytes, followed by the buckets, each the offset of the first node of
+its chain or 0 for an empty chain. The nodes come after the buckets,
+every node is a STSharedNode followed by its key and, aligned to
+NODE_ALIGN, its value. Removed nodes are kept on a free list for
+reuse, new nodes are cut off the unused space at the end.
+
+The writer makes every change between two increments of uSequence,
+which is odd while a change is going on. A reader remembers an even
+uSequence, looks the key up and copies what it found, and starts over
+if uSequence changed meanwhile. What a reader sees during a change
+may be torn, so it checks every offset and size against the bounds of
+the table before following it */
+enum {HEADER_SIZE = 64, NODE_ALIGN = 16};
+
+/* The smallest table and the fewest buckets a table has */
+enum {MIN_SIZE = 4096, MIN_BUCKETS = 16};
+
+/* Marks a table whose header is complete */
+enum {SHARED_MAGIC = 0x53544853};
+
+/* STSharedHeader holds the state of a table that is shared by all
+processes */
+struct STSharedHeader
+{
+   /* SHARED_MAGIC once the table is set up */
+   size_t uMagic;
+   /* the number of changes begun and finished, odd during a change */
+   size_t uSequence;
+   /* the number of bytes of the table */
+   size_t uSize;
+   /* the number of buckets, a power of two */
+   size_t uBuckets;
+   /* the number of bindings */
+   size_t uLength;
+   /* the offset of the unused space at the end */
+   size_t uTop;
+   /* the offset of the first removed node, 0 if there is none */
+   size_t uFree;
+};
+
+/* STSharedNode is the start of a node, followed by the key and the
+value */
+struct STSharedNode
+{
+   /* the offset of the next node in the chain or free list, 0 for
+   the last one */
+   size_t uNext;
+   /* the hash code of the key */
+   size_t uHash;
+   /* the number of bytes of the node, including key and value */
+   size_t uBlockSize;
+   /* the length of the key including its '\0' */
+   size_t uKeySize;
+   /* the number of bytes of the value */
+   size_t uValueSize;
+};
+
+/* SymTableShared is a mapping of a table by one process */
+struct SymTableShared
+{
+   /* the mapped table */
+   char *pcRegion;
+   /* the header at the start of the table */
+   struct STSharedHeader *psHeader;
+   /* the number of bytes of the table, read once when mapped */
+   size_t uSize;
+   /* the number of buckets, read once when mapped */
+   size_t uBuckets;
+   /* the offset of the first node */
+   size_t uFirstNode;
+   /* 1 for the writer, 0 for a reader */
+   int iWritable;
+};
+
+/* Return the hash code of pcKey and store its length including the
+'\0' in *puKeySize. Every process must agree on the hash codes, so
+the multiplier is fixed */
+static size_t SymTableShared_hash(const char *pcKey, size_t *puKeySize)
+{
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * 65599 + (size_t)pcKey[u];
+
+   *puKeySize = u + 1;
+   return uHash;
+}
+
+/* Return uSize rounded up to a multiple of NODE_ALIGN */
+static size_t SymTableShared_align(size_t uSize)
+{
+   return (uSize + NODE_ALIGN - 1) / NODE_ALIGN * NODE_ALIGN;
+}
+
+/* Return the offset of the value within a node whose key takes
+uKeySize bytes */
+static size_t SymTableShared_valueOffset(size_t uKeySize)
+{
+   return SymTableShared_align(sizeof(struct STSharedNode) + uKeySize);
+}
+
+/* Return the number of bytes of a node with a key of uKeySize bytes
+and a value of uValueSize bytes */
+static size_t SymTableShared_blockSize(size_t uKeySize,
+size_t uValueSize)
+{
+   return SymTableShared_align(SymTableShared_valueOffset(uKeySize)
+   + uValueSize);
+}
+
+/* Return the node at uOffset in the table of oShared, writable */
+static struct STSharedNode *SymTableShared_at(SymTableShared_T oShared,
+size_t uOffset)
+{
+   return (struct STSharedNode*)(oShared->pcRegion + uOffset);
+}
+
+/* Copy the node at uOffset in the table of oShared to *psNode and
+return the address of the node, or return NULL if the node would not
+fit in the table, which a reader sees only during a change */
+static const char *SymTableShared_node(SymTableShared_T oShared,
+size_t uOffset, struct STSharedNode *psNode)
+{
+   const struct STSharedNode *psShared;
+
+   if (uOffset < oShared->uFirstNode || uOffset % NODE_ALIGN != 0
+   || uOffset > oShared->uSize - sizeof(struct STSharedNode))
+      return NULL;
+
+   psShared = SymTableShared_at(oShared, uOffset);
+   psNode->uNext = __atomic_load_n(&psShared->uNext, __ATOMIC_RELAXED);
+   psNode->uHash = __atomic_load_n(&psShared->uHash, __ATOMIC_RELAXED);
+   psNode->uBlockSize = __atomic_load_n(&psShared->uBlockSize,
+   __ATOMIC_RELAXED);
+   psNode->uKeySize = __atomic_load_n(&psShared->uKeySize,
+   __ATOMIC_RELAXED);
+   psNode->uValueSize = __atomic_load_n(&psShared->uValueSize,
+   __ATOMIC_RELAXED);
+
+   if (psNode->uBlockSize > oShared->uSize - uOffset
+   || psNode->uKeySize > psNode->uBlockSize
+   || psNode->uValueSize > psNode->uBlockSize
+   || SymTableShared_blockSize(psNode->uKeySize, psNode->uValueSize)
+   > psNode->uBlockSize)
+      return NULL;
+
+   return (const char*)psShared;
+}
+
+/* Return the offset of the node of pcKey, of uKeySize bytes and hash
+code uHash, in the table of oShared and copy the node to *psNode, or
+return 0 if there is none. If puLink is not NULL, store in *puLink the
+offset of the link to the node, or of the link at the end of the
+chain if there is none */
+static size_t SymTableShared_find(SymTableShared_T oShared,
+const char *pcKey, size_t uKeySize, size_t uHash,
+struct STSharedNode *psNode, size_t *puLink)
+{
+   const char *pcNode;
+   size_t uLink;
+   size_t uOffset;
+   size_t uSteps;
+   /* a torn chain may loop, no chain is longer than this */
+   size_t uMaxSteps = oShared->uSize / sizeof(struct STSharedNode);
+
+   uLink = HEADER_SIZE + (uHash & (oShared->uBuckets - 1))
+   * sizeof(size_t);
+
+   for (uSteps = 0; uSteps < uMaxSteps; uSteps++) {
+      uOffset = __atomic_load_n((const size_t*)(oShared->pcRegion
+      + uLink), __ATOMIC_RELAXED);
+      if (uOffset == 0) break;
+
+      pcNode = SymTableShared_node(oShared, uOffset, psNode);
+      if (pcNode == NULL) return 0;
+
+      if (psNode->uHash == uHash && psNode->uKeySize == uKeySize
+      && memcmp(pcNode + sizeof(struct STSharedNode), pcKey,
+      uKeySize) == 0) {
+         if (puLink != NULL) *puLink = uLink;
+         return uOffset;
+      }
+      uLink = uOffset + offsetof(struct STSharedNode, uNext);
+   }
+
+   if (puLink != NULL) *puLink = uLink;
+   return 0;
+}
+
+/* Wait until no change is going on in the table of oShared and
+return its sequence number */
+static size_t SymTableShared_beginRead(SymTableShared_T oShared)
+{
+   size_t uSequence;
+
+   for (;;) {
+      uSequence = __atomic_load_n(&oShared->psHeader->uSequence,
+      __ATOMIC_ACQUIRE);
+      if (uSequence % 2 == 0) return uSequence;
+      sched_yield();
+   }
+}
+
+/* Return 1 if the table of oShared was not changed since its sequence
+number was uSequence, so that what was read since is consistent, and
+0 otherwise */
+static int SymTableShared_endRead(SymTableShared_T oShared,
+size_t uSequence)
+{
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return __atomic_load_n(&oShared->psHeader->uSequence,
+   __ATOMIC_RELAXED) == uSequence;
+}
+
+/* Mark the start of a change to the table of oShared */
+static void SymTableShared_beginWrite(SymTableShared_T oShared)
+{
+   __atomic_add_fetch(&oShared->psHeader->uSequence, 1,
+   __ATOMIC_SEQ_CST);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Mark the end of a change to the table of oShared */
+static void SymTableShared_endWrite(SymTableShared_T oShared)
+{
+   __atomic_add_fetch(&oShared->psHeader->uSequence, 1,
+   __ATOMIC_RELEASE);
+}
+
+/* Return the offset of a node of at least uBlockSize bytes in the
+table of oShared, or 0 if there is no room. A removed node is reused
+when it is not more than twice as large */
+static size_t SymTableShared_alloc(SymTableShared_T oShared,
+size_t uBlockSize)
+{
+   struct STSharedHeader *psHeader = oShared->psHeader;
+   struct STSharedNode *psNode;
+   size_t *puLink;
+   size_t uOffset;
+
+   for (puLink = &psHeader->uFree; *puLink != 0;
+   puLink = &psNode->uNext) {
+      psNode = SymTableShared_at(oShared, *puLink);
+      if (psNode->uBlockSize >= uBlockSize
+      && psNode->uBlockSize / 2 <= uBlockSize) {
+         uOffset = *puLink;
+         *puLink = psNode->uNext;
+         return uOffset;
+      }
+   }
+
+   if (oShared->uSize - psHeader->uTop < uBlockSize) return 0;
+
+   uOffset = psHeader->uTop;
+   psHeader->uTop += uBlockSize;
+   SymTableShared_at(oShared, uOffset)->uBlockSize = uBlockSize;
+   return uOffset;
+}
+
+/* Put the node at uOffset in the table of oShared on the free list */
+static void SymTableShared_release(SymTableShared_T oShared,
+size_t uOffset)
+{
+   SymTableShared_at(oShared, uOffset)->uNext =
+   oShared->psHeader->uFree;
+   oShared->psHeader->uFree = uOffset;
+}
+
+/* Fill the node at uOffset in the table of oShared with pcKey, of
+uKeySize bytes and hash code uHash, and the uValueSize bytes at
+pvValue, as the last node of a chain */
+static void SymTableShared_fill(SymTableShared_T oShared,
+size_t uOffset, const char *pcKey, size_t uKeySize, size_t uHash,
+const void *pvValue, size_t uValueSize)
+{
+   struct STSharedNode *psNode = SymTableShared_at(oShared, uOffset);
+
+   psNode->uNext = 0;
+   psNode->uHash = uHash;
+   psNode->uKeySize = uKeySize;
+   psNode->uValueSize = uValueSize;
+   memcpy((char*)psNode + sizeof(struct STSharedNode), pcKey,
+   uKeySize);
+   if (uValueSize > 0)
+      memcpy((char*)psNode + SymTableShared_valueOffset(uKeySize),
+      pvValue, uValueSize);
+}
+
+/* Return a handle on the table of uSize bytes mapped at pvRegion,
+writable if iWritable is 1, or NULL if there is not enough memory */
+static SymTableShared_T SymTableShared_handle(void *pvRegion,
+size_t uSize, int iWritable)
+{
+   SymTableShared_T oShared;
+
+   oShared = (SymTableShared_T)malloc(sizeof(struct SymTableShared));
+   if (oShared == NULL) return NULL;
+
+   oShared->pcRegion = (char*)pvRegion;
+   oShared->psHeader = (struct STSharedHeader*)pvRegion;
+   oShared->uSize = uSize;
+   oShared->uBuckets = oShared->psHeader->uBuckets;
+   oShared->uFirstNode = HEADER_SIZE
+   + oShared->uBuckets * sizeof(size_t);
+   oShared->iWritable = iWritable;
+   return oShared;
+}
+
+SymTableShared_T SymTableShared_create(const char *pcName,
+size_t uSize) {
+   SymTableShared_T oShared;
+   struct STSharedHeader *psHeader;
+   void *pvRegion;
+   size_t uBuckets = MIN_BUCKETS;
+   int iFd;
+
+   assert(pcName != NULL);
+
+   if (uSize < MIN_SIZE) return NULL;
+   uSize = uSize / NODE_ALIGN * NODE_ALIGN;
+
+   iFd = shm_open(pcName, O_RDWR | O_CREAT | O_EXCL, 0644);
+   if (iFd < 0) return NULL;
+
+   if (ftruncate(iFd, (off_t)uSize) != 0) {
+      close(iFd);
+      shm_unlink(pcName);
+      return NULL;
+   }
+   pvRegion = mmap(NULL, uSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+   iFd, 0);
+   close(iFd);
+   if (pvRegion == MAP_FAILED) {
+      shm_unlink(pcName);
+      return NULL;
+   }
+
+   /* the object starts out zeroed, the rest of the header is 0 */
+   while (uBuckets * 2 * sizeof(size_t) <= uSize / 8) uBuckets *= 2;
+   psHeader = (struct STSharedHeader*)pvRegion;
+   psHeader->uSize = uSize;
+   psHeader->uBuckets = uBuckets;
+   psHeader->uTop = HEADER_SIZE + uBuckets * sizeof(size_t);
+
+   oShared = SymTableShared_handle(pvRegion, uSize, 1);
+   if (oShared == NULL) {
+      munmap(pvRegion, uSize);
+      shm_unlink(pcName);
+      return NULL;
+   }
+
+   /* readers accept the table once they see the magic number */
+   __atomic_store_n(&psHeader->uMagic, SHARED_MAGIC, __ATOMIC_RELEASE);
+   return oShared;
+}
+
+SymTableShared_T SymTableShared_open(const char *pcName) {
+   SymTableShared_T oShared;
+   struct STSharedHeader *psHeader;
+   struct stat sStat;
+   void *pvRegion;
+   size_t uSize;
+   int iFd;
+
+   assert(pcName != NULL);
+
+   iFd = shm_open(pcName, O_RDONLY, 0);
+   if (iFd < 0) return NULL;
+
+   if (fstat(iFd, &sStat) != 0 || sStat.st_size < MIN_SIZE) {
+      close(iFd);
+      return NULL;
+   }
+   uSize = (size_t)sStat.st_size;
+   pvRegion = mmap(NULL, uSize, PROT_READ, MAP_SHARED, iFd, 0);
+   close(iFd);
+   if (pvRegion == MAP_FAILED) return NULL;
+
+   psHeader = (struct STSharedHeader*)pvRegion;
+   if (__atomic_load_n(&psHeader->uMagic, __ATOMIC_ACQUIRE)
+   != SHARED_MAGIC || psHeader->uSize != uSize
+   || psHeader->uBuckets < MIN_BUCKETS
+   || (psHeader->uBuckets & (psHeader->uBuckets - 1)) != 0
+   || psHeader->uBuckets > uSize / 8 / sizeof(size_t)) {
+      munmap(pvRegion, uSize);
+      return NULL;
+   }
+
+   oShared = SymTableShared_handle(pvRegion, uSize, 0);
+   if (oShared == NULL) munmap(pvRegion, uSize);
+   return oShared;
+}
+
+void SymTableShared_free(SymTableShared_T oShared) {
+   if (oShared == NULL) return;
+
+   munmap(oShared->pcRegion, oShared->uSize);
+   free(oShared);
+}
+
+int SymTableShared_unlink(const char *pcName) {
+   assert(pcName != NULL);
+
+   return shm_unlink(pcName) == 0;
+}
+
+size_t SymTableShared_getLength(SymTableShared_T oShared) {
+   assert(oShared != NULL);
+
+   return __atomic_load_n(&oShared->psHeader->uLength,
+   __ATOMIC_ACQUIRE);
+}
+
+int SymTableShared_put(SymTableShared_T oShared, const char *pcKey,
+const void *pvValue, size_t uSize) {
+   struct STSharedNode sNode;
+   size_t uKeySize;
+   size_t uHash;
+   size_t uLink;
+   size_t uOffset;
+
+   assert(oShared != NULL);
+   assert(pcKey != NULL);
+   assert(pvValue != NULL || uSize == 0);
+
+   if (!oShared->iWritable) return -1;
+
+   uHash = SymTableShared_hash(pcKey, &uKeySize);
+   if (SymTableShared_find(oShared, pcKey, uKeySize, uHash, &sNode,
+   &uLink) != 0) return 0;
+   if (uKeySize > oShared->uSize || uSize > oShared->uSize) return -1;
+
+   SymTableShared_beginWrite(oShared);
+   uOffset = SymTableShared_alloc(oShared,
+   SymTableShared_blockSize(uKeySize, uSize));
+   if (uOffset != 0) {
+      SymTableShared_fill(oShared, uOffset, pcKey, uKeySize, uHash,
+      pvValue, uSize);
+      *(size_t*)(oShared->pcRegion + uLink) = uOffset;
+      oShared->psHeader->uLength++;
+   }
+   SymTableShared_endWrite(oShared);
+
+   return uOffset != 0 ? 1 : -1;
+}
+
+int SymTableShared_replace(SymTableShared_T oShared, const char *pcKey,
+const void *pvValue, size_t uSize) {
+   struct STSharedNode sNode;
+   size_t uKeySize;
+   size_t uHash;
+   size_t uLink;
+   size_t uOffset;
+   size_t uNew;
+   int iResult = 1;
+
+   assert(oShared != NULL);
+   assert(pcKey != NULL);
+   assert(pvValue != NULL || uSize == 0);
+
+   if (!oShared->iWritable) return -1;
+
+   uHash = SymTableShared_hash(pcKey, &uKeySize);
+   uOffset = SymTableShared_find(oShared, pcKey, uKeySize, uHash,
+   &sNode, &uLink);
+   if (uOffset == 0) return 0;
+   if (uSize > oShared->uSize) return -1;
+
+   SymTableShared_beginWrite(oShared);
+   if (SymTableShared_blockSize(uKeySize, uSize) <= sNode.uBlockSize) {
+      /* the new value fits in the node */
+      SymTableShared_at(oShared, uOffset)->uValueSize = uSize;
+      if (uSize > 0)
+         memcpy(oShared->pcRegion + uOffset
+         + SymTableShared_valueOffset(uKeySize), pvValue, uSize);
+   }
+   else {
+      uNew = SymTableShared_alloc(oShared,
+      SymTableShared_blockSize(uKeySize, uSize));
+      if (uNew == 0) iResult = -1;
+      else {
+         SymTableShared_fill(oShared, uNew, pcKey, uKeySize, uHash,
+         pvValue, uSize);
+         SymTableShared_at(oShared, uNew)->uNext = sNode.uNext;
+         *(size_t*)(oShared->pcRegion + uLink) = uNew;
+         SymTableShared_release(oShared, uOffset);
+      }
+   }
+   SymTableShared_endWrite(oShared);
+
+   return iResult;
+}
+
+int SymTableShared_remove(SymTableShared_T oShared, const char *pcKey) {
+   struct STSharedNode sNode;
+   size_t uKeySize;
+   size_t uHash;
+   size_t uLink;
+   size_t uOffset;
+
+   assert(oShared != NULL);
+   assert(pcKey != NULL);
+
+   if (!oShared->iWritable) return -1;
+
+   uHash = SymTableShared_hash(pcKey, &uKeySize);
+   uOffset = SymTableShared_find(oShared, pcKey, uKeySize, uHash,
+   &sNode, &uLink);
+   if (uOffset == 0) return 0;
+
+   SymTableShared_beginWrite(oShared);
+   *(size_t*)(oShared->pcRegion + uLink) = sNode.uNext;
+   SymTableShared_release(oShared, uOffset);
+   oShared->psHeader->uLength--;
+   SymTableShared_endWrite(oShared);
+
+   return 1;
+}
+
+int SymTableShared_get(SymTableShared_T oShared, const char *pcKey,
+void *pvValue, size_t uSize, size_t *puSize) {
+   struct STSharedNode sNode;
+   size_t uKeySize;
+   size_t uHash;
+   size_t uOffset;
+   size_t uSequence;
+
+   assert(oShared != NULL);
+   assert(pcKey != NULL);
+   assert(pvValue != NULL || uSize == 0);
+
+   uHash = SymTableShared_hash(pcKey, &uKeySize);
+
+   do {
+      uSequence = SymTableShared_beginRead(oShared);
+      uOffset = SymTableShared_find(oShared, pcKey, uKeySize, uHash,
+      &sNode, NULL);
+      if (uOffset != 0 && uSize > 0)
+         memcpy(pvValue, oShared->pcRegion + uOffset
+         + SymTableShared_valueOffset(uKeySize),
+         uSize < sNode.uValueSize ? uSize : sNode.uValueSize);
+   } while (!SymTableShared_endRead(oShared, uSequence));
+
+   if (uOffset == 0) return 0;
+   if (puSize != NULL) *puSize = sNode.uValueSize;
+   return 1;
+}
@@ -0,0 +1,72 @@
+/*--------------------------------------------------------------------*/
+/* symtableshared.h                                                   */
+/* Author: John Matters                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLESHARED_INCLUDED
+#define SYMTABLESHARED_INCLUDED
+
+#include <stddef.h>
+
+/* Define type SymTableShared_T to be a pointer towards a
+SymTableShared, a handle on a hash table that lives in a POSIX shared
+memory object, so that every process that opens it looks up bindings
+in the same physical pages. The buckets, nodes, keys and values are
+laid out in the object with offsets instead of pointers, and values
+are copied in and out as bytes. One process creates the table and is
+its only writer, any number of processes open it for reading, and
+readers retry a lookup that overlapped a change. A SymTableShared
+must not be used by more than one thread at a time */
+typedef struct SymTableShared *SymTableShared_T;
+
+/* Create the shared memory object named pcName, which must start with
+'/' and not exist yet, holding an empty table of uSize bytes in total,
+and return a handle through which it is written. The size is fixed,
+an eighth of it goes to the buckets. Returns NULL if the object cannot
+be created or there is not enough memory */
+SymTableShared_T SymTableShared_create(const char *pcName,
+size_t uSize);
+
+/* Open the table in the shared memory object named pcName for reading
+and return a handle on it. Returns NULL if the object cannot be
+opened, does not hold a table or there is not enough memory */
+SymTableShared_T SymTableShared_open(const char *pcName);
+
+/* Free oShared and unmap its table, the table itself stays in the
+shared memory object until that is unlinked */
+void SymTableShared_free(SymTableShared_T oShared);
+
+/* Remove the shared memory object named pcName, processes that have
+it open keep their mapping. Returns 1 on success and 0 otherwise */
+int SymTableShared_unlink(const char *pcName);
+
+/* Return the number of bindings in the table of oShared */
+size_t SymTableShared_getLength(SymTableShared_T oShared);
+
+/* Add to the table of oShared a binding of a copy of pcKey to a copy
+of the uSize bytes at pvValue, if pcKey is not bound yet. Returns 1 if
+the binding was inserted, 0 if the key was already there, or -1 if
+the table is full or oShared was opened for reading */
+int SymTableShared_put(SymTableShared_T oShared, const char *pcKey,
+const void *pvValue, size_t uSize);
+
+/* Bind pcKey to a copy of the uSize bytes at pvValue in the table of
+oShared, if pcKey is bound. Returns 1 if the value was replaced, 0 if
+the key was not there, or -1 if the table is full or oShared was
+opened for reading, in which case the old value stays */
+int SymTableShared_replace(SymTableShared_T oShared, const char *pcKey,
+const void *pvValue, size_t uSize);
+
+/* Remove the binding of pcKey from the table of oShared. Returns 1 if
+it was there, 0 if it was not, or -1 if oShared was opened for
+reading */
+int SymTableShared_remove(SymTableShared_T oShared, const char *pcKey);
+
+/* Look up pcKey in the table of oShared. If it is bound, copy at most
+uSize bytes of its value to pvValue, store the size of the value in
+*puSize when puSize is not NULL and return 1, otherwise return 0. The
+value is copied as it was at a single point in time */
+int SymTableShared_get(SymTableShared_T oShared, const char *pcKey,
+void *pvValue, size_t uSize, size_t *puSize);
+
+#endif
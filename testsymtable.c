@@ -4,11 +4,20 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#include "symtablelog.h"
+#include "symtableshared.h"
+#include "symtablecombiner.h"
+#include "symtablefrozen.h"
+#include "symset.h"
+#include "symatom.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #ifndef S_SPLINT_S
 #include <sys/resource.h>
@@ -430,6 +439,102 @@ static void testMap(void)
 
 /*--------------------------------------------------------------------*/
 
+/* BatchTotals is what sumBatch gathers from the batches it is given
+   by SymTable_mapBatch. */
+
+struct BatchTotals
+{
+   size_t uBatchSize;
+   size_t uBatches;
+   size_t uBindings;
+   long lSum;
+   int iMismatches;
+};
+
+/* Add the uCount bindings with keys ppcKeys and values ppvValues,
+   which point to ints equal to the keys, to the totals *pvExtra. */
+
+static void sumBatch(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvExtra)
+{
+   struct BatchTotals *psTotals = (struct BatchTotals*)pvExtra;
+   size_t u;
+
+   if (uCount == 0 || uCount > psTotals->uBatchSize)
+      psTotals->iMismatches++;
+   psTotals->uBatches++;
+   for (u = 0; u < uCount; u++)
+   {
+      if (atoi(ppcKeys[u]) != *(int*)ppvValues[u])
+         psTotals->iMismatches++;
+      psTotals->lSum += *(int*)ppvValues[u];
+   }
+   psTotals->uBindings += uCount;
+}
+
+/* Test the SymTable_mapBatch() function with batches smaller and
+   larger than the SymTable, with and without an arena. */
+
+static void testMapBatch(void)
+{
+   enum {BINDING_COUNT = 1000};
+   enum {MAX_KEY_LENGTH = 10};
+   enum {SIZE_COUNT = 5};
+
+   static const size_t auBatchSizes[SIZE_COUNT] = 
+      {1, 7, 256, 1000, 5000};
+   static int aiValues[BINDING_COUNT];
+   SymTable_T oSymTable;
+   struct BatchTotals sTotals;
+   char acKey[MAX_KEY_LENGTH];
+   int iFlags;
+   int i;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_mapBatch() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (iFlags = 0; iFlags <= SYMTABLE_ARENA; iFlags++)
+   {
+      oSymTable = SymTable_newWithAllocator(NULL, iFlags);
+      ASSURE(oSymTable != NULL);
+
+      /* An empty SymTable gives no batches. */
+      memset(&sTotals, 0, sizeof(sTotals));
+      sTotals.uBatchSize = 8;
+      SymTable_mapBatch(oSymTable, sumBatch, &sTotals, 8);
+      ASSURE(sTotals.uBatches == 0);
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         aiValues[i] = i;
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+         ASSURE(iSuccessful);
+      }
+
+      for (i = 0; i < SIZE_COUNT; i++)
+      {
+         memset(&sTotals, 0, sizeof(sTotals));
+         sTotals.uBatchSize = auBatchSizes[i];
+         SymTable_mapBatch(oSymTable, sumBatch, &sTotals,
+            auBatchSizes[i]);
+         ASSURE(sTotals.iMismatches == 0);
+         ASSURE(sTotals.uBindings == BINDING_COUNT);
+         ASSURE(sTotals.lSum == 
+            (long)BINDING_COUNT * (BINDING_COUNT - 1) / 2);
+         ASSURE(sTotals.uBatches >= 
+            (BINDING_COUNT + auBatchSizes[i] - 1) / auBatchSizes[i]);
+      }
+
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test a SymTable object that contains no bindings. */
 
 static void testEmptyTable(void)
@@ -775,190 +880,3129 @@ static void testCollisions(void)
 
 /*--------------------------------------------------------------------*/
 
-/* Test the ability of a SymTable object to be large, that is, to
-   contain iBindingCount bindings. Write the time consumed to stdout. */
+/* Test the SymTable_upsert() and SymTable_getOrPut() functions. */
 
-static void testLargeTable(int iBindingCount)
+static void testUpsert(void)
+{
+   SymTable_T oSymTable;
+   char acJeter[] = "Jeter";
+   char acMantle[] = "Mantle";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acFirstBase[] = "First Base";
+   char *pcValue;
+   void *pvOld;
+   void **ppvSlot;
+   int iResult;
+   size_t uLength;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_upsert() and SymTable_getOrPut()\n");
+   printf("functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Test SymTable_upsert(). */
+
+   pvOld = acFirstBase;
+   iResult = SymTable_upsert(oSymTable, acJeter, acShortstop, &pvOld);
+   ASSURE(iResult == 1);
+   ASSURE(pvOld == NULL);
+
+   iResult = SymTable_upsert(oSymTable, acJeter, acCenterField, &pvOld);
+   ASSURE(iResult == 0);
+   ASSURE(pvOld == acShortstop);
+
+   iResult = SymTable_upsert(oSymTable, acJeter, acFirstBase, NULL);
+   ASSURE(iResult == 0);
+
+   pcValue = (char*)SymTable_get(oSymTable, acJeter);
+   ASSURE(pcValue == acFirstBase);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 1);
+
+   /* Test SymTable_getOrPut(). */
+
+   iResult = SymTable_getOrPut(oSymTable, acMantle, acCenterField,
+      &ppvSlot);
+   ASSURE(iResult == 1);
+   ASSURE((ppvSlot != NULL) && (*ppvSlot == acCenterField));
+
+   *ppvSlot = acShortstop;
+   pcValue = (char*)SymTable_get(oSymTable, acMantle);
+   ASSURE(pcValue == acShortstop);
+
+   iResult = SymTable_getOrPut(oSymTable, acJeter, acCenterField,
+      &ppvSlot);
+   ASSURE(iResult == 0);
+   ASSURE((ppvSlot != NULL) && (*ppvSlot == acFirstBase));
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that SymTable_get(), SymTable_contains(), SymTable_replace()
+   and SymTable_remove() still behave when the SymTable object
+   reorders its bindings on lookup or in SymTable_optimize(). */
+
+static void testReorder(void)
 {
+   enum {BINDING_COUNT = 30};
    enum {MAX_KEY_LENGTH = 10};
 
    SymTable_T oSymTable;
-   SymTable_T oSymTableSmall;
    char acKey[MAX_KEY_LENGTH];
+   char acValues[BINDING_COUNT];
    char *pcValue;
+   int iReorder;
    int i;
-   int iSmall;
-   int iLarge;
+   int j;
+   int iFound;
    int iSuccessful;
-   clock_t iInitialClock;
-   clock_t iFinalClock;
-   size_t uLength = 0;
-   size_t uLength2;
+   int iInserted;
+   void **ppvSlot;
+   size_t uLength;
 
    printf("------------------------------------------------------\n");
-   printf("Testing a potentially large SymTable object.\n");
-   printf("No output except CPU time consumed should appear here:\n");
+   printf("Testing a SymTable object that reorders its bindings.\n");
+   printf("No output should appear here:\n");
    fflush(stdout);
 
-   /* Note the current time. */
-   iInitialClock = clock();
+   for (iReorder = SYMTABLE_REORDER_NONE;
+        iReorder <= SYMTABLE_REORDER_TRANSPOSE; iReorder++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      /* The policy is only a hint, so its result is not checked. */
+      SymTable_setReorder(oSymTable, iReorder);
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, &acValues[i]);
+         ASSURE(iSuccessful);
+      }
+
+      /* Look up the keys with a heavily skewed popularity. */
+      for (j = 0; j < 200; j++)
+      {
+         i = (j % 10 == 0) ? j % BINDING_COUNT : j % 3;
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == &acValues[i]);
+         iFound = SymTable_contains(oSymTable, acKey);
+         ASSURE(iFound);
+      }
+
+      SymTable_optimize(oSymTable);
+
+      pcValue = (char*)SymTable_replace(oSymTable, "0", acValues);
+      ASSURE(pcValue == &acValues[0]);
+      pcValue = (char*)SymTable_remove(oSymTable, "1");
+      ASSURE(pcValue == &acValues[1]);
+      iFound = SymTable_contains(oSymTable, "1");
+      ASSURE(! iFound);
+
+      for (i = 2; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == &acValues[i]);
+      }
 
-   /* Create oSymTableSmall, and put a couple of bindings into it. */
-   oSymTableSmall = SymTable_new();
-   ASSURE(oSymTableSmall != NULL);
-   iSuccessful = SymTable_put(oSymTableSmall, "xxx", "xxx");
-   ASSURE(iSuccessful);
-   iSuccessful = SymTable_put(oSymTableSmall, "yyy", "yyy");
-   ASSURE(iSuccessful);
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == BINDING_COUNT - 1);
 
-   /* Create oSymTable, the primary SymTable object. */
-   oSymTable = SymTable_new();
-   ASSURE(oSymTable != NULL);
+      SymTable_free(oSymTable);
 
-   /* Put iBindingCount new bindings into oSymTable.  Each binding's
-      key and value contain the same characters. */
-   for (i = 0; i < iBindingCount; i++)
-   {
-      sprintf(acKey, "%d", i);
-      pcValue = (char*)malloc(sizeof(char) * (strlen(acKey) + 1));
-      ASSURE(pcValue != NULL);
-      strcpy(pcValue, acKey);
-      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      /* Lookups leave the slot of SymTable_getOrPut() in place, also
+         while the SymTable object is small. */
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      SymTable_setReorder(oSymTable, iReorder);
+      iSuccessful = SymTable_put(oSymTable, "a", &acValues[0]);
       ASSURE(iSuccessful);
-      uLength = SymTable_getLength(oSymTable);
-      ASSURE(uLength == (size_t)(i+1));
+      iSuccessful = SymTable_put(oSymTable, "b", &acValues[1]);
+      ASSURE(iSuccessful);
+      iInserted = SymTable_getOrPut(oSymTable, "c", &acValues[2],
+         &ppvSlot);
+      ASSURE(iInserted == 1);
+      for (j = 0; j < 3; j++)
+      {
+         pcValue = (char*)SymTable_get(oSymTable, "c");
+         ASSURE(pcValue == &acValues[2]);
+      }
+      ASSURE(*ppvSlot == &acValues[2]);
+      pcValue = (char*)SymTable_get(oSymTable, "b");
+      ASSURE(pcValue == &acValues[1]);
+      SymTable_free(oSymTable);
    }
+}
 
-   /* Get each binding's value, and make sure that it contains
-      the same characters as its key. */
-   iSmall = 0;
-   iLarge = iBindingCount - 1;
-   while (iSmall < iLarge)
-   {
-      /* Get the smallest of the remaining bindings. */
-      sprintf(acKey, "%d", iSmall);
-      pcValue = (char*)SymTable_get(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-      iSmall++;
-      /* Get the largest of the remaining bindings. */
-      sprintf(acKey, "%d", iLarge);
-      pcValue = (char*)SymTable_get(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-      iLarge--;
-   }
-   /* Get the middle binding -- if there is one. */
-   if (iSmall == iLarge)
-   {
-      sprintf(acKey, "%d", iSmall);
-      pcValue = (char*)SymTable_get(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-   }
+/*--------------------------------------------------------------------*/
 
-   /* Remove each binding. Also free each binding's value. */
-   iSmall = 0;
-   iLarge = iBindingCount - 1;
-   while (iSmall < iLarge)
-   {
-      /* Remove the smallest of the remaining bindings. */
-      sprintf(acKey, "%d", iSmall);
-      pcValue = (char*)SymTable_remove(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-      free(pcValue);
-      uLength--;
-      uLength2 = SymTable_getLength(oSymTable);
-      ASSURE(uLength2 == uLength);
-      iSmall++;
-      /* Remove the largest of the remaining bindings. */
-      sprintf(acKey, "%d", iLarge);
-      pcValue = (char*)SymTable_remove(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-      free(pcValue);
-      uLength--;
-      uLength2 = SymTable_getLength(oSymTable);
-      ASSURE(uLength2 == uLength);
-      iLarge--;
-   }
-   /* Remove the middle binding -- if there is one. */
-   if (iSmall == iLarge)
-   {
-      sprintf(acKey, "%d", iSmall);
-      pcValue = (char*)SymTable_remove(oSymTable, acKey);
-      ASSURE(pcValue != NULL);
-      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
-      free(pcValue);
-      uLength--;
-      uLength2 = SymTable_getLength(oSymTable);
-      ASSURE(uLength2 == uLength);  
-   }
+/* The number of values passed to countValue. */
 
-   /* Make sure oSymTableSmall hasn't been corrupted by expansion
-      of oSymTable. */
-   pcValue = (char*)SymTable_get(oSymTableSmall, "xxx");
-   ASSURE((pcValue != NULL) && (strcmp(pcValue, "xxx") == 0));
-   pcValue = (char*)SymTable_get(oSymTableSmall, "yyy");
-   ASSURE((pcValue != NULL) && (strcmp(pcValue, "yyy") == 0));
+static size_t uCountedValues = 0;
 
-   /* Free both SymTable objects. */
-   SymTable_free(oSymTable);
-   SymTable_free(oSymTableSmall);
+/*--------------------------------------------------------------------*/
 
-   /* Note the current time, and print the time consumed to stdout. */
-   iFinalClock = clock();
-   printf("CPU time (%d bindings):  %f seconds\n", iBindingCount,
-      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
-   fflush(stdout);
+/* Count the value pvValue in uCountedValues. */
+
+static void countValue(void *pvValue)
+{
+   uCountedValues++;
 }
 
 /*--------------------------------------------------------------------*/
 
-/* Test the SymTable ADT.  Write the output of the tests to stdout.
-   As always, argc is the command-line argument count, argv contains
-   the command-line arguments, and argv[0] is the name of the
-   executable binary file. argv[1] is the number of bindings to put
-   into a potentially large SymTable object.  Exit with EXIT_FAILURE
-   if argv[1] is missing or not numeric.  Otherwise return 0. */
+/* Test SymTable_clear on a SymTable object that is cleared and filled
+   again, both while it holds a few bindings and while it holds many,
+   so that an implementation that reuses its storage is exercised. */
 
-int main(int argc, char *argv[])
+static void testClear(void)
 {
-   int iBindingCount;
+   enum {BINDING_COUNT = 1000};
+   enum {MAX_KEY_LENGTH = 16};
 
-   if (argc != 2)
-   {
-      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
-      exit(EXIT_FAILURE);
-   }
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int iCount;
+   int iRound;
+   int i;
+   int iFound;
+   int iSuccessful;
+   size_t uLength;
 
-   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
-   {
-      fprintf(stderr, "bindingcount must be numeric\n");
-      exit(EXIT_FAILURE);
-   }
-   if (iBindingCount < 0)
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object that is cleared.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   SymTable_clear(oSymTable, NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 0);
+
+   for (iRound = 0; iRound < 4; iRound++)
    {
-      fprintf(stderr, "bindingcount cannot be negative\n");
-      exit(EXIT_FAILURE);
+      iCount = (iRound % 2 == 0) ? 3 : BINDING_COUNT;
+
+      for (i = 0; i < iCount; i++)
+      {
+         sprintf(acKey, "%d", i + iRound);
+         iSuccessful = SymTable_put(oSymTable, acKey, &acValue[i % 5]);
+         ASSURE(iSuccessful);
+      }
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == (size_t)iCount);
+
+      uCountedValues = 0;
+      SymTable_clear(oSymTable, countValue);
+      ASSURE(uCountedValues == (size_t)iCount);
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == 0);
+
+      for (i = 0; i < iCount; i++)
+      {
+         sprintf(acKey, "%d", i + iRound);
+         iFound = SymTable_contains(oSymTable, acKey);
+         ASSURE(! iFound);
+      }
    }
-   
-#ifndef S_SPLINT_S
-   setCpuTimeLimit();
-#endif
 
-   testBasics();
-   testKeyComparison();
-   testKeyOwnership();
-   testRemove();
-   testMap();
-   testEmptyTable();
-   testEmptyKey();
-   testNullValue();
-   testLongKey();
-   testTableOfTables();
-   testCollisions();
+   /* The SymTable is still usable after being cleared. */
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acValue);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acValue);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return whichever of the ints pvValue and pvOtherValue is larger,
+   pvValue if they are equal, and count the call in the int that
+   pvExtra points to. */
+
+static void *largerInt(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvOtherValue != NULL);
+   assert(pvExtra != NULL);
+
+   (*(int*)pvExtra)++;
+   if (*(int*)pvValue >= *(int*)pvOtherValue)
+      return pvValue;
+   return pvOtherValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if the ints pvValue and pvOtherValue differ, and 0
+   otherwise. */
+
+static int differentInt(const char *pcKey, void *pvValue,
+   void *pvOtherValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvOtherValue != NULL);
+
+   return *(int*)pvValue != *(int*)pvOtherValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Bind every key of oSymTable from "0" to the decimal iCount - 1 that
+   is a multiple of iStep to the element of aiValues at its index. */
+
+static void putMultiples(SymTable_T oSymTable, int iCount, int iStep,
+   int aiValues[])
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   char acKey[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   for (i = 0; i < iCount; i += iStep)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_merge, SymTable_intersect and SymTable_diff between
+   tables of multiples of 2 and of 3, as ordinary, hardened and sized
+   tables, and with tables small enough to be represented apart. */
+
+static void testMerge(void)
+{
+   enum {BINDING_COUNT = 2000};
+   enum {MAX_KEY_LENGTH = 12};
+
+   static int aiTwo[BINDING_COUNT];
+   static int aiThree[BINDING_COUNT];
+   SymTable_T oTwo;
+   SymTable_T oThree;
+   SymTable_T oSmall;
+   char acKey[MAX_KEY_LENGTH];
+   int *piValue;
+   int *piExpected;
+   int iCalls;
+   int iSuccessful;
+   int iSized;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_merge, SymTable_intersect and "
+      "SymTable_diff.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The multiples of 3 that are multiples of 5 have a larger value
+      in oThree than in oTwo, the others the same. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      aiTwo[i] = i;
+      aiThree[i] = (i % 5 == 0) ? i + 1 : i;
+   }
+
+   /* Merge ordinary tables with the filter on, then tables with
+      inline values, which get copies. */
+   for (iSized = 0; iSized < 2; iSized++)
+   {
+      oTwo = iSized ? SymTable_newSized(sizeof(int)) : SymTable_new();
+      oThree = iSized ? SymTable_newSized(sizeof(int)) : SymTable_new();
+      /* An implementation may not support inline values. */
+      if (oTwo == NULL || oThree == NULL)
+      {
+         ASSURE(iSized);
+         if (oTwo != NULL)
+            SymTable_free(oTwo);
+         if (oThree != NULL)
+            SymTable_free(oThree);
+         break;
+      }
+      (void)SymTable_setFilter(oTwo, 1);
+      putMultiples(oTwo, BINDING_COUNT, 2, aiTwo);
+      putMultiples(oThree, BINDING_COUNT, 3, aiThree);
+
+      iCalls = 0;
+      iSuccessful = SymTable_merge(oTwo, oThree, largerInt, &iCalls);
+      ASSURE(iSuccessful);
+      ASSURE(iCalls == (BINDING_COUNT + 5) / 6);
+      ASSURE(SymTable_getLength(oTwo) == BINDING_COUNT * 2 / 3);
+      ASSURE(SymTable_getLength(oThree) == (BINDING_COUNT + 2) / 3);
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         piValue = (int*)SymTable_get(oTwo, acKey);
+         if (i % 2 != 0 && i % 3 != 0)
+         {
+            ASSURE(piValue == NULL);
+            continue;
+         }
+         piExpected = &aiTwo[i];
+         if (i % 2 != 0 || (i % 3 == 0 && i % 5 == 0))
+            piExpected = &aiThree[i];
+         ASSURE(piValue != NULL);
+         if (piValue == NULL)
+            continue;
+         if (iSized)
+            ASSURE(*piValue == *piExpected);
+         else
+            ASSURE(piValue == piExpected);
+      }
+
+      SymTable_free(oTwo);
+      SymTable_free(oThree);
+   }
+
+   oThree = SymTable_new();
+   ASSURE(oThree != NULL);
+   if (oThree == NULL)
+      return;
+   putMultiples(oThree, BINDING_COUNT, 3, aiThree);
+
+   /* Without pfResolve the values of oThree win. */
+   oTwo = SymTable_new();
+   ASSURE(oTwo != NULL);
+   putMultiples(oTwo, BINDING_COUNT, 2, aiTwo);
+   iSuccessful = SymTable_merge(oTwo, oThree, NULL, NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oTwo, "6") == &aiThree[6]);
+   ASSURE(SymTable_get(oTwo, "8") == &aiTwo[8]);
+   ASSURE(SymTable_get(oTwo, "9") == &aiThree[9]);
+   SymTable_free(oTwo);
+
+   /* The intersection keeps the multiples of 6 with their values, and
+      frees the values of the other multiples of 2. */
+   oTwo = SymTable_new();
+   ASSURE(oTwo != NULL);
+   putMultiples(oTwo, BINDING_COUNT, 2, aiTwo);
+   uCountedValues = 0;
+   SymTable_intersect(oTwo, oThree, NULL, countValue, NULL);
+   ASSURE(SymTable_getLength(oTwo) == (BINDING_COUNT + 5) / 6);
+   ASSURE(uCountedValues == BINDING_COUNT / 2
+      - (BINDING_COUNT + 5) / 6);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      piValue = (int*)SymTable_get(oTwo, acKey);
+      ASSURE(piValue == ((i % 6 == 0) ? &aiTwo[i] : NULL));
+   }
+   SymTable_free(oTwo);
+
+   /* The difference keeps what oThree lacks or binds differently,
+      the multiples of 30 among the multiples of 6. */
+   oTwo = SymTable_new();
+   ASSURE(oTwo != NULL);
+   putMultiples(oTwo, BINDING_COUNT, 2, aiTwo);
+   uCountedValues = 0;
+   SymTable_diff(oTwo, oThree, differentInt, countValue, NULL);
+   ASSURE(uCountedValues == (BINDING_COUNT + 5) / 6
+      - (BINDING_COUNT + 29) / 30);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oTwo, acKey)
+         == (i % 2 == 0 && (i % 6 != 0 || i % 30 == 0)));
+   }
+   SymTable_diff(oTwo, oThree, NULL, NULL, NULL);
+   ASSURE(SymTable_getLength(oTwo) == BINDING_COUNT / 2
+      - (BINDING_COUNT + 5) / 6);
+   SymTable_free(oTwo);
+
+   /* A hardened table hashes keys differently from oThree. */
+   oTwo = SymTable_newWithAllocator(NULL, SYMTABLE_HARDENED);
+   ASSURE(oTwo != NULL);
+   putMultiples(oTwo, BINDING_COUNT, 2, aiTwo);
+   iSuccessful = SymTable_merge(oTwo, oThree, NULL, NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oTwo) == BINDING_COUNT * 2 / 3);
+   SymTable_intersect(oTwo, oThree, NULL, NULL, NULL);
+   ASSURE(SymTable_getLength(oTwo) == (BINDING_COUNT + 2) / 3);
+   ASSURE(SymTable_get(oTwo, "6") == &aiThree[6]);
+   SymTable_free(oTwo);
+
+   /* Small tables both ways. */
+   oSmall = SymTable_new();
+   ASSURE(oSmall != NULL);
+   putMultiples(oSmall, 10, 4, aiTwo);
+   iCalls = 0;
+   iSuccessful = SymTable_merge(oThree, oSmall, largerInt, &iCalls);
+   ASSURE(iSuccessful);
+   ASSURE(iCalls == 1);
+   ASSURE(SymTable_getLength(oThree) == (BINDING_COUNT + 2) / 3 + 2);
+   ASSURE(SymTable_get(oThree, "8") == &aiTwo[8]);
+   SymTable_intersect(oSmall, oThree, NULL, NULL, NULL);
+   ASSURE(SymTable_getLength(oSmall) == 3);
+   SymTable_diff(oSmall, oThree, NULL, NULL, NULL);
+   ASSURE(SymTable_getLength(oSmall) == 0);
+   iSuccessful = SymTable_merge(oSmall, oThree, NULL, NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSmall) == SymTable_getLength(oThree));
+
+   SymTable_free(oSmall);
+   SymTable_free(oThree);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that pvValue, evicted with key pcKey, is the int whose decimal
+   form pcKey is, mark it as evicted by making it -1, and count it in
+   uCountedValues. */
+
+static void evictValue(const char *pcKey, void *pvValue)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+
+   ASSURE(*(int*)pvValue == atoi(pcKey));
+   *(int*)pvValue = -1;
+   uCountedValues++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a bounded SymTable object used as a cache: it never holds more
+   than its bound, evicts only to make room for new bindings, and keeps
+   a binding that is looked up between any two evictions. */
+
+static void testBounded(void)
+{
+   enum {CAPACITY = 100};
+   enum {BINDING_COUNT = 2000};
+   enum {MAX_KEY_LENGTH = 10};
+
+   static int aiValues[BINDING_COUNT];
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   void *pvOld;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a bounded SymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An implementation may not support bounded tables. */
+   oSymTable = SymTable_newBounded(CAPACITY, evictValue);
+   if (oSymTable == NULL)
+      return;
+
+   for (i = 0; i < BINDING_COUNT; i++)
+      aiValues[i] = i;
+   uCountedValues = 0;
+
+   for (i = 0; i < CAPACITY; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(uCountedValues == 0);
+   ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+
+   /* Updating bindings that are there evicts nothing. */
+   iSuccessful = SymTable_upsert(oSymTable, "7", &aiValues[7], &pvOld);
+   ASSURE(iSuccessful == 0);
+   ASSURE(pvOld == &aiValues[7]);
+   pvOld = SymTable_replace(oSymTable, "8", &aiValues[8]);
+   ASSURE(pvOld == &aiValues[8]);
+   iSuccessful = SymTable_put(oSymTable, "9", &aiValues[9]);
+   ASSURE(! iSuccessful);
+   ASSURE(uCountedValues == 0);
+
+   /* Each new binding evicts exactly one, never "0" which is looked
+      up before each put. */
+   for (i = CAPACITY; i < BINDING_COUNT; i++)
+   {
+      ASSURE(SymTable_get(oSymTable, "0") == &aiValues[0]);
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+      ASSURE(uCountedValues == (size_t)(i + 1 - CAPACITY));
+   }
+   ASSURE(aiValues[0] == 0);
+
+   /* What was evicted is gone, and the rest is still there. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey)
+         == (aiValues[i] != -1));
+   }
+
+   /* After a remove there is room again. */
+   pvOld = SymTable_remove(oSymTable, "0");
+   ASSURE(pvOld == &aiValues[0]);
+   uCountedValues = 0;
+   iSuccessful = SymTable_put(oSymTable, "0", &aiValues[0]);
+   ASSURE(iSuccessful);
+   ASSURE(uCountedValues == 0);
+   ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+
+   /* A cleared table fills up to the bound again. */
+   SymTable_clear(oSymTable, NULL);
+   for (i = 0; i < 2 * CAPACITY; i++)
+   {
+      aiValues[i] = i;
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(uCountedValues == CAPACITY);
+   ASSURE(SymTable_getLength(oSymTable) == CAPACITY);
+   SymTable_free(oSymTable);
+
+   /* Without an eviction function the values are just dropped, and a
+      table of one binding keeps the last one. */
+   oSymTable = SymTable_newBounded(1, NULL);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "a", &aiValues[1]);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "b", &aiValues[2]);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "b") == &aiValues[2]);
+   ASSURE(! SymTable_contains(oSymTable, "a"));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count in the size_t that pvExtra points to the keys pcKey that are
+   the string of their own SymAtom. */
+
+static void countInterned(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   SymAtom_T oAtom;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   oAtom = SymAtom_intern(pcKey);
+   ASSURE(oAtom != NULL);
+   if (oAtom != NULL && SymAtom_string(oAtom) == pcKey)
+      (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymAtoms, and interned SymTable objects sharing their keys, as
+   in a table of tables. */
+
+static void testAtoms(void)
+{
+   enum {TABLE_COUNT = 50};
+   enum {KEY_COUNT = 100};
+   enum {MAX_KEY_LENGTH = 16};
+
+   static SymTable_T aoTables[TABLE_COUNT];
+   static SymAtom_T aoAtoms[KEY_COUNT];
+   SymTable_T oSymTable;
+   SymAtom_T oAtom;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uInterned;
+   int iSuccessful;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymAtoms and interned SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An atom is found again from any copy of its string. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "atom%d", i);
+      aoAtoms[i] = SymAtom_intern(acKey);
+      ASSURE(aoAtoms[i] != NULL);
+      if (aoAtoms[i] == NULL)
+         return;
+      ASSURE(strcmp(SymAtom_string(aoAtoms[i]), acKey) == 0);
+      ASSURE(SymAtom_string(aoAtoms[i]) != acKey);
+   }
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "atom%d", i);
+      ASSURE(SymAtom_intern(acKey) == aoAtoms[i]);
+   }
+   ASSURE(aoAtoms[0] != aoAtoms[1]);
+   oAtom = SymAtom_intern("");
+   ASSURE(oAtom != NULL);
+   ASSURE(oAtom == SymAtom_intern(""));
+   ASSURE(SymAtom_hash(oAtom) == 0);
+
+   /* Every table holds every key, half put by atom and half by
+      string, and finds each both ways. */
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      aoTables[j] = SymTable_newWithAllocator(NULL, SYMTABLE_INTERNED);
+      ASSURE(aoTables[j] != NULL);
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         if (i % 2 == 0)
+            iSuccessful = SymTable_putAtom(aoTables[j], aoAtoms[i],
+               aoAtoms[i]);
+         else
+            iSuccessful = SymTable_put(aoTables[j],
+               SymAtom_string(aoAtoms[i]), aoAtoms[i]);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_putAtom(aoTables[j], aoAtoms[1],
+         aoAtoms[0]);
+      ASSURE(! iSuccessful);
+   }
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         ASSURE(SymTable_getAtom(aoTables[j], aoAtoms[i])
+            == aoAtoms[i]);
+         sprintf(acKey, "atom%d", i);
+         ASSURE(SymTable_get(aoTables[j], acKey) == aoAtoms[i]);
+      }
+      ASSURE(SymTable_getAtom(aoTables[j], oAtom) == NULL);
+      ASSURE(SymTable_getLength(aoTables[j]) == KEY_COUNT);
+   }
+
+   /* The keys are the strings of the atoms themselves, unless the
+      implementation copies keys anyway. */
+   uInterned = 0;
+   SymTable_map(aoTables[0], countInterned, &uInterned);
+   ASSURE(uInterned == 0 || uInterned == KEY_COUNT);
+
+   /* Removing and freeing leaves the atoms alone. */
+   ASSURE(SymTable_remove(aoTables[0], "atom3") == aoAtoms[3]);
+   ASSURE(SymTable_getAtom(aoTables[0], aoAtoms[3]) == NULL);
+   for (j = 0; j < TABLE_COUNT; j++)
+      SymTable_free(aoTables[j]);
+   ASSURE(strcmp(SymAtom_string(aoAtoms[3]), "atom3") == 0);
+
+   /* Atoms work with tables that copy their keys too. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      iSuccessful = SymTable_putAtom(oSymTable, aoAtoms[i], aoAtoms[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(SymTable_getAtom(oSymTable, aoAtoms[i]) == aoAtoms[i]);
+   uInterned = 0;
+   SymTable_map(oSymTable, countInterned, &uInterned);
+   ASSURE(uInterned == 0);
+   SymTable_free(oSymTable);
+
+   /* A hardened table hashes the keys its own way. */
+   oSymTable = SymTable_newWithAllocator(NULL,
+      SYMTABLE_INTERNED | SYMTABLE_HARDENED);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_putAtom(oSymTable, aoAtoms[0], NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_contains(oSymTable, "atom0"));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymKeys, each made once and then used in several SymTable
+   objects, mixed with lookups by string. */
+
+static void testKeys(void)
+{
+   enum {TABLE_COUNT = 4};
+   enum {KEY_COUNT = 200};
+   enum {MAX_KEY_LENGTH = 16};
+
+   static char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   static SymKey_T asKeys[KEY_COUNT];
+   SymTable_T aoTables[TABLE_COUNT];
+   SymKey_T sKey;
+   int iSuccessful;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymKeys.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* A key hashes as its atom does. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "key%d", i);
+      asKeys[i] = SymKey_make(aacKeys[i]);
+      ASSURE(asKeys[i].pcKey == aacKeys[i]);
+   }
+   ASSURE(asKeys[7].uHash == SymAtom_hash(SymAtom_intern("key7")));
+   sKey = SymKey_make("");
+   ASSURE(sKey.uHash == 0);
+
+   /* The same keys serve tables that are plain, filtered, hardened
+      and interned. */
+   aoTables[0] = SymTable_new();
+   aoTables[1] = SymTable_new();
+   aoTables[2] = SymTable_newWithAllocator(NULL, SYMTABLE_HARDENED);
+   aoTables[3] = SymTable_newWithAllocator(NULL, SYMTABLE_INTERNED);
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      ASSURE(aoTables[j] != NULL);
+      if (aoTables[j] == NULL)
+         return;
+   }
+   (void)SymTable_setFilter(aoTables[1], 1);
+
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         if (i % 2 == 0)
+            iSuccessful = SymTable_putK(aoTables[j], asKeys[i],
+               aacKeys[i]);
+         else
+            iSuccessful = SymTable_put(aoTables[j], aacKeys[i],
+               aacKeys[i]);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_putK(aoTables[j], asKeys[1], NULL);
+      ASSURE(! iSuccessful);
+      ASSURE(SymTable_getLength(aoTables[j]) == KEY_COUNT);
+   }
+
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         ASSURE(SymTable_getK(aoTables[j], asKeys[i]) == aacKeys[i]);
+         ASSURE(SymTable_containsK(aoTables[j], asKeys[i]));
+         ASSURE(SymTable_get(aoTables[j], aacKeys[i]) == aacKeys[i]);
+      }
+      ASSURE(SymTable_getK(aoTables[j], sKey) == NULL);
+      ASSURE(! SymTable_containsK(aoTables[j], sKey));
+   }
+
+   /* Removing by key and by string each see the other. */
+   for (j = 0; j < TABLE_COUNT; j++)
+   {
+      for (i = 0; i < KEY_COUNT; i += 3)
+         ASSURE(SymTable_removeK(aoTables[j], asKeys[i])
+            == aacKeys[i]);
+      ASSURE(SymTable_removeK(aoTables[j], asKeys[0]) == NULL);
+      ASSURE(SymTable_remove(aoTables[j], aacKeys[1]) == aacKeys[1]);
+      ASSURE(! SymTable_containsK(aoTables[j], asKeys[1]));
+      for (i = 2; i < KEY_COUNT; i++)
+         ASSURE(SymTable_containsK(aoTables[j], asKeys[i])
+            == (i % 3 != 0));
+   }
+
+   for (j = 0; j < TABLE_COUNT; j++)
+      SymTable_free(aoTables[j]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test nested scopes made with SymTable_newChild, looked up through
+   SymTable_lookupScoped. */
+
+static void testScopes(void)
+{
+   enum {GLOBAL_COUNT = 1000};
+   enum {LOCAL_COUNT = 20};
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oGlobal;
+   SymTable_T oHardened;
+   SymTable_T oOuter;
+   SymTable_T oInner;
+   char acKey[MAX_KEY_LENGTH];
+   char acGlobal[] = "global";
+   char acOuter[] = "outer";
+   char acInner[] = "inner";
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing scoped SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oGlobal = SymTable_new();
+   ASSURE(oGlobal != NULL);
+   if (oGlobal == NULL)
+      return;
+   for (i = 0; i < GLOBAL_COUNT; i++)
+   {
+      sprintf(acKey, "name%d", i);
+      iSuccessful = SymTable_put(oGlobal, acKey, acGlobal);
+      ASSURE(iSuccessful);
+   }
+
+   /* The outer scope is large enough to need buckets, the inner one
+      stays small, and both shadow some global names. */
+   oOuter = SymTable_newChild(oGlobal);
+   ASSURE(oOuter != NULL);
+   oInner = SymTable_newChild(oOuter);
+   ASSURE(oInner != NULL);
+   if (oOuter == NULL || oInner == NULL)
+      return;
+   for (i = 0; i < LOCAL_COUNT; i++)
+   {
+      sprintf(acKey, "name%d", i * 2);
+      iSuccessful = SymTable_put(oOuter, acKey, acOuter);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oInner, "name0", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oInner, "local", acInner);
+   ASSURE(iSuccessful);
+
+   ASSURE(SymTable_lookupScoped(oInner, "name0") == acInner);
+   ASSURE(SymTable_lookupScoped(oOuter, "name0") == acOuter);
+   ASSURE(SymTable_lookupScoped(oGlobal, "name0") == acGlobal);
+   ASSURE(SymTable_lookupScoped(oInner, "name2") == acOuter);
+   ASSURE(SymTable_lookupScoped(oInner, "name3") == acGlobal);
+   ASSURE(SymTable_lookupScoped(oInner, "local") == acInner);
+   ASSURE(SymTable_lookupScoped(oOuter, "local") == NULL);
+   ASSURE(SymTable_lookupScoped(oInner, "missing") == NULL);
+   for (i = 0; i < GLOBAL_COUNT; i++)
+   {
+      sprintf(acKey, "name%d", i);
+      ASSURE(SymTable_lookupScoped(oInner, acKey) != NULL);
+   }
+
+   /* The other functions see one scope only. */
+   ASSURE(SymTable_get(oInner, "name3") == NULL);
+   ASSURE(! SymTable_contains(oOuter, "name3"));
+   ASSURE(SymTable_getLength(oInner) == 2);
+
+   /* Leaving a scope uncovers the names it shadowed. */
+   SymTable_free(oInner);
+   ASSURE(SymTable_lookupScoped(oOuter, "name0") == acOuter);
+   ASSURE(SymTable_remove(oOuter, "name0") == acOuter);
+   ASSURE(SymTable_lookupScoped(oOuter, "name0") == acGlobal);
+   SymTable_free(oOuter);
+   ASSURE(SymTable_getLength(oGlobal) == GLOBAL_COUNT);
+
+   /* A hardened parent hashes keys its own way. */
+   oHardened = SymTable_newWithAllocator(NULL, SYMTABLE_HARDENED);
+   ASSURE(oHardened != NULL);
+   if (oHardened == NULL)
+      return;
+   for (i = 0; i < LOCAL_COUNT; i++)
+   {
+      sprintf(acKey, "name%d", i);
+      iSuccessful = SymTable_put(oHardened, acKey, acOuter);
+      ASSURE(iSuccessful);
+   }
+   oInner = SymTable_newChild(oHardened);
+   ASSURE(oInner != NULL);
+   if (oInner == NULL)
+      return;
+   for (i = 0; i < LOCAL_COUNT; i++)
+   {
+      sprintf(acKey, "inner%d", i);
+      iSuccessful = SymTable_put(oInner, acKey, acInner);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_lookupScoped(oInner, "name5") == acOuter);
+   ASSURE(SymTable_lookupScoped(oInner, "inner5") == acInner);
+   SymTable_free(oInner);
+   SymTable_free(oHardened);
+
+   SymTable_free(oGlobal);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object with its filter on, so that most lookups of
+   absent keys are answered by the filter, as it grows, shrinks and is
+   cleared. */
+
+static void testFilter(void)
+{
+   enum {BINDING_COUNT = 2000};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int iRound;
+   int i;
+   int iFound;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object with its filter on.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_setFilter(oSymTable, 0);
+   ASSURE(iSuccessful);
+   (void)SymTable_setFilter(oSymTable, 1);
+
+   for (iRound = 0; iRound < 2; iRound++)
+   {
+      for (i = 0; i < BINDING_COUNT; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+         ASSURE(iSuccessful);
+      }
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iFound = SymTable_contains(oSymTable, acKey);
+         ASSURE(iFound == (i % 2 == 0));
+         pcValue = (char*)SymTable_remove(oSymTable, acKey);
+         ASSURE(pcValue == ((i % 2 == 0) ? acValue : NULL));
+         if (i % 4 == 0)
+         {
+            iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+            ASSURE(iSuccessful);
+         }
+      }
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == ((i % 4 == 0) ? acValue : NULL));
+      }
+
+      SymTable_clear(oSymTable, NULL);
+      iFound = SymTable_contains(oSymTable, "0");
+      ASSURE(! iFound);
+   }
+
+   /* Turning the filter off keeps the bindings. */
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acValue);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_setFilter(oSymTable, 0);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acValue);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a hardened SymTable object holding iBindingCount bindings,
+   enough of them make some chains long enough to be searched as
+   trees. */
+
+static void testHardened(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int i;
+   int iFound;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a hardened SymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithAllocator(NULL, SYMTABLE_HARDENED);
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "0", acValue);
+   ASSURE(iBindingCount == 0 || ! iSuccessful);
+
+   /* Remove every other binding, then check them all. */
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue == acValue);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)(iBindingCount / 2));
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iFound = SymTable_contains(oSymTable, acKey);
+      ASSURE(iFound == (i % 2 == 1));
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue == ((i % 2 == 1) ? acValue : NULL));
+   }
+
+   /* The nodes that clear keeps are used again. */
+   SymTable_clear(oSymTable, NULL);
+   for (i = 0; i < iBindingCount; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iFound = SymTable_contains(oSymTable, acKey);
+      ASSURE(iFound == (i % 3 == 0));
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A Point is a small fixed-size value, as stored inline by a
+   SymTable made by SymTable_newSized. */
+
+struct Point
+{
+   long lX;
+   double dY;
+};
+
+/* Add the lX field of the Point pvValue to the sum *pvExtra. */
+
+static void sumPoint(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   *(long*)pvExtra += ((struct Point*)pvValue)->lX;
+}
+
+/* Test a SymTable object that stores its values inline, with enough
+   bindings to outgrow any small table representation. */
+
+static void testSized(void)
+{
+   enum {BINDING_COUNT = 100};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   struct Point sPoint;
+   struct Point *psPoint;
+   void **ppvSlot;
+   void *pvOld;
+   long lSum = 0;
+   int i;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object with inline values.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An implementation may not support inline values. */
+   oSymTable = SymTable_newSized(sizeof(struct Point));
+   if (oSymTable == NULL)
+      return;
+
+   /* The values are copied, so sPoint can be reused. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      sPoint.lX = i;
+      sPoint.dY = i / 2.0;
+      iSuccessful = SymTable_put(oSymTable, acKey, &sPoint);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      psPoint = (struct Point*)SymTable_get(oSymTable, acKey);
+      ASSURE(psPoint != NULL && psPoint != &sPoint);
+      ASSURE(psPoint->lX == i && psPoint->dY == i / 2.0);
+   }
+
+   /* Values can be changed in place. */
+   psPoint = (struct Point*)SymTable_get(oSymTable, "7");
+   psPoint->lX = 70;
+   psPoint = (struct Point*)SymTable_get(oSymTable, "7");
+   ASSURE(psPoint->lX == 70);
+
+   /* The old value is handed back as a copy. */
+   sPoint.lX = 8000;
+   pvOld = SymTable_replace(oSymTable, "8", &sPoint);
+   ASSURE(pvOld != NULL && ((struct Point*)pvOld)->lX == 8);
+   psPoint = (struct Point*)SymTable_get(oSymTable, "8");
+   ASSURE(psPoint->lX == 8000);
+
+   sPoint.lX = 9000;
+   iSuccessful = SymTable_upsert(oSymTable, "9", &sPoint, &pvOld);
+   ASSURE(iSuccessful == 0);
+   ASSURE(((struct Point*)pvOld)->lX == 9);
+   psPoint = (struct Point*)SymTable_get(oSymTable, "9");
+   ASSURE(psPoint->lX == 9000);
+
+   /* A NULL value stands for zeros. */
+   iSuccessful = SymTable_getOrPut(oSymTable, "new", NULL, &ppvSlot);
+   ASSURE(iSuccessful == 1);
+   psPoint = (struct Point*)*ppvSlot;
+   ASSURE(psPoint->lX == 0 && psPoint->dY == 0.0);
+   psPoint->lX = 5;
+
+   pvOld = SymTable_remove(oSymTable, "10");
+   ASSURE(pvOld != NULL && ((struct Point*)pvOld)->lX == 10);
+   ASSURE(! SymTable_contains(oSymTable, "10"));
+
+   /* 0 to 99 without 7, 8, 9 and 10, plus 70, 8000, 9000 and 5 */
+   SymTable_map(oSymTable, sumPoint, &lSum);
+   ASSURE(lSum == 4950 - 34 + 17075);
+
+   SymTable_clear(oSymTable, NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   sPoint.lX = 1;
+   iSuccessful = SymTable_put(oSymTable, "1", &sPoint);
+   ASSURE(iSuccessful);
+   psPoint = (struct Point*)SymTable_get(oSymTable, "1");
+   ASSURE(psPoint->lX == 1);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the string pvValue as its bytes, including the '\0', and
+   store their number in *puSize. */
+
+static const void *encodeString(const void *pvValue, size_t *puSize,
+   void *pvContext)
+{
+   assert(pvValue != NULL);
+   assert(puSize != NULL);
+
+   *puSize = strlen((const char*)pvValue) + 1;
+   return pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *ppvValue a copy of the string of uSize bytes, including
+   the '\0', at pvData. Return 1, or 0 if there is not enough
+   memory. */
+
+static int decodeString(const void *pvData, size_t uSize,
+   void **ppvValue, void *pvContext)
+{
+   assert(pvData != NULL);
+   assert(ppvValue != NULL);
+
+   *ppvValue = malloc(uSize);
+   if (*ppvValue == NULL)
+      return 0;
+   memcpy(*ppvValue, pvData, uSize);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the string pvValue. */
+
+static void freeString(void *pvValue, void *pvContext)
+{
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the string pvValue of the binding whose key is pcKey. */
+
+static void freeValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Recover a new SymTable object from the log at pcPath and check
+   that its binding with key "<i>", for each i below iCount, has value
+   apcExpected[i], where NULL means there is no binding. Free the
+   SymTable object and its values. */
+
+static void checkRecovered(const char *pcPath,
+   const struct SymTableLog_Codec *psCodec,
+   const char *apcExpected[], int iCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   SymTableLog_T oSymTableLog;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+   int iBindings = 0;
+   int iSuccessful;
+   size_t uLength;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oSymTableLog = SymTableLog_recover(oSymTable, pcPath, psCodec, 64);
+   ASSURE(oSymTableLog != NULL);
+
+   for (i = 0; i < iCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      if (apcExpected[i] == NULL)
+         ASSURE(pcValue == NULL);
+      else
+      {
+         ASSURE((pcValue != NULL) && (strcmp(pcValue, apcExpected[i])
+            == 0));
+         iBindings++;
+      }
+   }
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == (size_t)iBindings);
+
+   iSuccessful = SymTableLog_free(oSymTableLog);
+   ASSURE(iSuccessful);
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object whose changes are logged, by recovering its
+   bindings after changes, after a checkpoint, and after the log was
+   torn by a crash. */
+
+static void testLog(void)
+{
+   enum {BINDING_COUNT = 200};
+   enum {MAX_KEY_LENGTH = 10};
+
+   static const char *apcValues[] = {"Ruth", "Gehrig", "Mantle",
+      "Jeter"};
+   const char *pcPath = "testsymtable.tmp";
+   const char *apcExpected[BINDING_COUNT];
+   struct SymTableLog_Codec sCodec;
+   SymTable_T oSymTable;
+   SymTableLog_T oSymTableLog;
+   char acKey[MAX_KEY_LENGTH];
+   void *pvOld;
+   FILE *psFile;
+   int iPhase;
+   int iResult;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object whose changes are logged.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sCodec.pfEncode = encodeString;
+   sCodec.pfDecode = decodeString;
+   sCodec.pfFree = freeString;
+   sCodec.pvContext = NULL;
+
+   remove("testsymtable.tmp.snap");
+   remove("testsymtable.tmp.log");
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oSymTableLog = SymTableLog_recover(oSymTable, pcPath, &sCodec, 64);
+   ASSURE(oSymTableLog != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* Put every binding, then replace some and remove others, with a
+      checkpoint after the first phase. */
+   for (iPhase = 0; iPhase < 3; iPhase++)
+   {
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (iPhase == 0)
+         {
+            iResult = SymTableLog_put(oSymTableLog, acKey,
+               apcValues[i % 4]);
+            ASSURE(iResult == 1);
+            apcExpected[i] = apcValues[i % 4];
+         }
+         else if (i % 3 == iPhase)
+         {
+            iResult = SymTableLog_replace(oSymTableLog, acKey,
+               apcValues[(i + 1) % 4], &pvOld);
+            ASSURE(iResult == (apcExpected[i] != NULL));
+            if (iResult == 1)
+            {
+               ASSURE(pvOld == apcExpected[i]);
+               apcExpected[i] = apcValues[(i + 1) % 4];
+            }
+         }
+         else if (i % 5 == iPhase)
+         {
+            iResult = SymTableLog_remove(oSymTableLog, acKey, &pvOld);
+            ASSURE(iResult == (apcExpected[i] != NULL));
+            apcExpected[i] = NULL;
+         }
+      }
+      if (iPhase == 0)
+      {
+         iResult = SymTableLog_put(oSymTableLog, "0", apcValues[0]);
+         ASSURE(iResult == 0);
+         iResult = SymTableLog_checkpoint(oSymTableLog);
+         ASSURE(iResult);
+      }
+   }
+
+   iResult = SymTableLog_free(oSymTableLog);
+   ASSURE(iResult);
+   SymTable_free(oSymTable);
+
+   checkRecovered(pcPath, &sCodec, apcExpected, BINDING_COUNT);
+
+   /* A torn group at the end of the log is dropped. */
+   psFile = fopen("testsymtable.tmp.log", "ab");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      fwrite("\x20\0\0\0\0\0\0\0torn", 1, 12, psFile);
+      fclose(psFile);
+   }
+   checkRecovered(pcPath, &sCodec, apcExpected, BINDING_COUNT);
+
+   remove("testsymtable.tmp.snap");
+   remove("testsymtable.tmp.log");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table in shared memory, written through one handle and read
+   through another that maps the same object. */
+
+static void testShared(void)
+{
+   enum {BINDING_COUNT = 500};
+   enum {MAX_KEY_LENGTH = 12};
+
+   const char *pcName = "/testsymtable.shm";
+   SymTableShared_T oWriter;
+   SymTableShared_T oReader;
+   char acKey[MAX_KEY_LENGTH];
+   char acLong[100];
+   long lValue;
+   size_t uSize;
+   int iResult;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table in shared memory.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   (void)SymTableShared_unlink(pcName);
+
+   oWriter = SymTableShared_create(pcName, 262144);
+   ASSURE(oWriter != NULL);
+   if (oWriter == NULL)
+      return;
+   ASSURE(SymTableShared_create(pcName, 262144) == NULL);
+   oReader = SymTableShared_open(pcName);
+   ASSURE(oReader != NULL);
+   if (oReader == NULL)
+   {
+      SymTableShared_free(oWriter);
+      (void)SymTableShared_unlink(pcName);
+      return;
+   }
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      lValue = i;
+      iResult = SymTableShared_put(oWriter, acKey, &lValue,
+         sizeof(long));
+      ASSURE(iResult == 1);
+   }
+   iResult = SymTableShared_put(oWriter, "0", &lValue, sizeof(long));
+   ASSURE(iResult == 0);
+   ASSURE(SymTableShared_getLength(oReader) == BINDING_COUNT);
+
+   /* The reader sees every binding but cannot change them. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      lValue = -1;
+      iResult = SymTableShared_get(oReader, acKey, &lValue,
+         sizeof(long), &uSize);
+      ASSURE(iResult == 1);
+      ASSURE(lValue == i);
+      ASSURE(uSize == sizeof(long));
+   }
+   ASSURE(SymTableShared_get(oReader, "missing", NULL, 0, NULL) == 0);
+   ASSURE(SymTableShared_put(oReader, "new", &lValue, sizeof(long))
+      == -1);
+   ASSURE(SymTableShared_remove(oReader, "1") == -1);
+
+   /* Replace values in place and with larger ones, and remove
+      bindings. */
+   memset(acLong, 'x', sizeof(acLong));
+   acLong[sizeof(acLong) - 1] = '\0';
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      lValue = -i;
+      if (i % 3 == 0)
+         iResult = SymTableShared_replace(oWriter, acKey, &lValue,
+            sizeof(long));
+      else if (i % 3 == 1)
+         iResult = SymTableShared_replace(oWriter, acKey, acLong,
+            sizeof(acLong));
+      else
+         iResult = SymTableShared_remove(oWriter, acKey);
+      ASSURE(iResult == 1);
+   }
+   iResult = SymTableShared_replace(oWriter, "missing", &lValue,
+      sizeof(long));
+   ASSURE(iResult == 0);
+   ASSURE(SymTableShared_remove(oWriter, "2") == 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iResult = SymTableShared_get(oReader, acKey, acLong,
+         sizeof(acLong), &uSize);
+      ASSURE(iResult == (i % 3 != 2));
+      if (i % 3 == 0)
+      {
+         memcpy(&lValue, acLong, sizeof(long));
+         ASSURE(lValue == -i);
+         ASSURE(uSize == sizeof(long));
+      }
+      else if (i % 3 == 1)
+         ASSURE((uSize == sizeof(acLong)) && (strlen(acLong) == 99));
+   }
+
+   /* Fill the table, then make room by removing a binding. */
+   for (i = 0; ; i++)
+   {
+      sprintf(acKey, "f%d", i);
+      iResult = SymTableShared_put(oWriter, acKey, acLong,
+         sizeof(acLong));
+      if (iResult != 1)
+         break;
+   }
+   ASSURE(iResult == -1);
+   ASSURE(SymTableShared_remove(oWriter, "f0") == 1);
+   iResult = SymTableShared_put(oWriter, "f0", acLong, sizeof(acLong));
+   ASSURE(iResult == 1);
+   ASSURE(SymTableShared_get(oReader, "f0", NULL, 0, &uSize) == 1);
+   ASSURE(uSize == sizeof(acLong));
+
+   SymTableShared_free(oReader);
+   SymTableShared_free(oWriter);
+   ASSURE(SymTableShared_unlink(pcName));
+   ASSURE(SymTableShared_open(pcName) == NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {SHARED_KEYS = 100};
+
+/* Store in alValue and *puSize the value of key i of testSharedFork
+   for generation iGeneration: between 1 and 8 longs, all equal to a
+   number that tells the key and the generation apart. */
+
+static void makeSharedValue(long alValue[8], size_t *puSize, int i,
+   int iGeneration)
+{
+   size_t u;
+
+   *puSize = (size_t)(1 + (i + iGeneration) % 8);
+   for (u = 0; u < *puSize; u++)
+      alValue[u] = (long)i * 100000 + iGeneration;
+   *puSize *= sizeof(long);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Open the table named pcName and look its keys up until the key
+   "done" is bound, then exit with status 0 if every value found was
+   one that makeSharedValue gives for its key, and 1 otherwise. Tell
+   the parent through iReady that the table is open. */
+
+static void readSharedFork(const char *pcName, int iReady)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTableShared_T oReader;
+   char acKey[MAX_KEY_LENGTH];
+   long alValue[8];
+   long alExpected[8];
+   size_t uSize;
+   size_t uExpected;
+   int iFailed = 0;
+   int iDone = 0;
+   int i;
+
+   oReader = SymTableShared_open(pcName);
+   if ((oReader == NULL) || (write(iReady, "r", 1) != 1))
+      _exit(1);
+
+   while (! iDone)
+   {
+      iDone = SymTableShared_get(oReader, "done", NULL, 0, NULL);
+      for (i = 0; i < SHARED_KEYS; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (SymTableShared_get(oReader, acKey, alValue,
+            sizeof(alValue), &uSize) != 1)
+            continue;
+         if ((uSize == 0) || (uSize > sizeof(alValue))
+            || (alValue[0] / 100000 != i))
+         {
+            iFailed = 1;
+            continue;
+         }
+         makeSharedValue(alExpected, &uExpected, i,
+            (int)(alValue[0] % 100000));
+         if ((uSize != uExpected)
+            || (memcmp(alValue, alExpected, uSize) != 0))
+            iFailed = 1;
+      }
+   }
+
+   SymTableShared_free(oReader);
+   _exit(iFailed);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table in shared memory read by another process while this
+   one replaces, removes and puts its bindings again. */
+
+static void testSharedFork(void)
+{
+   enum {ROUND_COUNT = 20000};
+   enum {MAX_KEY_LENGTH = 16};
+
+   const char *pcName = "/testsymtable.fork.shm";
+   SymTableShared_T oWriter;
+   char acKey[MAX_KEY_LENGTH];
+   char acPresent[SHARED_KEYS];
+   long alValue[8];
+   size_t uSize;
+   int aiReady[2];
+   char cReady;
+   pid_t iPid;
+   int iStatus;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table in shared memory read by another\n");
+   printf("process while it changes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   (void)SymTableShared_unlink(pcName);
+   oWriter = SymTableShared_create(pcName, 262144);
+   ASSURE(oWriter != NULL);
+   if (oWriter == NULL)
+      return;
+   for (i = 0; i < SHARED_KEYS; i++)
+   {
+      sprintf(acKey, "%d", i);
+      makeSharedValue(alValue, &uSize, i, 0);
+      ASSURE(SymTableShared_put(oWriter, acKey, alValue, uSize) == 1);
+      acPresent[i] = 1;
+   }
+
+   ASSURE(pipe(aiReady) == 0);
+   iPid = fork();
+   ASSURE(iPid >= 0);
+   if (iPid == 0)
+   {
+      (void)close(aiReady[0]);
+      readSharedFork(pcName, aiReady[1]);
+   }
+   (void)close(aiReady[1]);
+   if ((iPid < 0) || (read(aiReady[0], &cReady, 1) != 1))
+   {
+      ASSURE(0);
+      (void)close(aiReady[0]);
+      SymTableShared_free(oWriter);
+      (void)SymTableShared_unlink(pcName);
+      return;
+   }
+   (void)close(aiReady[0]);
+
+   /* Values change size every generation, so that replacing them
+      alternates between copying in place and moving to a new node,
+      and removed nodes are reused by later ones. */
+   for (iRound = 1; iRound <= ROUND_COUNT; iRound++)
+      for (i = 0; i < SHARED_KEYS; i++)
+      {
+         sprintf(acKey, "%d", i);
+         makeSharedValue(alValue, &uSize, i, iRound);
+         if (! acPresent[i])
+         {
+            ASSURE(SymTableShared_put(oWriter, acKey, alValue, uSize)
+               == 1);
+            acPresent[i] = 1;
+         }
+         else if ((i + iRound) % 7 == 0)
+         {
+            ASSURE(SymTableShared_remove(oWriter, acKey) == 1);
+            acPresent[i] = 0;
+         }
+         else
+            ASSURE(SymTableShared_replace(oWriter, acKey, alValue,
+               uSize) == 1);
+      }
+   ASSURE(SymTableShared_put(oWriter, "done", NULL, 0) == 1);
+
+   ASSURE(waitpid(iPid, &iStatus, 0) == iPid);
+   ASSURE(WIFEXITED(iStatus) && (WEXITSTATUS(iStatus) == 0));
+
+   SymTableShared_free(oWriter);
+   ASSURE(SymTableShared_unlink(pcName));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object used through a flat combining front end. */
+
+static void testCombiner(void)
+{
+   enum {BINDING_COUNT = 100};
+   enum {MAX_KEY_LENGTH = 10};
+
+   static char acValue[] = "value";
+   SymTable_T oSymTable;
+   SymTableCombiner_T oCombiner;
+   char acKey[MAX_KEY_LENGTH];
+   int iResult;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object behind a combiner.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+   oCombiner = SymTableCombiner_new(oSymTable);
+   ASSURE(oCombiner != NULL);
+   if (oCombiner == NULL)
+   {
+      SymTable_free(oSymTable);
+      return;
+   }
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iResult = SymTableCombiner_put(oCombiner, acKey, acValue);
+      ASSURE(iResult == 1);
+   }
+   iResult = SymTableCombiner_put(oCombiner, "0", acValue);
+   ASSURE(iResult == 0);
+
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTableCombiner_remove(oCombiner, acKey) == acValue);
+      ASSURE(SymTableCombiner_remove(oCombiner, acKey) == NULL);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTableCombiner_get(oCombiner, acKey)
+         == ((i % 2 == 0) ? NULL : acValue));
+   }
+
+   SymTableCombiner_free(oCombiner);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT / 2);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {COMBINER_THREADS = 4};
+enum {COMBINER_KEYS = 2000};
+
+/* A thread of testCombinerThreads: the combiner it goes through, its
+   index, the values of its keys, and the number of its operations
+   that returned what they should. */
+
+struct CombinerThread
+{
+   SymTableCombiner_T oCombiner;
+   int iIndex;
+   int aiValues[COMBINER_KEYS];
+   int iCorrect;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Put, get and remove the keys of the CombinerThread pvThread, which
+   no other thread uses, through its combiner, counting the results
+   that are right. Ends with the keys whose number is odd bound. */
+
+static void *runCombinerThread(void *pvThread)
+{
+   enum {MAX_KEY_LENGTH = 24};
+
+   struct CombinerThread *psThread = (struct CombinerThread*)pvThread;
+   char acKey[MAX_KEY_LENGTH];
+   void *pvValue;
+   int i;
+
+   for (i = 0; i < COMBINER_KEYS; i++)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      psThread->iCorrect += SymTableCombiner_put(psThread->oCombiner,
+         acKey, &psThread->aiValues[i]) == 1;
+      psThread->iCorrect += SymTableCombiner_put(psThread->oCombiner,
+         acKey, &psThread->aiValues[0]) == 0;
+   }
+   for (i = 0; i < COMBINER_KEYS; i++)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      pvValue = SymTableCombiner_get(psThread->oCombiner, acKey);
+      psThread->iCorrect += pvValue == &psThread->aiValues[i];
+      if (i % 2 == 0)
+      {
+         pvValue = SymTableCombiner_remove(psThread->oCombiner, acKey);
+         psThread->iCorrect += pvValue == &psThread->aiValues[i];
+         pvValue = SymTableCombiner_remove(psThread->oCombiner, acKey);
+         psThread->iCorrect += pvValue == NULL;
+      }
+   }
+   for (i = 0; i < COMBINER_KEYS; i++)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      pvValue = SymTableCombiner_get(psThread->oCombiner, acKey);
+      psThread->iCorrect += pvValue
+         == ((i % 2 == 0) ? NULL : &psThread->aiValues[i]);
+   }
+
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object used by several threads at once through a
+   flat combining front end, so that threads apply the operations of
+   others. */
+
+static void testCombinerThreads(void)
+{
+   static struct CombinerThread asThreads[COMBINER_THREADS];
+   SymTable_T oSymTable;
+   SymTableCombiner_T oCombiner;
+   pthread_t aThreads[COMBINER_THREADS];
+   int aiStarted[COMBINER_THREADS];
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object behind a combiner used by\n");
+   printf("many threads at once.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+   oCombiner = SymTableCombiner_new(oSymTable);
+   ASSURE(oCombiner != NULL);
+   if (oCombiner == NULL)
+   {
+      SymTable_free(oSymTable);
+      return;
+   }
+
+   for (i = 0; i < COMBINER_THREADS; i++)
+   {
+      asThreads[i].oCombiner = oCombiner;
+      asThreads[i].iIndex = i;
+      asThreads[i].iCorrect = 0;
+      aiStarted[i] = pthread_create(&aThreads[i], NULL,
+         runCombinerThread, &asThreads[i]) == 0;
+      ASSURE(aiStarted[i]);
+   }
+   for (i = 0; i < COMBINER_THREADS; i++)
+      if (aiStarted[i])
+      {
+         pthread_join(aThreads[i], NULL);
+         /* two puts and a get for every key, two removes for half of
+            them, and a last get */
+         ASSURE(asThreads[i].iCorrect == COMBINER_KEYS * 5);
+      }
+
+   SymTableCombiner_free(oCombiner);
+   ASSURE(SymTable_getLength(oSymTable)
+      == (size_t)(COMBINER_THREADS * (COMBINER_KEYS / 2)));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifdef TEST_CUCKOO
+enum {CONCURRENT_WRITERS = 4};
+enum {CONCURRENT_READERS = 4};
+enum {CONCURRENT_KEYS = 2000};
+
+/* The state shared by the threads of testConcurrent: the table, the
+   two values each key may be bound to, and the number of writers
+   that are not done yet. */
+
+struct Concurrent
+{
+   SymTable_T oSymTable;
+   int aaiFirst[CONCURRENT_WRITERS][CONCURRENT_KEYS];
+   int aaiSecond[CONCURRENT_WRITERS][CONCURRENT_KEYS];
+   int iWritersLeft;
+};
+
+/* A thread of testConcurrent: the shared state and the index of the
+   thread among the writers or the readers. */
+
+struct ConcurrentThread
+{
+   struct Concurrent *psShared;
+   int iIndex;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Put, replace and remove the keys of the writer pvThread, which no
+   other thread writes, checking every result. Key i ends up bound to
+   its first value if i % 4 == 0, to its second value if i % 4 is 1
+   or 2, and unbound if i % 4 == 3. */
+
+static void *writeConcurrent(void *pvThread)
+{
+   enum {MAX_KEY_LENGTH = 24};
+
+   struct ConcurrentThread *psThread =
+      (struct ConcurrentThread*)pvThread;
+   struct Concurrent *psShared = psThread->psShared;
+   int *piFirst = psShared->aaiFirst[psThread->iIndex];
+   int *piSecond = psShared->aaiSecond[psThread->iIndex];
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   for (i = 0; i < CONCURRENT_KEYS; i++)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      ASSURE(SymTable_put(psShared->oSymTable, acKey, &piFirst[i]));
+      ASSURE(SymTable_get(psShared->oSymTable, acKey) == &piFirst[i]);
+   }
+   for (i = 0; i < CONCURRENT_KEYS; i++)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      if (i % 4 == 2)
+         ASSURE(SymTable_replace(psShared->oSymTable, acKey,
+            &piSecond[i]) == &piFirst[i]);
+      else if (i % 2 == 1)
+      {
+         ASSURE(SymTable_remove(psShared->oSymTable, acKey)
+            == &piFirst[i]);
+         ASSURE(! SymTable_contains(psShared->oSymTable, acKey));
+      }
+   }
+   for (i = 1; i < CONCURRENT_KEYS; i += 4)
+   {
+      sprintf(acKey, "%d.%d", psThread->iIndex, i);
+      ASSURE(SymTable_put(psShared->oSymTable, acKey, &piSecond[i]));
+      ASSURE(SymTable_get(psShared->oSymTable, acKey)
+         == &piSecond[i]);
+   }
+
+   (void)__atomic_sub_fetch(&psShared->iWritersLeft, 1,
+      __ATOMIC_RELEASE);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up keys of all writers in a pseudo-random order until every
+   writer is done, checking that each key is unbound or bound to a
+   value its writer stored for it. */
+
+static void *readConcurrent(void *pvThread)
+{
+   enum {MAX_KEY_LENGTH = 24};
+
+   struct ConcurrentThread *psThread =
+      (struct ConcurrentThread*)pvThread;
+   struct Concurrent *psShared = psThread->psShared;
+   unsigned long ulRandom = (unsigned long)psThread->iIndex + 1;
+   char acKey[MAX_KEY_LENGTH];
+   void *pvValue;
+   int iWriter;
+   int i;
+
+   while (__atomic_load_n(&psShared->iWritersLeft, __ATOMIC_ACQUIRE)
+      > 0)
+   {
+      ulRandom = (ulRandom * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      iWriter = (int)((ulRandom >> 8) % CONCURRENT_WRITERS);
+      i = (int)((ulRandom >> 12) % CONCURRENT_KEYS);
+      sprintf(acKey, "%d.%d", iWriter, i);
+      pvValue = SymTable_get(psShared->oSymTable, acKey);
+      ASSURE((pvValue == NULL)
+         || (pvValue == &psShared->aaiFirst[iWriter][i])
+         || ((pvValue == &psShared->aaiSecond[iWriter][i])
+            && (i % 4 == 1 || i % 4 == 2)));
+   }
+
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a cuckoo SymTable object written by several threads while
+   several others read it, growing it many times over on the way. */
+
+static void testConcurrent(void)
+{
+   enum {MAX_KEY_LENGTH = 24};
+
+   static struct Concurrent sShared;
+   struct ConcurrentThread asThreads[CONCURRENT_WRITERS
+      + CONCURRENT_READERS];
+   pthread_t aThreads[CONCURRENT_WRITERS + CONCURRENT_READERS];
+   int aiStarted[CONCURRENT_WRITERS + CONCURRENT_READERS];
+   char acKey[MAX_KEY_LENGTH];
+   void *pvValue;
+   int iWriter;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object used by many threads at once.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sShared.oSymTable = SymTable_new();
+   ASSURE(sShared.oSymTable != NULL);
+   if (sShared.oSymTable == NULL)
+      return;
+   sShared.iWritersLeft = CONCURRENT_WRITERS;
+
+   /* Start the readers first, so that they overlap every put. */
+   for (i = CONCURRENT_WRITERS + CONCURRENT_READERS - 1; i >= 0; i--)
+   {
+      asThreads[i].psShared = &sShared;
+      asThreads[i].iIndex = (i < CONCURRENT_WRITERS) ? i
+         : i - CONCURRENT_WRITERS;
+      aiStarted[i] = pthread_create(&aThreads[i], NULL,
+         (i < CONCURRENT_WRITERS) ? writeConcurrent : readConcurrent,
+         &asThreads[i]) == 0;
+      ASSURE(aiStarted[i]);
+      if ((! aiStarted[i]) && (i < CONCURRENT_WRITERS))
+         (void)__atomic_sub_fetch(&sShared.iWritersLeft, 1,
+            __ATOMIC_RELEASE);
+   }
+   for (i = 0; i < CONCURRENT_WRITERS + CONCURRENT_READERS; i++)
+      if (aiStarted[i])
+         pthread_join(aThreads[i], NULL);
+
+   ASSURE(SymTable_getLength(sShared.oSymTable)
+      == (size_t)(CONCURRENT_WRITERS * (CONCURRENT_KEYS / 4 * 3)));
+   for (iWriter = 0; iWriter < CONCURRENT_WRITERS; iWriter++)
+      for (i = 0; i < CONCURRENT_KEYS; i++)
+      {
+         sprintf(acKey, "%d.%d", iWriter, i);
+         pvValue = SymTable_get(sShared.oSymTable, acKey);
+         if (i % 4 == 0)
+            ASSURE(pvValue == &sShared.aaiFirst[iWriter][i]);
+         else if (i % 4 == 3)
+            ASSURE(pvValue == NULL);
+         else
+            ASSURE(pvValue == &sShared.aaiSecond[iWriter][i]);
+      }
+
+   SymTable_free(sShared.oSymTable);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The state of a visit of the bindings of a SymTableFrozen object:
+   the last key seen and the number of bindings seen. */
+
+struct FrozenVisit
+{
+   char acLast[20];
+   int iCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Check that pcKey comes after the last key seen by the FrozenVisit
+   pvVisit and that pvValue is the value it was bound to, and count
+   the binding. */
+
+static void visitFrozen(const char *pcKey, void *pvValue, void *pvVisit)
+{
+   struct FrozenVisit *psVisit = (struct FrozenVisit*)pvVisit;
+
+   assert(pcKey != NULL);
+   assert(pvVisit != NULL);
+
+   ASSURE((psVisit->iCount == 0)
+      || (strcmp(psVisit->acLast, pcKey) < 0));
+   ASSURE((pvValue != NULL) && (strcmp((char*)pvValue, pcKey) == 0));
+   if (strlen(pcKey) < sizeof(psVisit->acLast))
+      strcpy(psVisit->acLast, pcKey);
+   psVisit->iCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTableFrozen object made from a SymTable object, looking
+   keys up and visiting them in order and by prefix. */
+
+static void testFrozen(void)
+{
+   enum {BINDING_COUNT = 1000};
+   enum {MAX_KEY_LENGTH = 10};
+
+   static const char *apcAbsent[] = {"", "-", "00", "1000", "12a",
+      "5 ", "999x", "a"};
+   SymTable_T oSymTable;
+   SymTableFrozen_T oFrozen;
+   struct FrozenVisit sVisit;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   size_t u;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTableFrozen object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])malloc(BINDING_COUNT
+      * MAX_KEY_LENGTH);
+   ASSURE(pacKeys != NULL);
+   if (pacKeys == NULL)
+      return;
+
+   /* Freeze an empty table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oFrozen = SymTableFrozen_new(oSymTable);
+   ASSURE(oFrozen != NULL);
+   ASSURE(SymTableFrozen_getLength(oFrozen) == 0);
+   ASSURE(SymTableFrozen_get(oFrozen, "0") == NULL);
+   sVisit.iCount = 0;
+   ASSURE(SymTableFrozen_map(oFrozen, "", visitFrozen, &sVisit));
+   ASSURE(sVisit.iCount == 0);
+   SymTableFrozen_free(oFrozen);
+
+   /* Each key is bound to itself, in a table that outlives the
+      frozen one so that the values stay valid. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   oFrozen = SymTableFrozen_new(oSymTable);
+   ASSURE(oFrozen != NULL);
+   if (oFrozen == NULL)
+   {
+      SymTable_free(oSymTable);
+      free(pacKeys);
+      return;
+   }
+   ASSURE(SymTableFrozen_getLength(oFrozen) == BINDING_COUNT);
+   ASSURE(SymTableFrozen_getSize(oFrozen) > 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      ASSURE(SymTableFrozen_get(oFrozen, pacKeys[i]) == pacKeys[i]);
+      ASSURE(SymTableFrozen_contains(oFrozen, pacKeys[i]));
+   }
+   for (u = 0; u < sizeof(apcAbsent) / sizeof(apcAbsent[0]); u++)
+   {
+      ASSURE(SymTableFrozen_get(oFrozen, apcAbsent[u]) == NULL);
+      ASSURE(! SymTableFrozen_contains(oFrozen, apcAbsent[u]));
+   }
+
+   sVisit.iCount = 0;
+   ASSURE(SymTableFrozen_map(oFrozen, "", visitFrozen, &sVisit));
+   ASSURE(sVisit.iCount == BINDING_COUNT);
+   sVisit.iCount = 0;
+   ASSURE(SymTableFrozen_map(oFrozen, "12", visitFrozen, &sVisit));
+   ASSURE(sVisit.iCount == 11);
+   sVisit.iCount = 0;
+   ASSURE(SymTableFrozen_map(oFrozen, "999", visitFrozen, &sVisit));
+   ASSURE(sVisit.iCount == 1);
+   sVisit.iCount = 0;
+   ASSURE(SymTableFrozen_map(oFrozen, "a", visitFrozen, &sVisit));
+   ASSURE(sVisit.iCount == 0);
+
+   SymTableFrozen_free(oFrozen);
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the length of the key pcKey to the count that pvExtra points
+   to. */
+
+static void countSetKey(const char *pcKey, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   *(size_t*)pvExtra += strlen(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymSet ADT, with enough elements to make it grow. */
+
+static void testSymSet(void)
+{
+   enum {ELEMENT_COUNT = 2000};
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymSet_T oEven;
+   SymSet_T oThree;
+   SymSet_T oUnion;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uLengths;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymSet object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oEven = SymSet_new();
+   ASSURE(oEven != NULL);
+   oThree = SymSet_new();
+   ASSURE(oThree != NULL);
+   if (oEven == NULL || oThree == NULL)
+      return;
+
+   ASSURE(SymSet_getLength(oEven) == 0);
+   ASSURE(! SymSet_contains(oEven, ""));
+   ASSURE(! SymSet_remove(oEven, ""));
+   ASSURE(SymSet_add(oEven, ""));
+   ASSURE(! SymSet_add(oEven, ""));
+   ASSURE(SymSet_contains(oEven, ""));
+   ASSURE(SymSet_remove(oEven, ""));
+   ASSURE(SymSet_getLength(oEven) == 0);
+
+   /* The keys are copied, so acKey can be reused. */
+   for (i = 0; i < ELEMENT_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 2 == 0)
+         ASSURE(SymSet_add(oEven, acKey));
+      if (i % 3 == 0)
+         ASSURE(SymSet_add(oThree, acKey));
+   }
+   ASSURE(SymSet_getLength(oEven) == ELEMENT_COUNT / 2);
+   ASSURE(SymSet_getLength(oThree) == (ELEMENT_COUNT + 2) / 3);
+   for (i = 0; i < ELEMENT_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymSet_contains(oEven, acKey) == (i % 2 == 0));
+      ASSURE(SymSet_contains(oThree, acKey) == (i % 3 == 0));
+   }
+   ASSURE(! SymSet_contains(oEven, "a"));
+
+   uLengths = 0;
+   SymSet_map(oEven, countSetKey, &uLengths);
+   ASSURE(uLengths == 1 * 5 + 2 * 45 + 3 * 450 + 4 * 500);
+
+   /* The union of the multiples of 2 and 3. */
+   oUnion = SymSet_new();
+   ASSURE(oUnion != NULL);
+   if (oUnion != NULL)
+   {
+      ASSURE(SymSet_union(oUnion, oEven));
+      ASSURE(SymSet_union(oUnion, oThree));
+      ASSURE(SymSet_union(oUnion, oUnion));
+      ASSURE(SymSet_getLength(oUnion) == ELEMENT_COUNT * 2 / 3);
+      for (i = 0; i < ELEMENT_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymSet_contains(oUnion, acKey)
+            == (i % 2 == 0 || i % 3 == 0));
+      }
+      SymSet_free(oUnion);
+   }
+
+   /* The intersection, the multiples of 6. */
+   SymSet_intersect(oEven, oThree);
+   ASSURE(SymSet_getLength(oEven) == (ELEMENT_COUNT + 5) / 6);
+   for (i = 0; i < ELEMENT_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymSet_contains(oEven, acKey) == (i % 6 == 0));
+   }
+   SymSet_intersect(oEven, oEven);
+   ASSURE(SymSet_getLength(oEven) == (ELEMENT_COUNT + 5) / 6);
+
+   for (i = 0; i < ELEMENT_COUNT; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymSet_remove(oThree, acKey));
+      ASSURE(! SymSet_remove(oThree, acKey));
+   }
+   ASSURE(SymSet_getLength(oThree) == 0);
+   SymSet_intersect(oEven, oThree);
+   ASSURE(SymSet_getLength(oEven) == 0);
+
+   SymSet_free(oEven);
+   SymSet_free(oThree);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate uSize bytes with malloc and add them to the count of
+   outstanding bytes that pvContext points to. */
+
+static void *countingAlloc(size_t uSize, void *pvContext)
+{
+   assert(pvContext != NULL);
+
+   *(size_t*)pvContext += uSize;
+   return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the block pvBlock of uSize bytes and take them off the count of
+   outstanding bytes that pvContext points to. */
+
+static void countingFree(void *pvBlock, size_t uSize, void *pvContext)
+{
+   assert(pvContext != NULL);
+
+   *(size_t*)pvContext -= uSize;
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects that take their memory from a custom
+   allocator, with and without an arena. */
+
+static void testAllocator(void)
+{
+   enum {BINDING_COUNT = 1000};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTable_Allocator sAllocator;
+   size_t uOutstanding = 0;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int iFlags;
+   int i;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects with a custom allocator.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sAllocator.pfAlloc = countingAlloc;
+   sAllocator.pfFree = countingFree;
+   sAllocator.pvContext = &uOutstanding;
+
+   for (iFlags = 0; iFlags <= SYMTABLE_ARENA; iFlags++)
+   {
+      oSymTable = SymTable_newWithAllocator(&sAllocator, iFlags);
+      ASSURE(oSymTable != NULL);
+      ASSURE(uOutstanding > 0);
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+         ASSURE(iSuccessful);
+      }
+      for (i = 0; i < BINDING_COUNT; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_remove(oSymTable, acKey);
+         ASSURE(pcValue == acValue);
+      }
+      for (i = 1; i < BINDING_COUNT; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == acValue);
+      }
+
+      SymTable_free(oSymTable);
+      ASSURE(uOutstanding == 0);
+   }
+
+   /* A NULL allocator means malloc and free. */
+   oSymTable = SymTable_newWithAllocator(NULL, SYMTABLE_ARENA);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acValue);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE(pcValue == acValue);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects backed by huge pages, with and without an
+   arena, holding iBindingCount bindings and one key long enough to be
+   mapped on its own. The custom allocator must get back all it gave
+   out, even though the large blocks do not come from it. */
+
+static void testHugePages(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 16};
+   enum {LONG_KEY_LENGTH = 300000};
+
+   SymTable_T oSymTable;
+   struct SymTable_Allocator sAllocator;
+   size_t uOutstanding = 0;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcLongKey;
+   char *pcValue;
+   int iFlags;
+   int i;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects backed by huge pages.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sAllocator.pfAlloc = countingAlloc;
+   sAllocator.pfFree = countingFree;
+   sAllocator.pvContext = &uOutstanding;
+
+   pcLongKey = (char*)malloc(LONG_KEY_LENGTH + 1);
+   ASSURE(pcLongKey != NULL);
+   if (pcLongKey == NULL)
+      return;
+   memset(pcLongKey, 'x', LONG_KEY_LENGTH);
+   pcLongKey[LONG_KEY_LENGTH] = '\0';
+
+   for (iFlags = SYMTABLE_HUGEPAGES;
+        iFlags <= (SYMTABLE_HUGEPAGES | SYMTABLE_ARENA); iFlags++)
+   {
+      oSymTable = SymTable_newWithAllocator(&sAllocator, iFlags);
+      ASSURE(oSymTable != NULL);
+
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_put(oSymTable, pcLongKey, acValue);
+      ASSURE(iSuccessful);
+
+      for (i = 0; i < iBindingCount; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_remove(oSymTable, acKey);
+         ASSURE(pcValue == acValue);
+      }
+      for (i = 1; i < iBindingCount; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == acValue);
+      }
+      pcValue = (char*)SymTable_remove(oSymTable, pcLongKey);
+      ASSURE(pcValue == acValue);
+
+      SymTable_free(oSymTable);
+      ASSURE(uOutstanding == 0);
+   }
+
+   free(pcLongKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Fill a SymTable object made with psAllocator and iFlags, or an
+   ordinary one if iFlags is -1, with iBindingCount bindings, some of
+   them removed again, and return it. */
+
+static SymTable_T makeFreeable(int iBindingCount,
+   const struct SymTable_Allocator *psAllocator, int iFlags)
+{
+   enum {MAX_KEY_LENGTH = 16};
+
+   static char acValue[] = "value";
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   if (iFlags < 0)
+      oSymTable = SymTable_new();
+   else
+      oSymTable = SymTable_newWithAllocator(psAllocator, iFlags);
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      exit(EXIT_FAILURE);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < iBindingCount; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+   }
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test freeing SymTable objects on a background thread and on
+   several threads at once. */
+
+static void testFreeAsync(int iBindingCount)
+{
+   SymTable_T oSymTable;
+   struct SymTable_Allocator sAllocator;
+   size_t uOutstanding = 0;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects freed on other threads.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sAllocator.pfAlloc = countingAlloc;
+   sAllocator.pfFree = countingFree;
+   sAllocator.pvContext = &uOutstanding;
+
+   SymTable_freeAsync(makeFreeable(iBindingCount, NULL, -1));
+   SymTable_freeAsync(makeFreeable(10, NULL, -1));
+   SymTable_freeAsync(makeFreeable(iBindingCount, NULL,
+      SYMTABLE_ARENA));
+   SymTable_freeParallel(makeFreeable(iBindingCount, NULL, -1), 0);
+   SymTable_freeParallel(makeFreeable(iBindingCount, NULL, -1), 3);
+   SymTable_freeParallel(makeFreeable(iBindingCount, NULL,
+      SYMTABLE_HARDENED | SYMTABLE_HUGEPAGES), 2);
+   SymTable_freeParallel(SymTable_new(), 4);
+
+   oSymTable = SymTable_newSized(sizeof(double));
+   if (oSymTable != NULL)
+      SymTable_freeParallel(oSymTable, 2);
+
+   /* A custom allocator is only called from the calling thread, so
+      everything is given back on return. */
+   SymTable_freeAsync(makeFreeable(iBindingCount, &sAllocator, 0));
+   ASSURE(uOutstanding == 0);
+   SymTable_freeParallel(makeFreeable(iBindingCount, &sAllocator, 0),
+      2);
+   ASSURE(uOutstanding == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTable object as it grows from a handful of bindings to
+   a few dozen and shrinks back, so that an implementation that
+   changes representation as it grows is exercised across the change
+   in both directions. */
+
+static void testGrowth(void)
+{
+   enum {BINDING_COUNT = 40};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int i;
+   int j;
+   int iFound;
+   int iSuccessful;
+   size_t uLength;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object that grows and shrinks.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "k%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &acValue[i % 5]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(! iSuccessful);
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == (size_t)(i + 1));
+
+      /* Every binding put so far must still be found. */
+      for (j = 0; j <= i; j++)
+      {
+         sprintf(acKey, "k%d", j);
+         pcValue = (char*)SymTable_get(oSymTable, acKey);
+         ASSURE(pcValue == &acValue[j % 5]);
+      }
+   }
+
+   pcValue = (char*)SymTable_replace(oSymTable, "k4", acValue);
+   ASSURE(pcValue == &acValue[4]);
+   pcValue = (char*)SymTable_get(oSymTable, "k4");
+   ASSURE(pcValue == acValue);
+
+   for (i = BINDING_COUNT - 1; i >= 0; i -= 2)
+   {
+      sprintf(acKey, "k%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue == &acValue[i % 5]);
+      iFound = SymTable_contains(oSymTable, acKey);
+      ASSURE(! iFound);
+   }
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT / 2);
+
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "k%d", i);
+      iFound = SymTable_contains(oSymTable, acKey);
+      ASSURE(iFound);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+#if defined(TEST_ROBINHOOD) || defined(TEST_ORDERED)
+/* The values of the bindings visited by SymTable_map, in the order in
+   which they were visited. */
+
+struct MapOrder
+{
+   void *apvValues[64];
+   int iCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Append pvValue to the MapOrder pvOrder. */
+
+static void visitInOrder(const char *pcKey, void *pvValue,
+   void *pvOrder)
+{
+   struct MapOrder *psOrder = (struct MapOrder*)pvOrder;
+
+   assert(pcKey != NULL);
+   assert(pvOrder != NULL);
+
+   if (psOrder->iCount < (int)(sizeof(psOrder->apvValues)
+      / sizeof(psOrder->apvValues[0])))
+      psOrder->apvValues[psOrder->iCount] = pvValue;
+   psOrder->iCount++;
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef TEST_ROBINHOOD
+/* Return the home slot of pcKey in a Robin Hood slot array of 8
+   slots, computed as symtablerobinhood.c does. */
+
+static size_t robinHoodHome(const char *pcKey)
+{
+   size_t uHash = 0;
+   size_t u;
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * 65599 + (size_t)pcKey[u];
+   uHash ^= uHash >> 16;
+   uHash *= 0x45d9f3b;
+   uHash ^= uHash >> 16;
+
+   return uHash & 7;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a Robin Hood SymTable object only displaces a binding for
+   one that is further from its home slot. Keys A and N have home
+   slot h, and keys B and C have home slot h + 1. After A, B and C,
+   the slots from h on hold A, B, C. N then takes the slot of B,
+   which must go on probing from its own distance and so pass C,
+   which is as far from home as B would be, leaving A, N, C, B. This
+   test assumes that the first put allocates 8 slots, that
+   SymTable_map visits the slots in order, and that the
+   implementation uses the hash function of symtablerobinhood.c. */
+
+static void testRobinHood(void)
+{
+   enum {KEY_COUNT = 200};
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   struct MapOrder sOrder;
+   char acKey[MAX_KEY_LENGTH];
+   char aacKeys[4][MAX_KEY_LENGTH];
+   int aiFound[2];
+   int aiValues[4];
+   int iHome;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the displacement of Robin Hood bindings.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Find two keys for a home slot h of at most 4, so that the
+      cluster does not wrap around, and two for h + 1. */
+   for (iHome = 0; iHome <= 4; iHome++)
+   {
+      aiFound[0] = aiFound[1] = 0;
+      for (i = 0; (i < KEY_COUNT) && (aiFound[0] + aiFound[1] < 4);
+         i++)
+      {
+         sprintf(acKey, "%d", i);
+         j = (int)robinHoodHome(acKey) - iHome;
+         if ((j == 0 || j == 1) && (aiFound[j] < 2))
+         {
+            sprintf(aacKeys[2 * j + aiFound[j]], "%d", i);
+            aiFound[j]++;
+         }
+      }
+      if (aiFound[0] + aiFound[1] == 4)
+         break;
+   }
+   ASSURE(iHome <= 4);
+   if (iHome > 4)
+      return;
+
+   /* Keys 0 and 1 are A and N, keys 2 and 3 are B and C. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+   ASSURE(SymTable_put(oSymTable, aacKeys[0], &aiValues[0]));
+   ASSURE(SymTable_put(oSymTable, aacKeys[2], &aiValues[2]));
+   ASSURE(SymTable_put(oSymTable, aacKeys[3], &aiValues[3]));
+   ASSURE(SymTable_put(oSymTable, aacKeys[1], &aiValues[1]));
+
+   sOrder.iCount = 0;
+   SymTable_map(oSymTable, visitInOrder, &sOrder);
+   ASSURE(sOrder.iCount == 4);
+   ASSURE(sOrder.apvValues[0] == &aiValues[0]);
+   ASSURE(sOrder.apvValues[1] == &aiValues[1]);
+   ASSURE(sOrder.apvValues[2] == &aiValues[3]);
+   ASSURE(sOrder.apvValues[3] == &aiValues[2]);
+   for (i = 0; i < 4; i++)
+      ASSURE(SymTable_get(oSymTable, aacKeys[i]) == &aiValues[i]);
+
+   /* Removing N shifts C and B back by one slot. */
+   ASSURE(SymTable_remove(oSymTable, aacKeys[1]) == &aiValues[1]);
+   sOrder.iCount = 0;
+   SymTable_map(oSymTable, visitInOrder, &sOrder);
+   ASSURE(sOrder.iCount == 3);
+   ASSURE(sOrder.apvValues[0] == &aiValues[0]);
+   ASSURE(sOrder.apvValues[1] == &aiValues[3]);
+   ASSURE(sOrder.apvValues[2] == &aiValues[2]);
+   ASSURE(SymTable_get(oSymTable, aacKeys[1]) == NULL);
+   for (i = 0; i < 4; i++)
+      if (i != 1)
+         ASSURE(SymTable_get(oSymTable, aacKeys[i]) == &aiValues[i]);
+
+   SymTable_free(oSymTable);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef TEST_ORDERED
+/* Append the uCount values at ppvValues to the MapOrder pvOrder. */
+
+static void visitBatchInOrder(const char **ppcKeys, void **ppvValues,
+   size_t uCount, void *pvOrder)
+{
+   size_t u;
+
+   assert(ppcKeys != NULL);
+   assert(ppvValues != NULL);
+
+   for (u = 0; u < uCount; u++)
+      visitInOrder(ppcKeys[u], ppvValues[u], pvOrder);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that SymTable_map and SymTable_mapBatch visit the bindings of
+   oSymTable in the order of the iCount values at ppvExpected. */
+
+static void checkOrder(SymTable_T oSymTable, void **ppvExpected,
+   int iCount)
+{
+   struct MapOrder sOrder;
+   int i;
+
+   sOrder.iCount = 0;
+   SymTable_map(oSymTable, visitInOrder, &sOrder);
+   ASSURE(sOrder.iCount == iCount);
+   for (i = 0; (i < iCount) && (i < sOrder.iCount); i++)
+      ASSURE(sOrder.apvValues[i] == ppvExpected[i]);
+
+   sOrder.iCount = 0;
+   SymTable_mapBatch(oSymTable, visitBatchInOrder, &sOrder, 7);
+   ASSURE(sOrder.iCount == iCount);
+   for (i = 0; (i < iCount) && (i < sOrder.iCount); i++)
+      ASSURE(sOrder.apvValues[i] == ppvExpected[i]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that an insertion-ordered SymTable object visits its bindings
+   in the order they were put, after removes leave holes among them
+   and after the rebuilds that squeeze the holes out. */
+
+static void testOrdered(void)
+{
+   enum {KEY_COUNT = 30};
+   enum {MAX_KEY_LENGTH = 16};
+
+   SymTable_T oSymTable;
+   void *apvExpected[2 * KEY_COUNT + 1];
+   int aiOld[KEY_COUNT];
+   int aiNew[KEY_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   int iCount = 0;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the order of an insertion-ordered SymTable.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+
+   /* Put keys in an order that is not that of their hash codes. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "o%d", (i * 7) % KEY_COUNT);
+      ASSURE(SymTable_put(oSymTable, acKey, &aiOld[i]));
+   }
+
+   /* Leave holes in the middle, at the start and at the end. */
+   for (i = 0; i < KEY_COUNT; i += 3)
+   {
+      sprintf(acKey, "o%d", (i * 7) % KEY_COUNT);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiOld[i]);
+   }
+   sprintf(acKey, "o%d", ((KEY_COUNT - 1) * 7) % KEY_COUNT);
+   ASSURE(SymTable_remove(oSymTable, acKey) == &aiOld[KEY_COUNT - 1]);
+   for (i = 0; i < KEY_COUNT - 1; i++)
+      if (i % 3 != 0)
+         apvExpected[iCount++] = &aiOld[i];
+   checkOrder(oSymTable, apvExpected, iCount);
+
+   /* Put enough new keys to fill the entry array, so that it is
+      rebuilt without the holes, and grown, in between. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "n%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &aiNew[i]));
+      apvExpected[iCount++] = &aiNew[i];
+   }
+   checkOrder(oSymTable, apvExpected, iCount);
+
+   /* A key that is put again goes to the end, and a key whose value
+      is replaced keeps its place. */
+   sprintf(acKey, "o%d", 0);
+   ASSURE(SymTable_put(oSymTable, acKey, &aiOld[0]));
+   apvExpected[iCount++] = &aiOld[0];
+   sprintf(acKey, "o%d", 7);
+   ASSURE(SymTable_replace(oSymTable, acKey, &aiNew[0]) == &aiOld[1]);
+   apvExpected[0] = &aiNew[0];
+   checkOrder(oSymTable, apvExpected, iCount);
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iCount);
+
+   SymTable_free(oSymTable);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to be large, that is, to
+   contain iBindingCount bindings. Write the time consumed to stdout. */
+
+static void testLargeTable(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSymTableSmall;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+   int iSmall;
+   int iLarge;
+   int iSuccessful;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+   size_t uLength = 0;
+   size_t uLength2;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a potentially large SymTable object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* Note the current time. */
+   iInitialClock = clock();
+
+   /* Create oSymTableSmall, and put a couple of bindings into it. */
+   oSymTableSmall = SymTable_new();
+   ASSURE(oSymTableSmall != NULL);
+   iSuccessful = SymTable_put(oSymTableSmall, "xxx", "xxx");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTableSmall, "yyy", "yyy");
+   ASSURE(iSuccessful);
+
+   /* Create oSymTable, the primary SymTable object. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Put iBindingCount new bindings into oSymTable.  Each binding's
+      key and value contain the same characters. */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)malloc(sizeof(char) * (strlen(acKey) + 1));
+      ASSURE(pcValue != NULL);
+      strcpy(pcValue, acKey);
+      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == (size_t)(i+1));
+   }
+
+   /* Get each binding's value, and make sure that it contains
+      the same characters as its key. */
+   iSmall = 0;
+   iLarge = iBindingCount - 1;
+   while (iSmall < iLarge)
+   {
+      /* Get the smallest of the remaining bindings. */
+      sprintf(acKey, "%d", iSmall);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+      iSmall++;
+      /* Get the largest of the remaining bindings. */
+      sprintf(acKey, "%d", iLarge);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+      iLarge--;
+   }
+   /* Get the middle binding -- if there is one. */
+   if (iSmall == iLarge)
+   {
+      sprintf(acKey, "%d", iSmall);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+   }
+
+   /* Remove each binding. Also free each binding's value. */
+   iSmall = 0;
+   iLarge = iBindingCount - 1;
+   while (iSmall < iLarge)
+   {
+      /* Remove the smallest of the remaining bindings. */
+      sprintf(acKey, "%d", iSmall);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+      free(pcValue);
+      uLength--;
+      uLength2 = SymTable_getLength(oSymTable);
+      ASSURE(uLength2 == uLength);
+      iSmall++;
+      /* Remove the largest of the remaining bindings. */
+      sprintf(acKey, "%d", iLarge);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+      free(pcValue);
+      uLength--;
+      uLength2 = SymTable_getLength(oSymTable);
+      ASSURE(uLength2 == uLength);
+      iLarge--;
+   }
+   /* Remove the middle binding -- if there is one. */
+   if (iSmall == iLarge)
+   {
+      sprintf(acKey, "%d", iSmall);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue != NULL);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+      free(pcValue);
+      uLength--;
+      uLength2 = SymTable_getLength(oSymTable);
+      ASSURE(uLength2 == uLength);  
+   }
+
+   /* Make sure oSymTableSmall hasn't been corrupted by expansion
+      of oSymTable. */
+   pcValue = (char*)SymTable_get(oSymTableSmall, "xxx");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "xxx") == 0));
+   pcValue = (char*)SymTable_get(oSymTableSmall, "yyy");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, "yyy") == 0));
+
+   /* Free both SymTable objects. */
+   SymTable_free(oSymTable);
+   SymTable_free(oSymTableSmall);
+
+   /* Note the current time, and print the time consumed to stdout. */
+   iFinalClock = clock();
+   printf("CPU time (%d bindings):  %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable ADT.  Write the output of the tests to stdout.
+   As always, argc is the command-line argument count, argv contains
+   the command-line arguments, and argv[0] is the name of the
+   executable binary file. argv[1] is the number of bindings to put
+   into a potentially large SymTable object.  Exit with EXIT_FAILURE
+   if argv[1] is missing or not numeric.  Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+   
+#ifndef S_SPLINT_S
+   setCpuTimeLimit();
+#endif
+
+   testBasics();
+   testKeyComparison();
+   testKeyOwnership();
+   testRemove();
+   testMap();
+   testMapBatch();
+   testEmptyTable();
+   testEmptyKey();
+   testNullValue();
+   testLongKey();
+   testTableOfTables();
+   testCollisions();
+   testGrowth();
+#ifdef TEST_ROBINHOOD
+   testRobinHood();
+#endif
+#ifdef TEST_ORDERED
+   testOrdered();
+#endif
+   testUpsert();
+   testReorder();
+   testAllocator();
+   testClear();
+   testMerge();
+   testBounded();
+   testAtoms();
+   testKeys();
+   testScopes();
+   testLog();
+   testShared();
+   testSharedFork();
+   testCombiner();
+   testCombinerThreads();
+#ifdef TEST_CUCKOO
+   testConcurrent();
+#endif
+   testFrozen();
+   testSymSet();
+   testFilter();
+   testHardened(iBindingCount);
+   testSized();
+   testHugePages(iBindingCount);
+   testFreeAsync(iBindingCount);
    testLargeTable(iBindingCount);
 
    printf("------------------------------------------------------\n");